@@ -10,7 +10,15 @@ void DrawDetections(cv::Mat &img, const std::vector<Detection> &objects)
     NN_LOG_DEBUG("draw %ld objects", objects.size());
     for (const auto &object : objects)
     {
-        cv::rectangle(img, object.box, object.color, 3);
+        // RGBA图像上alpha要不透明，否则框在窗口上不可见
+        cv::Scalar color = object.color;
+        cv::Scalar text_color(255, 0, 255);
+        if (img.channels() == 4)
+        {
+            color[3] = 255;
+            text_color[3] = 255;
+        }
+        cv::rectangle(img, object.box, color, 3);
         // class name with confidence
         std::string draw_string = object.className + " " + std::to_string(object.confidence);
 
@@ -19,7 +27,7 @@ void DrawDetections(cv::Mat &img, const std::vector<Detection> &objects)
                     cv::Point(object.box.x, object.box.y - 5),
                     cv::FONT_HERSHEY_SIMPLEX,
                     1.0,
-                    cv::Scalar(255, 0, 255),
+                    text_color,
                     2);
     }
 }
\ No newline at end of file
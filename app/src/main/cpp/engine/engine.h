@@ -20,6 +20,11 @@ public:
     virtual const std::vector<tensor_attr_s> &GetOutputShapes() = 0;                                                     // 获取输出张量的形状
     virtual nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outpus, bool want_float) = 0; // 运行模型
     virtual nn_error_e LoadModelData(char *modelData, int dataSize) = 0;
+    // 输入数据位于DMA-buf(fd, vaddr)中时直接让NPU读取，不支持的引擎退回Run
+    virtual nn_error_e RunWithInputFd(int /*fd*/, void * /*vaddr*/, std::vector<tensor_data_s> &inputs,
+                                      std::vector<tensor_data_s> &outputs, bool want_float) {
+        return Run(inputs, outputs, want_float);
+    }
 
 };
 
@@ -13,6 +13,7 @@
 
 #include "logging.h"
 #include "datatype.h"
+#include "bandwidth_meter.h"
 
 /**
  * @brief 加载模型文件
@@ -158,6 +159,7 @@ static void rknn_output_to_tensor_data(const rknn_output &output, tensor_data_s
     // NN_LOG_DEBUG("output size: %d", output.size);
     // NN_LOG_DEBUG("output want_float: %d", output.want_float);
     memcpy(data.data, output.buf, output.size);
+    BandwidthMeter::record(BW_SITE_NPU_OUTPUT, output.size, output.size);
 }
 
 #endif // RK3588_DEMO_ENGINE_HELPER_H
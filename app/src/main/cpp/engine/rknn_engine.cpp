@@ -72,6 +72,7 @@ nn_error_e RKEngine::LoadModelFile(const char *model_file) {
         print_tensor_attr(&(input_attrs[i]));
         // set input_shapes_
         in_shapes_.push_back(rknn_tensor_attr_convert(input_attrs[i]));
+        input_attrs_.push_back(input_attrs[i]);
     }
 
     // 输出属性
@@ -156,6 +157,7 @@ nn_error_e RKEngine::LoadModelData(char *modelData, int dataSize) {
         print_tensor_attr(&(input_attrs[i]));
         // set input_shapes_
         in_shapes_.push_back(rknn_tensor_attr_convert(input_attrs[i]));
+        input_attrs_.push_back(input_attrs[i]);
     }
 
     // 输出属性
@@ -218,9 +220,84 @@ nn_error_e RKEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_
         return NN_RKNN_INPUT_SET_FAIL;
     }
 
+    return RunAndGetOutputs(outputs, want_float);
+}
+
+/**
+ * @brief 输入已经在DMA-buf中时，用rknn_create_mem_from_fd导入后直接推理，省去rknn_inputs_set的拷贝
+ * 只支持单输入模型，导入或绑定失败时退回Run
+ * @param fd 输入缓冲的DMA-buf fd
+ * @param vaddr 输入缓冲的CPU映射地址
+ * @return nn_error_e 错误码
+ */
+nn_error_e RKEngine::RunWithInputFd(int fd, void *vaddr, std::vector<tensor_data_s> &inputs,
+                                    std::vector<tensor_data_s> &outputs, bool want_float) {
+    if (fd < 0 || zero_copy_disabled_ || input_num_ != 1 || inputs.size() != 1 || input_attrs_.empty()) {
+        return Run(inputs, outputs, want_float);
+    }
+    if (outputs.size() != output_num_) {
+        NN_LOG_ERROR("outputs num not match! outputs.size()=%ld, output_num_=%d", outputs.size(), output_num_);
+        return NN_IO_NUM_NOT_MATCH;
+    }
+
+    rknn_tensor_mem *mem = GetInputMem(fd, vaddr, inputs[0].attr.size);
+    if (mem == nullptr) {
+        return Run(inputs, outputs, want_float);
+    }
+
+    // 预处理写入的是NHWC uint8，由运行时完成归一化和布局转换
+    rknn_tensor_attr attr = input_attrs_[0];
+    attr.type = RKNN_TENSOR_UINT8;
+    attr.fmt = RKNN_TENSOR_NHWC;
+    attr.pass_through = 0;
+    int ret = rknn_set_io_mem(rknn_ctx_, mem, &attr);
+    if (ret < 0) {
+        NN_LOG_WARNING("rknn_set_io_mem fail! ret=%d, zero-copy input disabled", ret);
+        zero_copy_disabled_ = true;
+        ReleaseInputMems();
+        return Run(inputs, outputs, want_float);
+    }
+
+    return RunAndGetOutputs(outputs, want_float);
+}
+
+// 按(fd, vaddr)缓存导入的输入内存，同一块缓冲只导入一次
+rknn_tensor_mem *RKEngine::GetInputMem(int fd, void *vaddr, uint32_t size) {
+    std::pair<int, void *> key(fd, vaddr);
+    auto it = input_mems_.find(key);
+    if (it != input_mems_.end() && it->second->size >= size) {
+        return it->second;
+    }
+    if (it != input_mems_.end()) {
+        rknn_destroy_mem(rknn_ctx_, it->second);
+        input_mems_.erase(it);
+    }
+    // 正常情况下只有流水线的几个固定输入缓冲，超过上限说明缓冲在变化，全部重建
+    if (input_mems_.size() >= RKNN_MAX_INPUT_MEMS) {
+        ReleaseInputMems();
+    }
+
+    rknn_tensor_mem *mem = rknn_create_mem_from_fd(rknn_ctx_, fd, vaddr, size, 0);
+    if (mem == nullptr) {
+        NN_LOG_WARNING("rknn_create_mem_from_fd fail! fd=%d size=%u", fd, size);
+        return nullptr;
+    }
+    input_mems_[key] = mem;
+    return mem;
+}
+
+void RKEngine::ReleaseInputMems() {
+    for (auto &item: input_mems_) {
+        rknn_destroy_mem(rknn_ctx_, item.second);
+    }
+    input_mems_.clear();
+}
+
+// 推理并取出输出，Run和RunWithInputFd共用
+nn_error_e RKEngine::RunAndGetOutputs(std::vector<tensor_data_s> &outputs, bool want_float) {
     // 推理
     // NN_LOG_DEBUG("rknn running...");
-    ret = rknn_run(rknn_ctx_, nullptr);
+    int ret = rknn_run(rknn_ctx_, nullptr);
     if (ret < 0) {
         NN_LOG_ERROR("rknn_run fail! ret=%d", ret);
         return NN_RKNN_RUNTIME_ERROR;
@@ -252,6 +329,7 @@ nn_error_e RKEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_
 // 析构函数
 RKEngine::~RKEngine() {
     if (ctx_created_) {
+        ReleaseInputMems();
         rknn_destroy(rknn_ctx_);
         NN_LOG_INFO("rknn context destroyed! NPU Core %d released", npu_core_id_);
     }
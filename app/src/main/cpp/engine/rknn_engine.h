@@ -6,14 +6,18 @@
 #include "engine.h"
 
 #include <vector>
+#include <map>
+#include <utility>
 
 #include <rknn_api.h>
 
+#define RKNN_MAX_INPUT_MEMS 32 // 缓存的DMA-buf输入内存上限，超过后全部释放重建
+
 // 继承自NNEngine，实现NNEngine的接口
 class RKEngine : public NNEngine
 {
 public:
-    RKEngine() : rknn_ctx_(0), ctx_created_(false), input_num_(0), output_num_(0), npu_core_id_(AllocateNextCore()) {}; // 构造函数，自动分配NPU核心
+    RKEngine() : rknn_ctx_(0), ctx_created_(false), input_num_(0), output_num_(0), zero_copy_disabled_(false), npu_core_id_(AllocateNextCore()) {}; // 构造函数，自动分配NPU核心
     ~RKEngine() override;                                                            // 析构函数
 
     nn_error_e LoadModelData(char *modelData, int dataSize) override;
@@ -21,6 +25,8 @@ public:
     const std::vector<tensor_attr_s> &GetInputShapes() override;                                                       // 获取输入张量的形状
     const std::vector<tensor_attr_s> &GetOutputShapes() override;                                                      // 获取输出张量的形状
     nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float) override; // 运行模型
+    nn_error_e RunWithInputFd(int fd, void *vaddr, std::vector<tensor_data_s> &inputs,
+                              std::vector<tensor_data_s> &outputs, bool want_float) override;            // 零拷贝输入运行模型
 
 private:
     // rknn context
@@ -33,6 +39,15 @@ private:
     std::vector<tensor_attr_s> in_shapes_;  // 输入张量的形状
     std::vector<tensor_attr_s> out_shapes_; // 输出张量的形状
 
+    // 零拷贝输入
+    std::vector<rknn_tensor_attr> input_attrs_;                          // 模型原始输入属性
+    std::map<std::pair<int, void *>, rknn_tensor_mem *> input_mems_;     // (fd, vaddr) -> 已导入的输入内存
+    bool zero_copy_disabled_;                                            // rknn_set_io_mem失败后不再尝试
+
+    nn_error_e RunAndGetOutputs(std::vector<tensor_data_s> &outputs, bool want_float);
+    rknn_tensor_mem *GetInputMem(int fd, void *vaddr, uint32_t size);
+    void ReleaseInputMems();
+
     // NPU多核心支持
     int npu_core_id_;                       // 当前使用的NPU核心ID (0, 1, 2)
     static std::atomic<int> next_core_id_;  // 静态核心分配计数器
@@ -14,16 +14,23 @@
 #include "mpp_decoder.h"
 #include "yolov5_thread_pool.h"
 #include "display_queue.h"
+#include "frame_rate_controller.h"
+#include "motion_detector.h"
+#include "packet_activity.h"
 #include <android/native_window.h>
 #include <vector>
 #include <map>
 #include <string>
+#include <atomic>
 
 typedef struct g_rknn_app_context_t {
     FILE *out_fp;
     MppDecoder *decoder;
     Yolov5ThreadPool *yolov5ThreadPool;
     RenderFrameQueue *renderFrameQueue;
+    FrameRateController *rateController;  // 每路摄像头独立的推理/显示帧率控制
+    MotionDetector *motionDetector;       // 画面静止时跳过推理，并识别冻结的码流
+    PacketActivityEstimator *activityEstimator;  // 解码前按P帧大小估计画面活动
     // MppEncoder *encoder;
     // mk_media media;
     // mk_pusher pusher;
@@ -47,6 +54,10 @@ typedef struct g_rknn_app_context_t {
     bool is_stuck;              // 是否卡住状态
     int restart_attempts;       // 重启尝试次数
 
+    // 专用窗口尺寸，解码回调据此让预处理顺带生成显示图；窗口变化时更新，送显时以实际尺寸为准
+    int display_window_w;
+    int display_window_h;
+
 } rknn_app_context_t;
 
 class ZLPlayer {
@@ -59,9 +70,19 @@ private:
     char *modelFileContent = 0;
     int modelFileSize = 0;
     ANativeWindow *dedicatedWindow = nullptr; // 专用渲染窗口
+    int displayTileW = 0;                     // 专用窗口的实际尺寸，送显时转换到这个尺寸
+    int displayTileH = 0;
+
+    // 每帧内存流量统计（拷贝和格式转换的读写字节数），用于对比NV12路径和旧RGBA路径
+    std::atomic<int64_t> trafficBytes{0};
+    std::atomic<int64_t> trafficLegacyBytes{0};
+    std::atomic<int> trafficFrames{0};
 
     std::chrono::steady_clock::time_point nextRendTime;
 
+    // 最近一次推理的检测结果（原图坐标），静止未推理的帧送显时沿用，只在显示线程访问
+    std::vector<Detection> lastDetections;
+
 public:
     // static RenderCallback renderCallback;
     rknn_app_context_t app_ctx;
@@ -105,6 +126,12 @@ public:
     void setPerformanceConfig(int cameraIndex, int totalCameras, bool performanceMode = true);
     void optimizeThreadPool();
     void setFrameRateLimit(int targetFps);
+    void setInferenceRateLimit(float targetFps);
+    // 画面变化门控：threshold为变化格子占比，<=0关闭；keepAliveMs为静止时强制推理的间隔
+    void setMotionGate(float threshold, int keepAliveMs);
+    // 压缩域活动门控：mode见activity_gate_e，threshold为P帧超出静止基线的比例，skipDecode允许空闲时跳过非参考帧
+    void setActivityGate(int mode, float threshold, bool skipDecode);
+    float getActivityScore();
     void logMemoryUsage();  // 内存使用监控
 
     // 卡住检测和恢复方法
@@ -121,6 +148,14 @@ public:
     
     // 渲染到专用窗口（用于多摄像头）
     void renderFrameToWindow(uint8_t *src_data, int width, int height, int src_line_size, ANativeWindow *targetWindow);
+
+private:
+    // 窗口比帧小时返回窗口尺寸，否则保持帧尺寸
+    void getDisplayTileSize(int &width, int &height);
+
+    static void fitDisplayTile(int windowW, int windowH, int &width, int &height);
+    void recordFrameTraffic(const frame_data_t &frame, int tileW, int tileH, bool drew);
+    void logFrameTraffic();
 };
 
 #endif //AIBOX_ZLPLAYER_H
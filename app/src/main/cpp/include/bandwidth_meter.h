@@ -0,0 +1,90 @@
+#ifndef AIBOX_BANDWIDTH_METER_H
+#define AIBOX_BANDWIDTH_METER_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+#define BW_METER_MAX_CAMERAS 16
+
+// 拷贝和格式转换发生的位置
+typedef enum {
+    BW_SITE_DECODE_COPY = 0,        // 解码回调中把解码器缓冲拷贝到帧缓冲池
+    BW_SITE_PREPROCESS_RGA = 1,     // 预处理中RGA把NV12 letterbox到RGB输入张量
+    BW_SITE_LETTERBOX = 2,          // cv::Mat(BGR)输入的letterbox预处理
+    BW_SITE_TENSOR = 3,             // 预处理中CPU把NV12 letterbox到RGB输入张量
+    BW_SITE_NPU_OUTPUT = 4,         // rknn_output_to_tensor_data拷贝NPU输出
+    BW_SITE_DISPLAY_CONVERT = 5,    // 送显时RGA把NV12转成窗口尺寸的RGBA
+    BW_SITE_RENDER_COPY = 6,        // 渲染时逐行拷贝到窗口缓冲
+    BW_SITE_COUNT = 7,
+} bw_site_e;
+
+// 内存带宽统计：各拷贝/转换位置按摄像头记录读写字节数
+// 计数器每个线程一份，只由所属线程写，记录时不加锁；汇总时才遍历所有线程
+class BandwidthMeter {
+public:
+    static BandwidthMeter &getInstance();
+
+    // 记录到当前线程所服务的摄像头，见BandwidthCameraScope
+    static void record(bw_site_e site, int64_t readBytes, int64_t writtenBytes);
+
+    static void setCurrentCamera(int cameraIndex);
+    static int getCurrentCamera();
+
+    // 进入流水线的帧数，用于折算每帧字节数
+    void countFrame(int cameraIndex);
+
+    // 输出该摄像头自上次报告以来每秒、每帧各位置的读写字节数
+    void logReport(int cameraIndex);
+
+    static const char *siteName(bw_site_e site);
+
+    struct Counters {
+        std::atomic<uint64_t> read[BW_METER_MAX_CAMERAS][BW_SITE_COUNT];
+        std::atomic<uint64_t> written[BW_METER_MAX_CAMERAS][BW_SITE_COUNT];
+
+        Counters();
+    };
+
+    // 线程退出时把计数并入汇总，避免线程池缩容后数据丢失
+    void retire(Counters *counters);
+
+private:
+    BandwidthMeter();
+
+    Counters *registerThread();
+    void snapshot(int cameraIndex, uint64_t *read, uint64_t *written);
+
+    std::mutex mutex_;
+    std::vector<Counters *> threads_;
+    Counters retired_;
+
+    std::atomic<uint64_t> frames_[BW_METER_MAX_CAMERAS];
+    // 上次报告时的值，按摄像头分别计算区间
+    uint64_t lastRead_[BW_METER_MAX_CAMERAS][BW_SITE_COUNT];
+    uint64_t lastWritten_[BW_METER_MAX_CAMERAS][BW_SITE_COUNT];
+    uint64_t lastFrames_[BW_METER_MAX_CAMERAS];
+    int64_t lastReportUs_[BW_METER_MAX_CAMERAS];
+
+};
+
+// 在处理某一路摄像头的帧期间，把当前线程的记录归到该摄像头，离开作用域时恢复
+class BandwidthCameraScope {
+public:
+    explicit BandwidthCameraScope(int cameraIndex) : previous_(BandwidthMeter::getCurrentCamera()) {
+        BandwidthMeter::setCurrentCamera(cameraIndex);
+    }
+
+    ~BandwidthCameraScope() {
+        BandwidthMeter::setCurrentCamera(previous_);
+    }
+
+private:
+    BandwidthCameraScope(const BandwidthCameraScope &);
+    BandwidthCameraScope &operator=(const BandwidthCameraScope &);
+
+    int previous_;
+};
+
+#endif //AIBOX_BANDWIDTH_METER_H
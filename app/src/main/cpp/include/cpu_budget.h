@@ -0,0 +1,65 @@
+#ifndef AIBOX_CPU_BUDGET_H
+#define AIBOX_CPU_BUDGET_H
+
+#include <mutex>
+#include <stdint.h>
+#include "cpu_topology.h"
+
+// OpenCV并行策略
+typedef enum {
+    CV_BUDGET_AUTO = 0,     // 按角色CPU集合中空闲的核数分配，不超过cap
+    CV_BUDGET_SINGLE = 1,   // 单线程执行
+    CV_BUDGET_CAPPED = 2,   // 固定使用cap个线程
+} cv_budget_mode_e;
+
+// 进程级CPU预算：统计各角色正在运行的CPU密集线程数，决定OpenCV内部并行线程数
+// 推理线程本身已经占满大核时，OpenCV再开线程只会增加上下文切换
+class CpuBudget {
+public:
+    static CpuBudget &getInstance();
+
+    // 设置角色的OpenCV并行策略，cap <= 0按1处理；角色或模式无效时返回false
+    bool setRolePolicy(thread_role_e role, cv_budget_mode_e mode, int cap);
+
+    // 线程开始/结束参与CPU密集计算时调用，一般通过CpuBudgetScope使用
+    void workerStarted(thread_role_e role);
+    void workerStopped(thread_role_e role);
+
+    int getActiveWorkers(thread_role_e role);
+    int getOpenCVThreads();
+
+    void logStatus();
+
+private:
+    CpuBudget();
+
+    int computeThreadsLocked();
+    void applyLocked();
+
+    std::mutex mutex_;
+    int activeWorkers_[THREAD_ROLE_COUNT];
+    cv_budget_mode_e modes_[THREAD_ROLE_COUNT];
+    int caps_[THREAD_ROLE_COUNT];
+    int appliedThreads_;
+    uint64_t changes_;
+};
+
+// 在线程函数开头声明，线程退出时自动登记结束
+class CpuBudgetScope {
+public:
+    explicit CpuBudgetScope(thread_role_e role) : role_(role) {
+        CpuBudget::getInstance().workerStarted(role_);
+    }
+
+    ~CpuBudgetScope() {
+        CpuBudget::getInstance().workerStopped(role_);
+    }
+
+private:
+    CpuBudgetScope(const CpuBudgetScope &);
+    CpuBudgetScope &operator=(const CpuBudgetScope &);
+
+    thread_role_e role_;
+};
+
+#endif //AIBOX_CPU_BUDGET_H
@@ -0,0 +1,71 @@
+#ifndef AIBOX_CPU_TOPOLOGY_H
+#define AIBOX_CPU_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <sys/types.h>
+
+#define CPU_TOPOLOGY_SYSFS_ROOT "/sys/devices/system/cpu"
+
+// 线程角色，每种角色绑定到一组CPU
+typedef enum {
+    THREAD_ROLE_NETWORK = 0,    // ZLMediaKit网络线程和MPP解码器的送包、取帧线程（取帧线程执行解码回调）
+    THREAD_ROLE_STREAM = 1,     // rtps_process：取检测结果、画框
+    THREAD_ROLE_INFERENCE = 2,  // Yolov5ThreadPool::worker：预处理、推理、后处理
+    THREAD_ROLE_RENDER = 3,     // 渲染线程
+    THREAD_ROLE_COUNT
+} thread_role_e;
+
+const char *thread_role_name(thread_role_e role);
+
+// big.LITTLE拓扑：根据cpu_capacity区分大核(A76)和小核(A55)，并按角色设置线程亲和性
+class CpuTopology {
+public:
+    static CpuTopology &getInstance();
+
+    // 从sysfs读取各CPU的cpu_capacity，root可以指向伪造的sysfs目录
+    bool load(const std::string &sysfsRoot = CPU_TOPOLOGY_SYSFS_ROOT);
+
+    // 配置覆盖，cpuList格式如 "4-7" 或 "0,2,4-5"，空字符串表示恢复默认；已启动的该角色线程立即重新绑定
+    bool configureRole(thread_role_e role, const std::string &cpuList);
+
+    std::vector<int> getRoleCpus(thread_role_e role);
+    std::vector<int> getBigCores();
+    std::vector<int> getLittleCores();
+    int getCpuCount();
+
+    // 在线程启动时调用，把当前线程绑定到角色对应的CPU集合并登记统计
+    bool applyToCurrentThread(thread_role_e role, const char *threadName);
+
+    // 输出已登记线程的CPU迁移次数和上下文切换次数
+    void logThreadStats();
+
+    static bool parseCpuList(const std::string &cpuList, std::vector<int> &cpus);
+
+private:
+    CpuTopology();
+
+    struct ThreadRecord {
+        pid_t tid;
+        thread_role_e role;
+        std::string name;
+        long long lastMigrations;
+        long long lastSwitches;
+    };
+
+    void buildDefaultRoles();
+
+    std::mutex mutex_;
+    std::atomic<bool> loaded_;
+    std::string sysfsRoot_;
+    std::vector<int> capacities_;               // 下标为CPU编号
+    std::vector<int> bigCores_;
+    std::vector<int> littleCores_;
+    std::vector<int> roleCpus_[THREAD_ROLE_COUNT];
+    bool roleOverridden_[THREAD_ROLE_COUNT];
+    std::vector<ThreadRecord> threads_;
+};
+
+#endif //AIBOX_CPU_TOPOLOGY_H
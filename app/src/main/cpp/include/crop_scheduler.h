@@ -0,0 +1,79 @@
+#ifndef AIBOX_CROP_SCHEDULER_H
+#define AIBOX_CROP_SCHEDULER_H
+
+#include <opencv2/core.hpp>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include "iou_tracker.h"
+
+#define CROP_MAX_CAMERAS 16
+#define CROP_EXPAND 1.5f            // 预测框按边长放大1.5倍作为检测区域，容纳流水线延迟期间的移动
+#define CROP_MIN_SIZE 96            // 检测区域的最小边长，太小的目标带上足够的背景
+
+// 一帧的检测方式
+typedef enum {
+    CROP_PLAN_OFF = 0,          // 未打开跟踪裁剪，整幅（或检测区域、分块）检测
+    CROP_PLAN_FULL = 1,         // 周期性整幅检测，发现新目标，并作为召回率的基准
+    CROP_PLAN_CROPS = 2,        // 只检测跟踪目标附近的区域，拼进一幅模型输入一次推理
+    CROP_PLAN_IDLE = 3,         // 没有跟踪目标，本帧不推理
+} crop_plan_e;
+
+typedef struct {
+    uint64_t fullFrames;        // 整幅检测帧数，包括放不进拼图而改为整幅的帧
+    uint64_t cropFrames;
+    uint64_t idleFrames;
+    uint64_t fallbackFrames;    // 检测区域太多或太大，改为整幅检测的帧数
+    double fullNpuMs;           // 整幅检测每帧的NPU耗时，即不打开跟踪裁剪时每帧的耗时
+    double npuMsPerFrame;       // 打开后平均每帧的NPU耗时（包括不推理的帧）
+    double recall;              // 整幅检测帧中，检出的目标已在跟踪中的比例
+    uint64_t recallSamples;     // 参与召回率统计的目标数
+    int tracks;                 // 当前跟踪的目标数
+} crop_stats_t;
+
+// 跟踪引导的区域检测：每N帧做一次整幅检测，其间只把跟踪目标的预测位置附近的区域拼进模型输入推理，
+// 结果再交给跟踪器；plan在预处理线程调用，update在后处理完成一帧后调用，流水线中有几帧的延迟
+class CropScheduler {
+public:
+    static CropScheduler &getInstance();
+
+    // 每interval帧做一次整幅检测，interval <= 1关闭；切换时清空跟踪和统计
+    void setInterval(int cameraIndex, int interval);
+
+    int getInterval(int cameraIndex);
+
+    // 决定本帧的检测方式，CROP_PLAN_CROPS时crops为要检测的区域（已裁到画面内、对齐到偶数）
+    // 区域按拼图格子缩小后分辨率不能低于整幅检测，否则改为整幅检测
+    crop_plan_e plan(int cameraIndex, uint64_t pts, int frameWidth, int frameHeight, int modelWidth, int modelHeight,
+                     std::vector<cv::Rect> &crops);
+
+    // 一帧的结果（整幅坐标）和这一帧的NPU耗时
+    void update(int cameraIndex, crop_plan_e plan, uint64_t pts, const std::vector<Detection> &objects,
+                int64_t npuUs);
+
+    crop_stats_t getStats(int cameraIndex);
+
+    void logStats(int cameraIndex);
+
+private:
+    struct CameraState {
+        int interval;
+        uint64_t sequence;          // 已安排的帧数，决定哪些帧做整幅检测
+        IouTracker tracker;
+        bool hasBaseline;           // 已经有过一次整幅检测的结果，之后的整幅检测才统计召回率
+        uint64_t counts[4];         // 按crop_plan_e统计完成的帧数
+        int64_t npuUs[4];
+        uint64_t fallbacks;
+        uint64_t recallMatched;
+        uint64_t recallTotal;
+    };
+
+    CropScheduler();
+
+    void resetState(CameraState &state, int interval);
+
+    std::mutex mutex_;
+    CameraState cameras_[CROP_MAX_CAMERAS];
+};
+
+#endif //AIBOX_CROP_SCHEDULER_H
@@ -0,0 +1,41 @@
+#ifndef AIBOX_DMA_BUFFER_H
+#define AIBOX_DMA_BUFFER_H
+
+#include <stddef.h>
+
+// 帧缓冲的内存来源
+typedef enum {
+    FRAME_BACKEND_HEAP = 0,     // 普通堆内存，硬件只能通过虚拟地址导入
+    FRAME_BACKEND_DMA_HEAP = 1, // /dev/dma_heap 分配的DMA-buf，RGA/RKNN/MPP可以直接用fd
+    FRAME_BACKEND_MEMFD = 2,    // memfd，有fd但不是DMA-buf，用于没有dma_heap的环境（主机测试）
+    FRAME_BACKEND_MPP = 3,      // MPP解码器缓冲组中的DRM缓冲，是DMA-buf，由解码器回收，不进帧缓冲池
+} frame_backend_e;
+
+static inline bool frame_backend_is_dmabuf(frame_backend_e backend) {
+    return backend == FRAME_BACKEND_DMA_HEAP || backend == FRAME_BACKEND_MPP;
+}
+
+const char *frame_backend_name(frame_backend_e backend);
+
+// 探测可用的fd类后端：优先DMA heap，不可用时退回memfd
+frame_backend_e dma_buffer_detect_backend();
+
+// 分配size字节并映射，成功返回0；HEAP后端fd为-1
+int dma_buffer_alloc(frame_backend_e backend, size_t size, int *fd, void **vaddr);
+
+void dma_buffer_free(frame_backend_e backend, int fd, void *vaddr, size_t size);
+
+// 缓冲分配成功后和释放前的通知，硬件导入句柄的缓存据此登记和失效；回调在分配或释放的线程上同步执行
+typedef void (*dma_buffer_hook_t)(int fd, void *vaddr, size_t size);
+
+void dma_buffer_set_hooks(dma_buffer_hook_t on_alloc, dma_buffer_hook_t on_free);
+
+// 不经dma_buffer_alloc分配的缓冲（如MPP解码器缓冲组）由持有方自己通知
+void dma_buffer_notify_alloc(int fd, void *vaddr, size_t size);
+void dma_buffer_notify_free(int fd, void *vaddr, size_t size);
+
+// CPU访问DMA-buf前后做cache同步，非DMA-buf直接返回0
+int dma_buffer_sync_start(frame_backend_e backend, int fd, bool write);
+int dma_buffer_sync_end(frame_backend_e backend, int fd, bool write);
+
+#endif //AIBOX_DMA_BUFFER_H
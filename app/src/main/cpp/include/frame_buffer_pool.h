@@ -0,0 +1,102 @@
+#ifndef AIBOX_FRAME_BUFFER_POOL_H
+#define AIBOX_FRAME_BUFFER_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+#include "mpmc_bounded_queue.h"
+#include "dma_buffer.h"
+
+#define FRAME_POOL_MAX_BUCKETS 8                        // 同时存在的不同缓冲大小（分辨率）数
+#define FRAME_POOL_BUCKET_DEPTH 64                      // 每种大小最多缓存的空闲缓冲数
+#define FRAME_POOL_MAX_CACHED_BYTES (512LL * 1024 * 1024) // 空闲缓冲总量上限，超过后直接释放
+
+// 帧缓冲：从池中取出，最后一个引用释放时回到池中，内容不清零
+// DMA-buf后端同时提供fd，RGA(wrapbuffer_fd)、RKNN(rknn_create_mem_from_fd)、MPP编码器可直接使用
+struct FrameBuffer {
+    char *data;
+    size_t size;
+    int fd;                     // HEAP后端为-1
+    frame_backend_e backend;
+
+    // 图像布局，由取缓冲的一方填写
+    int width;
+    int height;
+    int widthStride;
+    int heightStride;
+    int format;
+
+    bool isDmaBuf() const {
+        return frame_backend_is_dmabuf(backend) && fd >= 0;
+    }
+
+    // CPU读写前后调用，DMA-buf需要cache同步
+    void beginCpuAccess(bool write) {
+        dma_buffer_sync_start(backend, fd, write);
+    }
+
+    void endCpuAccess(bool write) {
+        dma_buffer_sync_end(backend, fd, write);
+    }
+};
+
+typedef struct {
+    uint64_t hits;          // 从空闲链表取到缓冲的次数
+    uint64_t misses;        // 需要新分配的次数
+    uint64_t recycled;      // 释放后回到空闲链表的次数
+    uint64_t dropped;       // 释放时空闲链表满或超出缓存上限而真正释放的次数
+    int64_t cachedBytes;    // 空闲链表中的字节数
+    int64_t outstanding;    // 正在使用的缓冲数
+    int buckets;            // 已创建的大小档位数
+} frame_pool_stats_t;
+
+// 按缓冲大小分档的帧缓冲池，每档一个无锁空闲链表，解码线程取缓冲不加锁
+class FrameBufferPool {
+public:
+    static FrameBufferPool &getInstance();
+
+    // 默认自动探测（DMA heap，否则memfd）；切换后端后新分配的缓冲使用新后端
+    void setBackend(frame_backend_e backend);
+
+    frame_backend_e getBackend();
+
+    // 取一个至少size字节的缓冲，返回的shared_ptr析构时自动回收
+    std::shared_ptr<FrameBuffer> acquire(size_t size);
+
+    frame_pool_stats_t getStats();
+
+    void logStats();
+
+private:
+    struct Bucket {
+        std::atomic<size_t> size;
+        MpmcBoundedQueue<FrameBuffer *> *freeList;
+    };
+
+    struct Recycler {
+        FrameBufferPool *pool;
+        Bucket *bucket;
+
+        void operator()(FrameBuffer *buffer) const;
+    };
+
+    FrameBufferPool();
+
+    Bucket *findBucket(size_t size);
+
+    void release(Bucket *bucket, FrameBuffer *buffer);
+
+    Bucket buckets_[FRAME_POOL_MAX_BUCKETS];
+    std::mutex createMutex_;    // 只在创建新档位和探测后端时使用
+    std::atomic<int> backend_;  // -1表示尚未探测
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> recycled_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<int64_t> cachedBytes_;
+    std::atomic<int64_t> outstanding_;
+};
+
+#endif //AIBOX_FRAME_BUFFER_POOL_H
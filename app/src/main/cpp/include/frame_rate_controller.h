@@ -0,0 +1,105 @@
+#ifndef AIBOX_FRAME_RATE_CONTROLLER_H
+#define AIBOX_FRAME_RATE_CONTROLLER_H
+
+#include <stdint.h>
+#include <mutex>
+#include <atomic>
+
+// 令牌桶：按码流时间戳补充令牌，每放行一帧消耗一个令牌
+class TokenBucket {
+public:
+    TokenBucket();
+
+    // ratePerSec <= 0 表示不限速
+    void configure(double ratePerSec, double burst);
+
+    bool tryConsume(uint64_t timestampMs);
+
+    // 按时间戳补充令牌，返回是否有令牌，不消耗
+    bool available(uint64_t timestampMs);
+
+    // 消耗一个令牌，之前需要available返回true
+    void consume();
+
+    void reset();
+
+    double getRate() const { return rate_; }
+
+private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    uint64_t lastTimestampMs_;
+    bool hasTimestamp_;
+};
+
+typedef struct {
+    uint64_t framesDecoded;      // 解码帧数
+    uint64_t inferenceAdmitted;  // 实际提交推理的帧数
+    uint64_t inferenceDropped;   // 未提交推理的帧数（限速、队列满、画面静止或内存不足）
+    uint64_t queueFullDropped;   // 其中因推理队列满而丢弃的帧数
+    uint64_t displayAdmitted;    // 送显帧数
+    uint64_t displayDropped;     // 因显示限速丢弃的帧数
+} frame_rate_stats_t;
+
+// 每路摄像头一个实例，替代原来所有摄像头共享的静态lastRenderTime和固定frameSkip
+class FrameRateController {
+public:
+    FrameRateController();
+
+    void setInferenceFps(double fps);
+    void setDisplayFps(double fps);
+    void setMaxPendingInference(int maxPending);
+    // 暂停检测：解码帧全部不送推理，只显示
+    void setInferencePaused(bool paused);
+
+    double getInferenceFps();
+    double getDisplayFps();
+    int getMaxPendingInference() const { return maxPendingInference_.load(); }
+    bool isInferencePaused() const { return inferencePaused_.load(); }
+
+    // 解码线程调用：记录解码帧并判断本帧能否送推理（有令牌、未暂停、队列未满），不消耗令牌
+    bool offerInference(uint64_t pts, int pendingTasks);
+
+    // 帧确实提交推理后调用，消耗一个推理令牌；之后被门控或丢弃的帧不占用推理帧率
+    void commitInference();
+
+    // 解码线程调用：判断该帧是否送显，和推理各自按自己的帧率限速
+    bool admitDisplay(uint64_t pts);
+
+    // 流重启后清空时间基准
+    void reset();
+
+    frame_rate_stats_t getStats() const;
+
+    void logStats(int cameraIndex);
+
+private:
+    // 把码流时间戳转换成连续递增的时间轴，时间戳缺失、回退或跳变时按一帧间隔推进
+    struct StreamClock {
+        bool started;
+        uint64_t lastRawPts;
+        uint64_t timelineMs;
+
+        StreamClock() : started(false), lastRawPts(0), timelineMs(0) {}
+
+        uint64_t advance(uint64_t pts);
+    };
+
+    std::mutex mutex_;
+    TokenBucket inferenceBucket_;
+    TokenBucket displayBucket_;
+    std::atomic<int> maxPendingInference_;
+    std::atomic<bool> inferencePaused_;
+
+    StreamClock inferenceClock_;
+    StreamClock displayClock_;
+
+    std::atomic<uint64_t> framesDecoded_;
+    std::atomic<uint64_t> inferenceAdmitted_;
+    std::atomic<uint64_t> queueFullDropped_;
+    std::atomic<uint64_t> displayAdmitted_;
+    std::atomic<uint64_t> displayDropped_;
+};
+
+#endif //AIBOX_FRAME_RATE_CONTROLLER_H
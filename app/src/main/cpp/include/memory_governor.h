@@ -0,0 +1,107 @@
+#ifndef AIBOX_MEMORY_GOVERNOR_H
+#define AIBOX_MEMORY_GOVERNOR_H
+
+#include <atomic>
+#include <stdint.h>
+
+#define MEM_GOVERNOR_MAX_CAMERAS 16
+#define MEM_GOVERNOR_DEFAULT_CEILING_MB 1024    // 在途帧内存默认上限
+#define MEM_GOVERNOR_SHED_RATIO 0.80            // 超过上限的80%开始丢弃非优先摄像头的帧
+#define MEM_GOVERNOR_CONSTRAIN_RATIO 0.95       // 超过95%优先摄像头也只保留很浅的队列
+#define MEM_GOVERNOR_REDUCED_DEPTH 2            // 受限时优先摄像头允许的在途推理帧数
+
+// 帧所在的流水线阶段
+typedef enum {
+    MEM_STAGE_DECODE = 0,       // 解码回调中，等待提交推理（提交阻塞时停留在这里）
+    MEM_STAGE_INFERENCE = 1,    // 推理流水线中（输入队列、预处理、NPU、后处理）
+    MEM_STAGE_REORDER = 2,      // 推理完成，在重排缓冲中等待按序显示
+    MEM_STAGE_DISPLAY = 3,      // 正在绘制和渲染，包括显示用的RGBA缓冲
+    MEM_STAGE_COUNT = 4,
+} mem_stage_e;
+
+// 解码路径的准入结果
+typedef enum {
+    MEM_ADMIT = 0,
+    MEM_SHED_LOW_PRIORITY = 1,  // 内存紧张，丢弃非优先摄像头的帧
+    MEM_SHED_QUEUE_DEPTH = 2,   // 内存接近上限，优先摄像头队列深度受限
+    MEM_SHED_CEILING = 3,       // 超过上限，所有摄像头都丢帧
+} mem_admit_e;
+
+// 内存压力等级
+typedef enum {
+    MEM_PRESSURE_NORMAL = 0,
+    MEM_PRESSURE_SHED = 1,
+    MEM_PRESSURE_CONSTRAINED = 2,
+    MEM_PRESSURE_OVER = 3,
+} mem_pressure_e;
+
+// 全局在途帧内存管理：按摄像头、按阶段统计帧缓冲占用的字节数，超过上限时在解码路径上丢帧
+// 先丢非优先摄像头的帧，再压缩优先摄像头的队列深度，最后全部丢弃
+class MemoryGovernor {
+public:
+    static MemoryGovernor &getInstance();
+
+    void setCeilingBytes(int64_t bytes);
+    int64_t getCeilingBytes();
+
+    // 优先摄像头在内存紧张时继续保留，默认0号摄像头为优先
+    void setCameraPriority(int cameraIndex, bool priority);
+    bool isPriorityCamera(int cameraIndex);
+
+    // 解码回调在取帧缓冲前调用，pending为该摄像头已提交还没有结果的帧数
+    mem_admit_e admitFrame(int cameraIndex, int64_t bytes, int pending);
+
+    void charge(int cameraIndex, mem_stage_e stage, int64_t bytes);
+    void uncharge(int cameraIndex, mem_stage_e stage, int64_t bytes);
+
+    int64_t getBytes(int cameraIndex, mem_stage_e stage);
+    int64_t getCameraBytes(int cameraIndex);
+    int64_t getStageBytes(mem_stage_e stage);
+    int64_t getTotalBytes();
+    int64_t getPeakBytes();
+    uint64_t getShedCount(int cameraIndex);
+    mem_pressure_e getPressure();
+
+    void logStatus();
+
+    static const char *stageName(mem_stage_e stage);
+
+private:
+    MemoryGovernor();
+
+    mem_pressure_e pressureFor(int64_t bytes);
+
+    std::atomic<int64_t> bytes_[MEM_GOVERNOR_MAX_CAMERAS][MEM_STAGE_COUNT];
+    std::atomic<uint64_t> shed_[MEM_GOVERNOR_MAX_CAMERAS];
+    std::atomic<bool> priority_[MEM_GOVERNOR_MAX_CAMERAS];
+    std::atomic<int64_t> total_;
+    std::atomic<int64_t> peak_;
+    std::atomic<int64_t> ceiling_;
+    std::atomic<int> lastPressure_;
+};
+
+// 帧持有的内存记账，随帧在各阶段之间移动，释放或析构时撤销
+class MemoryCharge {
+public:
+    MemoryCharge() : camera_(-1), stage_(MEM_STAGE_DECODE), bytes_(0) {}
+
+    ~MemoryCharge() {
+        release();
+    }
+
+    void assign(int cameraIndex, mem_stage_e stage, int64_t bytes);
+
+    void moveTo(mem_stage_e stage);
+
+    void release();
+
+private:
+    MemoryCharge(const MemoryCharge &);
+    MemoryCharge &operator=(const MemoryCharge &);
+
+    int camera_;
+    mem_stage_e stage_;
+    int64_t bytes_;
+};
+
+#endif //AIBOX_MEMORY_GOVERNOR_H
@@ -0,0 +1,102 @@
+#ifndef AIBOX_MPMC_BOUNDED_QUEUE_H
+#define AIBOX_MPMC_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MPMC_CACHE_LINE 64
+
+// 无锁有界多生产者多消费者队列（Dmitry Vyukov的算法），容量向上取整到2的幂
+// 每个单元带序号，生产者和消费者各自用CAS推进位置，不需要互斥锁
+template<typename T>
+class MpmcBoundedQueue {
+public:
+    explicit MpmcBoundedQueue(size_t capacity) : buffer_(nullptr), mask_(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        buffer_ = new Cell[size];
+        mask_ = size - 1;
+        for (size_t i = 0; i < size; i++) {
+            buffer_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    ~MpmcBoundedQueue() {
+        delete[] buffer_;
+    }
+
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+
+    // 队列满返回false
+    bool enqueue(const T &value) {
+        Cell *cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &buffer_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列空返回false
+    bool dequeue(T &value) {
+        Cell *cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &buffer_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->data;
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    MpmcBoundedQueue(const MpmcBoundedQueue &);
+    MpmcBoundedQueue &operator=(const MpmcBoundedQueue &);
+
+    char pad0_[MPMC_CACHE_LINE];
+    Cell *buffer_;
+    size_t mask_;
+    char pad1_[MPMC_CACHE_LINE];
+    std::atomic<size_t> enqueuePos_;
+    char pad2_[MPMC_CACHE_LINE];
+    std::atomic<size_t> dequeuePos_;
+    char pad3_[MPMC_CACHE_LINE];
+};
+
+#endif //AIBOX_MPMC_BOUNDED_QUEUE_H
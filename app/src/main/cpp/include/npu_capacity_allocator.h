@@ -0,0 +1,90 @@
+#ifndef AIBOX_NPU_CAPACITY_ALLOCATOR_H
+#define AIBOX_NPU_CAPACITY_ALLOCATOR_H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+#include <atomic>
+
+class FrameRateController;
+
+#define NPU_CAPACITY_CORES 3
+#define NPU_CAPACITY_DEFAULT_COST_US 25000      // 还没有测量数据时假设单次推理25ms
+#define NPU_CAPACITY_TARGET_UTIL 0.85           // 只分配85%的算力，留出余量
+#define NPU_CAPACITY_DEGRADED_FPS 1.0           // 降级摄像头保底的检测帧率
+#define NPU_CAPACITY_REBALANCE_SAMPLES 100      // 每记录多少次推理重新评估一次容量
+
+// 摄像头准入状态
+typedef enum {
+    NPU_ADMISSION_NONE = 0,         // 未注册
+    NPU_ADMISSION_ADMITTED = 1,     // 满足最低检测帧率
+    NPU_ADMISSION_DEGRADED = 2,     // 算力不足，低于最低检测帧率运行
+    NPU_ADMISSION_REJECTED = 3,     // 算力不足且不允许降级，不做检测只显示
+} npu_admission_e;
+
+typedef struct {
+    float weight;           // 分配剩余算力时的权重
+    float minFps;           // 最低检测帧率
+    float maxFps;           // 最高检测帧率，一般等于码流帧率的一半
+    bool allowDegrade;      // 算力不足时是否允许降级运行，否则拒绝
+} npu_camera_policy_t;
+
+// 全局NPU算力分配：测量单次推理耗时和实际吞吐，按权重和最低帧率给每路摄像头分配检测帧率
+// 分配结果通过每路摄像头的FrameRateController生效
+class NpuCapacityAllocator {
+public:
+    static NpuCapacityAllocator &getInstance();
+
+    // 注册摄像头，已注册时保留原策略只更新限速器
+    npu_admission_e registerCamera(int cameraIndex, FrameRateController *controller);
+    void unregisterCamera(int cameraIndex, FrameRateController *controller);
+
+    // 设置策略后重新分配，返回该摄像头的准入状态
+    npu_admission_e setCameraPolicy(int cameraIndex, const npu_camera_policy_t &policy);
+    bool getCameraPolicy(int cameraIndex, npu_camera_policy_t &policy);
+
+    // NPU线程在每次推理前后调用，耗时按同时在跑的推理数折算成单次推理占用的NPU时间
+    void beginInference();
+    void endInference(int64_t costUs);
+
+    float getCapacityFps();
+    float getInferenceCostMs();
+    float getObservedFps();
+    float getAllocatedFps(int cameraIndex);
+    npu_admission_e getAdmission(int cameraIndex);
+
+    void rebalance();
+
+    void logStatus();
+
+    static npu_camera_policy_t defaultPolicy(int cameraIndex);
+
+private:
+    NpuCapacityAllocator();
+
+    struct CameraSlot {
+        FrameRateController *controller;
+        npu_camera_policy_t policy;
+        npu_admission_e admission;
+        float allocatedFps;
+        uint64_t order;     // 注册顺序，先注册的摄像头优先保住最低帧率
+    };
+
+    float capacityLocked();
+    void rebalanceLocked();
+
+    std::mutex mutex_;
+    std::map<int, CameraSlot> cameras_;
+    uint64_t nextOrder_;
+
+    std::atomic<int> inflight_;     // 正在执行的推理数
+    double costUs_;                 // 单次推理占用NPU时间的指数滑动平均
+    bool hasCost_;
+    uint64_t samples_;
+    uint64_t windowSamples_;        // 当前统计窗口内完成的推理次数
+    std::chrono::steady_clock::time_point windowStart_;
+    double observedFps_;            // 最近一个窗口的实际吞吐
+};
+
+#endif //AIBOX_NPU_CAPACITY_ALLOCATOR_H
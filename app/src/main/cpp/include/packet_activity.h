@@ -0,0 +1,105 @@
+#ifndef AIBOX_PACKET_ACTIVITY_H
+#define AIBOX_PACKET_ACTIVITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define ACTIVITY_GOP_SLOTS 4                // GOP内前3个P帧各自一条基线，之后共用一条：I帧后第一个P帧通常偏大
+#define ACTIVITY_MIN_BASELINE_BYTES 512     // 静止画面P帧只有几百字节，按这个下限归一化，避免小帧的抖动被放大
+#define ACTIVITY_WARMUP_FRAMES 50           // 基线建立前都算活动
+#define ACTIVITY_DEFAULT_THRESHOLD 0.5f     // P帧比静止基线大50%算活动
+#define ACTIVITY_KEEPALIVE_MS 2000          // 静止时强制推理的间隔，与像素门控的默认值一致
+#define ACTIVITY_HOLD_MS 1000               // 活动停止后继续推理的时间，与像素门控一致
+
+typedef enum {
+    ACTIVITY_GATE_OFF = 0,      // 不估计
+    ACTIVITY_GATE_SHADOW = 1,   // 只估计和统计与像素门控的一致性，不影响推理
+    ACTIVITY_GATE_CASCADE = 2,  // 压缩域判定静止的帧直接不送推理，不读像素；判定活动的帧再交给像素门控
+} activity_gate_e;
+
+typedef struct {
+    uint64_t packets;           // P帧数
+    uint64_t keyFrames;
+    uint64_t decodeSkipped;     // 空闲时未解码的非参考帧数
+    uint64_t admitted;          // 判定需要推理的解码帧数
+    uint64_t gated;             // 判定静止的解码帧数，影子模式下只统计不生效
+    uint64_t keepAlive;         // 静止时强制推理的帧数
+    uint64_t bothActive;        // 与像素门控比较：双方都判定活动
+    uint64_t bothIdle;          // 双方都判定静止
+    uint64_t packetOnly;        // 只有压缩域判定活动（误报）
+    uint64_t pixelOnly;         // 只有像素门控判定活动（漏检）
+    float score;                // 当前活动分数，P帧超出静止基线的比例
+    float baselineBytes;        // GOP后段P帧的静止基线
+    float keyFrameBytes;        // I帧平均大小
+} activity_stats_t;
+
+// 压缩域活动估计：解码前按P帧大小估计画面活动，几乎没有开销
+// P帧大小按所在GOP位置的静止基线归一化，基线跟踪下包络：变小时快速跟随，变大时缓慢上升，
+// 持续的均匀变化（雨、灯光）逐渐并入基线
+// onPacket只在网络线程调用，admitInference和recordAgreement只在解码回调中调用，其余接口可以在任意线程调用
+class PacketActivityEstimator {
+public:
+    PacketActivityEstimator();
+
+    // threshold <= 0 时所有帧都算活动；skipDecode只对非优先摄像头生效
+    void configure(activity_gate_e mode, float threshold, bool skipDecode);
+
+    activity_gate_e getMode() const {
+        return (activity_gate_e) mode_.load();
+    }
+
+    // 每个编码帧调用一次（不包括参数集），返回是否需要解码：
+    // 空闲的非优先摄像头可以跳过可丢弃的非参考帧，不影响后续帧解码
+    bool onPacket(size_t size, bool keyFrame, bool droppable, bool lowPriority);
+
+    // 解码帧是否需要推理，包括活动后的保持时间和静止时的强制推理
+    bool admitInference();
+
+    // 与像素门控这一帧的判定（包括保持时间）比较，影子模式下统计
+    void recordAgreement(bool pixelMoving);
+
+    // 当前或保持时间内有活动
+    bool isActive() const;
+
+    float getScore() const {
+        return score_.load();
+    }
+
+    // 流重启后重新建立基线
+    void reset();
+
+    activity_stats_t getStats() const;
+
+    void logStats(int cameraIndex);
+
+private:
+    std::atomic<int> mode_;
+    std::atomic<float> threshold_;
+    std::atomic<bool> skipDecode_;
+    std::atomic<bool> resetPending_;
+
+    // 以下只在网络线程访问
+    int gopPos_;
+    float baseline_[ACTIVITY_GOP_SLOTS];
+    float smoothed_;
+    float keyBytes_;
+    int sinceReset_;
+
+    // 只在解码回调中访问
+    int64_t lastInferMs_;
+
+    std::atomic<float> score_;
+    std::atomic<float> tailBaseline_;
+    std::atomic<float> keyFrameBytes_;
+    std::atomic<int64_t> lastActiveMs_;
+    std::atomic<uint64_t> packets_;
+    std::atomic<uint64_t> keyFrames_;
+    std::atomic<uint64_t> decodeSkipped_;
+    std::atomic<uint64_t> admitted_;
+    std::atomic<uint64_t> gated_;
+    std::atomic<uint64_t> keepAlive_;
+    std::atomic<uint64_t> agreement_[2][2];     // [压缩域活动][像素活动]
+};
+
+#endif // AIBOX_PACKET_ACTIVITY_H
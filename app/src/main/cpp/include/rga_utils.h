@@ -7,6 +7,7 @@
 #include "RgaUtils.h"
 #include "im2d.hpp"
 #include <string.h>
+#include <stdint.h>
 #include "util.h"
 #include <unistd.h>
 #include <malloc.h>
@@ -17,6 +18,59 @@ struct LetterBoxInfo {
     int pad;
 };
 
+// RGA处理的图像描述：fd >= 0时按DMA-buf导入，否则按虚拟地址导入；stride为0时等于宽高
+typedef struct {
+    int fd;
+    char *buf;
+    int width;
+    int height;
+    int wstride;
+    int hstride;
+    int format;
+} rga_image_t;
+
+rga_image_t rga_image(int fd, char *buf, int width, int height, int format, int wstride = 0, int hstride = 0);
+
+// RGA导入句柄的累计统计：登记过的缓冲（帧缓冲池、MPP缓冲组）导入一次后复用句柄，缓冲释放时失效
+typedef struct {
+    uint64_t imports;   // importbuffer_*调用次数
+    uint64_t releases;  // releasebuffer_handle调用次数
+    uint64_t hits;      // 复用缓存句柄的次数
+    int cached;         // 当前缓存的句柄数
+    int tracked;        // 当前登记的缓冲数（fd和地址分别计）
+} rga_handle_stats_t;
+
+rga_handle_stats_t rga_handle_cache_stats();
+
+// 输出上次调用以来每秒的导入、释放和复用次数
+void rga_handle_cache_log_stats();
+
+// 图像有效区域的字节数，不含stride对齐部分
+long rga_image_bytes(const rga_image_t &image);
+
+// 一次RGA操作完成格式转换和缩放，返回源读取和目标写入的字节数之和，失败返回-1
+long rga_convert(const rga_image_t &src, const rga_image_t &dst);
+
+// 源图整幅缩放转换到目标图的(x, y, width, height)区域，目标图其余部分不写，返回读写字节数，失败返回-1
+long rga_convert_rect(const rga_image_t &src, const rga_image_t &dst, int x, int y, int width, int height);
+
+// 源图src_rect区域缩放转换到目标图dst_rect区域，目标图其余部分不写，返回两个区域的字节数之和，失败返回-1
+long rga_convert_region(const rga_image_t &src, const im_rect &src_rect, const rga_image_t &dst,
+                        const im_rect &dst_rect);
+
+// 多输出RGA任务中的一个输出：源图src_rect区域缩放转换到image的rect区域，fill_outside时rect以外填0（letterbox）
+typedef struct {
+    rga_image_t image;
+    im_rect rect;
+    bool fill_outside;
+    im_rect src_rect;
+} rga_output_t;
+
+#define RGA_MULTI_MAX_OUTPUTS 8
+
+// 同一源图输出到多幅目标图，全部放在一次imbeginJob/imendJob提交中完成，返回读写字节数之和，任一输出失败整体返回-1
+long rga_convert_multi(const rga_image_t &src, const rga_output_t *outputs, int count);
+
 int rga_add_boarder(int src_width, int src_height, int src_format, char *src_buf,
                     int dst_width, int dst_height, int dst_format, char *dst_buf, float wh_ratio);
 
@@ -29,6 +83,10 @@ int rga_change_color(int src_width, int src_height, int src_format, char *src_bu
 int rga_letter_box(int src_width, int src_height, int src_format, char *src_buf,
                    int dst_width, int dst_height, int dst_format, char *dst_buf, float wh_ratio);
 
+// 目标是DMA-buf时用fd导入，避免按虚拟地址导入和额外的cache维护；dst_fd < 0 时等同rga_change_color
+int rga_change_color_fd(int src_width, int src_height, int src_format, char *src_buf,
+                        int dst_width, int dst_height, int dst_format, int dst_fd, char *dst_buf);
+
 int rga_change_color_async(int src_width, int src_height, int src_format, char *src_buf,
                            int dst_width, int dst_height, int dst_format, char *dst_buf);
 
@@ -0,0 +1,54 @@
+#ifndef AIBOX_ROI_REGISTRY_H
+#define AIBOX_ROI_REGISTRY_H
+
+#include <opencv2/core.hpp>
+#include <mutex>
+#include <vector>
+
+#define ROI_MAX_CAMERAS 16
+#define ROI_MAX_PER_CAMERA 4
+#define ROI_MIN_SIZE 32         // 换算到像素后小于这个尺寸的区域忽略
+
+typedef enum {
+    TILE_MODE_OFF = 0,          // 整幅（或检测区域）缩放到模型输入
+    TILE_MODE_TILES = 1,        // 切成重叠分块分别检测，小目标不会因整幅缩小而丢失
+    TILE_MODE_TILES_COARSE = 2, // 分块之外再做一次整幅检测，分块切开的大目标由整幅检测补上
+} tile_mode_e;
+
+// 按归一化坐标设置的检测区域，与码流分辨率无关
+typedef struct {
+    float x;
+    float y;
+    float width;
+    float height;
+} roi_rect_t;
+
+// 每路摄像头的静态检测区域：预处理只把这些区域缩放到模型输入，画面其余部分不参与检测
+// 没有设置时检测整幅画面；高分辨率摄像头还可以打开分块检测
+class RoiRegistry {
+public:
+    static RoiRegistry &getInstance();
+
+    // 设置摄像头的检测区域，超出画面的部分被裁掉，count为0时恢复整幅检测；返回实际生效的区域数
+    int setRegions(int cameraIndex, const roi_rect_t *rects, int count);
+
+    void clearRegions(int cameraIndex);
+
+    // 分块检测模式，设置了检测区域时只检测与区域相交的分块
+    void setTileMode(int cameraIndex, tile_mode_e mode);
+
+    tile_mode_e getTileMode(int cameraIndex);
+
+    // 按帧尺寸换算成像素区域（坐标和尺寸对齐到偶数，NV12色度按2x2采样）
+    // 区域数超过maxRegions时合并成一个外接矩形；没有设置时返回整幅画面
+    void getRegions(int cameraIndex, int frameWidth, int frameHeight, int maxRegions, std::vector<cv::Rect> &rects);
+
+private:
+    RoiRegistry();
+
+    std::mutex mutex_;
+    std::vector<roi_rect_t> regions_[ROI_MAX_CAMERAS];
+    tile_mode_e tileModes_[ROI_MAX_CAMERAS];
+};
+
+#endif //AIBOX_ROI_REGISTRY_H
@@ -1,7 +1,10 @@
 #ifndef MY_YOLOV5_RTSP_THREAD_POOL_USER_COMM_H
 #define MY_YOLOV5_RTSP_THREAD_POOL_USER_COMM_H
 
+#include <memory>
 #include "mpp_decoder.h"
+#include "frame_buffer_pool.h"
+#include "memory_governor.h"
 
 typedef struct g_frame_data_t {
     char *data;
@@ -12,20 +15,44 @@ typedef struct g_frame_data_t {
     int widthStride;
     int heightStride;
     int frameId;
-    int frameFormat;
+    int cameraIndex;    // 所属摄像头，用于按摄像头统计
+    int frameFormat;    // RK_FORMAT_*，解码后为RK_FORMAT_YCbCr_420_SP(NV12)，screenStride为Y平面行字节数
+    uint64_t pts;       // 码流时间戳(ms)，用于按流时间控制帧率
+    int64_t bytesMoved; // 各环节拷贝/格式转换读写的字节数之和，用于统计每帧内存流量
+    int scratchAllocs;  // 预处理时临时图像重新分配的次数，稳定运行时为0
+    std::shared_ptr<FrameBuffer> buffer;    // data来自帧缓冲池时持有的缓冲，释放后回到池中
+    MemoryCharge memCharge;                 // 在全局内存管理中的记账，随帧在各阶段之间移动
+    int displayW;       // 送显尺寸，非0时预处理与模型输入一起生成这个尺寸的RGBA显示图
+    int displayH;
+    std::shared_ptr<FrameBuffer> displayBuffer; // 预处理时生成的RGBA显示图，送显时直接使用
+    MemoryCharge displayCharge;
+    bool inferenceSkipped;  // 限速或画面静止未送推理，直接进入重排缓冲，送显时沿用上一帧的检测结果
+    bool displaySkipped;    // 送显限速不显示，只经过重排缓冲取检测结果
 
-    // 🔧 添加析构函数来自动释放内存
-    ~g_frame_data_t() {
-        if (data) {
+    // 释放帧数据：池缓冲回收，否则delete[]
+    void releaseData() {
+        memCharge.release();
+        displayBuffer.reset();
+        displayCharge.release();
+        if (buffer) {
+            buffer.reset();
+        } else if (data) {
             delete[] data;
-            data = nullptr;
         }
+        data = nullptr;
+    }
+
+    // 🔧 添加析构函数来自动释放内存
+    ~g_frame_data_t() {
+        releaseData();
     }
 
     // 🔧 添加构造函数
     g_frame_data_t() : data(nullptr), dataSize(0), screenStride(0),
                        screenW(0), screenH(0), widthStride(0),
-                       heightStride(0), frameId(0), frameFormat(0) {}
+                       heightStride(0), frameId(0), cameraIndex(-1), frameFormat(0), pts(0), bytesMoved(0),
+                       scratchAllocs(0), displayW(0), displayH(0), inferenceSkipped(false),
+                       displaySkipped(false) {}
 } frame_data_t;
 
 #endif //MY_YOLOV5_RTSP_THREAD_POOL_USER_COMM_H
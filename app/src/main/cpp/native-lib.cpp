@@ -11,6 +11,13 @@
 #include <chrono>
 #include "log4c.h"
 #include "ZLPlayer.h"
+#include "npu_capacity_allocator.h"
+#include "memory_governor.h"
+#include "frame_buffer_pool.h"
+#include "roi_registry.h"
+#include "crop_scheduler.h"
+#include "cpu_topology.h"
+#include "cpu_budget.h"
 #include <jni.h>
 
 #define MAX_CAMERAS 16
@@ -168,43 +175,55 @@ Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraCount(JNIEnv *env,
     
     LOGD("Setting camera count to: %d", count);
     
-    // 清理现有的摄像头实例（除了主实例）
-    for (auto& pair : cameraPlayers) {
-        if (pair.second && pair.first > 0) {  // 保留主实例(index 0)
-            LOGD("Cleaning up ZLPlayer instance for camera %d", pair.first);
-            // 先停止RTSP流，再删除实例
-            pair.second->stopRtspStream();
-            delete pair.second;
+    // 只清理超出新数量的摄像头实例（主实例保留），其余实例继续运行
+    for (auto it = cameraPlayers.begin(); it != cameraPlayers.end();) {
+        if (it->first > 0 && it->first >= count) {
+            if (it->second) {
+                LOGD("Cleaning up ZLPlayer instance for camera %d", it->first);
+                // 先停止RTSP流，再删除实例
+                it->second->stopRtspStream();
+                delete it->second;
+            }
+            it = cameraPlayers.erase(it);
+        } else {
+            ++it;
         }
     }
-    cameraPlayers.clear();
 
     // 获取主ZLPlayer实例
     auto *mainPlayer = reinterpret_cast<ZLPlayer *>(native_player_obj);
     cameraPlayers[0] = mainPlayer;  // 主实例用于第一个摄像头
 
-    // 为主实例设置性能配置
+    // 为主实例设置性能配置，线程池在运行时扩缩容
     mainPlayer->setPerformanceConfig(0, count, true);
     mainPlayer->optimizeThreadPool();
     mainPlayer->setFrameRateLimit(30);  // 主摄像头30FPS
     LOGD("Camera 0 using main ZLPlayer instance with performance optimization");
 
-    // 为每个额外的摄像头创建独立的ZLPlayer实例
     for (int i = 1; i < count && i < MAX_CAMERAS; i++) {
+        auto existing = cameraPlayers.find(i);
+        if (existing != cameraPlayers.end() && existing->second) {
+            // 已有实例：只重新分配线程池容量，不中断正在播放的流
+            existing->second->setPerformanceConfig(i, count, true);
+            existing->second->optimizeThreadPool();
+            LOGD("Camera %d kept running, thread pool rebalanced", i);
+            continue;
+        }
+
+        // 为新增的摄像头创建独立的ZLPlayer实例
         try {
             // 先创建空的ZLPlayer实例
             ZLPlayer* newPlayer = new ZLPlayer(nullptr, 0);
 
+            // 先设置性能配置，模型加载时直接按目标大小创建线程池
+            newPlayer->setPerformanceConfig(i, count, true);
+
             // 从主实例获取模型数据并初始化
             char* modelData = mainPlayer->getModelData();
             int modelSize = mainPlayer->getModelSize();
 
             if (modelData != nullptr && modelSize > 0) {
                 newPlayer->initializeModelData(modelData, modelSize);
-
-                // 为新实例设置性能配置
-                newPlayer->setPerformanceConfig(i, count, true);
-                newPlayer->optimizeThreadPool();
                 newPlayer->setFrameRateLimit(25);  // 其他摄像头25FPS
 
                 LOGD("Camera %d created independent ZLPlayer instance with performance optimization", i);
@@ -398,3 +417,225 @@ Java_com_wulala_myyolov5rtspthreadpool_MainActivity_checkAndRecoverStuckCameras(
         LOGD("All cameras are running normally");
     }
 }
+
+// NPU算力分配：设置摄像头检测策略，返回准入状态（0未注册 1准入 2降级 3拒绝）
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraDetectionPolicy(JNIEnv *env, jobject thiz, jint camera_index,
+                                                                            jfloat weight, jfloat min_fps, jfloat max_fps,
+                                                                            jboolean allow_degrade) {
+    if (camera_index < 0 || camera_index >= MAX_CAMERAS) {
+        LOGE("Invalid camera index: %d", camera_index);
+        return NPU_ADMISSION_NONE;
+    }
+    npu_camera_policy_t policy;
+    policy.weight = weight;
+    policy.minFps = min_fps;
+    policy.maxFps = max_fps;
+    policy.allowDegrade = allow_degrade;
+    npu_admission_e admission = NpuCapacityAllocator::getInstance().setCameraPolicy(camera_index, policy);
+    LOGD("Camera %d detection policy: weight=%.1f min=%.1f max=%.1f degrade=%d -> admission %d",
+         camera_index, weight, min_fps, max_fps, allow_degrade, admission);
+    return admission;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getCameraAdmissionState(JNIEnv *env, jobject thiz, jint camera_index) {
+    return NpuCapacityAllocator::getInstance().getAdmission(camera_index);
+}
+
+// 返回分配到的检测帧率，未注册返回-1
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getCameraDetectionFps(JNIEnv *env, jobject thiz, jint camera_index) {
+    return NpuCapacityAllocator::getInstance().getAllocatedFps(camera_index);
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getNpuCapacityFps(JNIEnv *env, jobject thiz) {
+    return NpuCapacityAllocator::getInstance().getCapacityFps();
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getNpuInferenceCostMs(JNIEnv *env, jobject thiz) {
+    return NpuCapacityAllocator::getInstance().getInferenceCostMs();
+}
+
+// 帧缓冲池统计：[命中, 未命中, 回收, 释放, 空闲字节数, 使用中缓冲数]
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getFrameBufferPoolStats(JNIEnv *env, jobject thiz) {
+    frame_pool_stats_t stats = FrameBufferPool::getInstance().getStats();
+    jlong values[6] = {(jlong) stats.hits, (jlong) stats.misses, (jlong) stats.recycled,
+                       (jlong) stats.dropped, (jlong) stats.cachedBytes, (jlong) stats.outstanding};
+    jlongArray result = env->NewLongArray(6);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, 6, values);
+    }
+    return result;
+}
+
+// 在途帧内存上限（MB），<=0恢复默认值
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setFrameMemoryCeilingMB(JNIEnv *env, jobject thiz, jlong ceiling_mb) {
+    MemoryGovernor::getInstance().setCeilingBytes((int64_t) ceiling_mb * 1024 * 1024);
+}
+
+// 内存紧张时是否保留该摄像头的帧
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraMemoryPriority(JNIEnv *env, jobject thiz, jint camera_index,
+                                                                           jboolean priority) {
+    MemoryGovernor::getInstance().setCameraPriority(camera_index, priority == JNI_TRUE);
+}
+
+// 在途帧内存（字节）：[解码, 推理, 重排, 显示, 丢帧数]；camera_index < 0 时返回全局 [解码, 推理, 重排, 显示, 峰值]
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getFrameMemoryUsage(JNIEnv *env, jobject thiz, jint camera_index) {
+    MemoryGovernor &governor = MemoryGovernor::getInstance();
+    jlong values[MEM_STAGE_COUNT + 1];
+    for (int stage = 0; stage < MEM_STAGE_COUNT; stage++) {
+        values[stage] = camera_index < 0 ? governor.getStageBytes((mem_stage_e) stage)
+                                         : governor.getBytes(camera_index, (mem_stage_e) stage);
+    }
+    values[MEM_STAGE_COUNT] = camera_index < 0 ? governor.getPeakBytes()
+                                               : (jlong) governor.getShedCount(camera_index);
+    jlongArray result = env->NewLongArray(MEM_STAGE_COUNT + 1);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, MEM_STAGE_COUNT + 1, values);
+    }
+    return result;
+}
+
+// 摄像头的静态检测区域，rects按 [x, y, 宽, 高] 依次排列，取值为相对画面的0~1；为空时检测整幅画面
+// 返回实际生效的区域数
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraRois(JNIEnv *env, jobject thiz, jint camera_index,
+                                                                 jfloatArray rects) {
+    RoiRegistry &registry = RoiRegistry::getInstance();
+    jsize length = rects != nullptr ? env->GetArrayLength(rects) : 0;
+    if (length < 4) {
+        registry.clearRegions(camera_index);
+        return 0;
+    }
+    int count = length / 4;
+    std::vector<jfloat> values(count * 4);
+    env->GetFloatArrayRegion(rects, 0, count * 4, values.data());
+    std::vector<roi_rect_t> regions(count);
+    for (int i = 0; i < count; i++) {
+        regions[i] = {values[i * 4], values[i * 4 + 1], values[i * 4 + 2], values[i * 4 + 3]};
+    }
+    return registry.setRegions(camera_index, regions.data(), count);
+}
+
+// 分块检测模式：0关闭 1分块 2分块加整幅检测，用于4K等高分辨率摄像头的小目标
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraTileMode(JNIEnv *env, jobject thiz, jint camera_index,
+                                                                     jint mode) {
+    if (mode < TILE_MODE_OFF || mode > TILE_MODE_TILES_COARSE) {
+        LOGE("setCameraTileMode: invalid mode %d", mode);
+        return;
+    }
+    RoiRegistry::getInstance().setTileMode(camera_index, (tile_mode_e) mode);
+}
+
+// 跟踪引导的区域检测：每interval帧整幅检测一次，其间只检测跟踪目标附近的区域，interval <= 1关闭
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraCropDetection(JNIEnv *env, jobject thiz,
+                                                                          jint camera_index, jint interval) {
+    CropScheduler::getInstance().setInterval(camera_index, interval);
+}
+
+// 区域检测统计：[平均每帧NPU毫秒, 整幅检测每帧NPU毫秒, 召回率, 召回率样本数, 跟踪目标数]
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getCameraCropStats(JNIEnv *env, jobject thiz, jint camera_index) {
+    crop_stats_t stats = CropScheduler::getInstance().getStats(camera_index);
+    jfloat values[5] = {(jfloat) stats.npuMsPerFrame, (jfloat) stats.fullNpuMs, (jfloat) stats.recall,
+                        (jfloat) stats.recallSamples, (jfloat) stats.tracks};
+    jfloatArray result = env->NewFloatArray(5);
+    if (result != nullptr) {
+        env->SetFloatArrayRegion(result, 0, 5, values);
+    }
+    return result;
+}
+
+// 画面变化门控：threshold为变化格子占比（<=0关闭，默认关闭，建议0.0005），keepAliveMs为静止时强制推理的间隔
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraMotionGate(JNIEnv *env, jobject thiz, jint camera_index,
+                                                                       jfloat threshold, jint keep_alive_ms) {
+    auto it = cameraPlayers.find(camera_index);
+    if (it == cameraPlayers.end() || !it->second) {
+        LOGW("setCameraMotionGate: camera %d not found", camera_index);
+        return;
+    }
+    it->second->setMotionGate(threshold, keep_alive_ms);
+}
+
+// 压缩域活动门控：mode 0关闭、1影子（默认，只统计与像素门控的一致性）、2级联（压缩域判定静止的帧不读像素）
+// threshold为P帧超出静止基线的比例（默认0.5），skipDecode允许空闲的非优先摄像头跳过非参考帧
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setCameraActivityGate(JNIEnv *env, jobject thiz, jint camera_index,
+                                                                         jint mode, jfloat threshold,
+                                                                         jboolean skip_decode) {
+    auto it = cameraPlayers.find(camera_index);
+    if (it == cameraPlayers.end() || !it->second) {
+        LOGW("setCameraActivityGate: camera %d not found", camera_index);
+        return;
+    }
+    it->second->setActivityGate(mode, threshold, skip_decode);
+}
+
+// 当前压缩域活动分数，0表示与静止基线相当
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_getCameraActivityScore(JNIEnv *env, jobject thiz, jint camera_index) {
+    auto it = cameraPlayers.find(camera_index);
+    if (it == cameraPlayers.end() || !it->second) {
+        return 0;
+    }
+    return it->second->getActivityScore();
+}
+
+// 线程角色的CPU绑定：role 0网络解码 1取结果画框 2推理 3渲染；cpuList如"4-7"或"0,2,4-5"，空字符串恢复大小核默认映射
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setThreadRoleCpus(JNIEnv *env, jobject thiz, jint role,
+                                                                     jstring cpu_list) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        LOGW("setThreadRoleCpus: invalid role %d", role);
+        return JNI_FALSE;
+    }
+    std::string cpus;
+    if (cpu_list != nullptr) {
+        const char *cpu_str = env->GetStringUTFChars(cpu_list, nullptr);
+        if (cpu_str == nullptr) {
+            return JNI_FALSE;
+        }
+        cpus = cpu_str;
+        env->ReleaseStringUTFChars(cpu_list, cpu_str);
+    }
+    return CpuTopology::getInstance().configureRole((thread_role_e) role, cpus) ? JNI_TRUE : JNI_FALSE;
+}
+
+// 线程角色的OpenCV并行策略：mode 0按空闲核数自动分配（不超过cap） 1单线程 2固定cap个线程
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_wulala_myyolov5rtspthreadpool_MainActivity_setThreadRolePolicy(JNIEnv *env, jobject thiz, jint role,
+                                                                       jint mode, jint cap) {
+    if (!CpuBudget::getInstance().setRolePolicy((thread_role_e) role, (cv_budget_mode_e) mode, cap)) {
+        LOGW("setThreadRolePolicy: invalid role %d or mode %d", role, mode);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
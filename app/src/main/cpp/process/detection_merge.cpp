@@ -0,0 +1,40 @@
+#include "detection_merge.h"
+
+#include <algorithm>
+
+float detection_iou(const cv::Rect &a, const cv::Rect &b) {
+    int inter = (a & b).area();
+    int total = a.area() + b.area() - inter;
+    return total > 0 ? (float) inter / total : 0.f;
+}
+
+float detection_ios(const cv::Rect &a, const cv::Rect &b) {
+    int smaller = std::min(a.area(), b.area());
+    return smaller > 0 ? (float) (a & b).area() / smaller : 0.f;
+}
+
+void merge_detections(std::vector<Detection> &objects, float iou_threshold, float ios_threshold) {
+    if (objects.size() < 2) {
+        return;
+    }
+    std::stable_sort(objects.begin(), objects.end(), [](const Detection &a, const Detection &b) {
+        return a.confidence > b.confidence;
+    });
+    std::vector<Detection> kept;
+    kept.reserve(objects.size());
+    for (const Detection &obj: objects) {
+        bool suppressed = false;
+        for (const Detection &other: kept) {
+            if (other.class_id == obj.class_id && other.className == obj.className &&
+                (detection_iou(other.box, obj.box) > iou_threshold ||
+                 detection_ios(other.box, obj.box) > ios_threshold)) {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed) {
+            kept.push_back(obj);
+        }
+    }
+    objects.swap(kept);
+}
@@ -0,0 +1,21 @@
+// 多个检测区域（ROI、分块）结果合并到整幅画面后的去重
+
+#ifndef RK3588_DEMO_DETECTION_MERGE_H
+#define RK3588_DEMO_DETECTION_MERGE_H
+
+#include <vector>
+#include "yolo_datatype.h"
+
+// 两个框的交并比
+float detection_iou(const cv::Rect &a, const cv::Rect &b);
+
+#define MERGE_IOS_THRESH 0.7f     // 分块边缘切开的目标只检出一部分，和完整的框IoU很低，按交集占小框的比例判断
+
+// 交集占较小框面积的比例
+float detection_ios(const cv::Rect &a, const cv::Rect &b);
+
+// 按类别做非极大值抑制：同类且IoU超过iou_threshold或交集占小框比例超过ios_threshold的框只保留置信度最高的一个，
+// 结果按置信度降序；各区域单独推理时重叠部分的目标会被检出多次，坐标还原到整幅画面后调用
+void merge_detections(std::vector<Detection> &objects, float iou_threshold, float ios_threshold = MERGE_IOS_THRESH);
+
+#endif // RK3588_DEMO_DETECTION_MERGE_H
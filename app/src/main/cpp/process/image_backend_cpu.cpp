@@ -0,0 +1,218 @@
+// CPU图像处理后端：OpenCV完成颜色转换和缩放，NV12到RGB的letterbox用单遍内核，不依赖RGA，主机上也能运行
+
+#include "image_processor.h"
+
+#include <opencv2/imgproc.hpp>
+#include "nv12_letterbox.h"
+#include "scratch_arena.h"
+
+namespace {
+
+bool is_nv12(int format) {
+    return format == RK_FORMAT_YCbCr_420_SP;
+}
+
+int packed_type(int format) {
+    int bpp = (int) image_format_bpp(format);
+    if (is_nv12(format) || bpp < 3) {
+        return -1;
+    }
+    return CV_8UC(bpp);
+}
+
+// NV12到打包格式的颜色转换代码，不支持返回-1
+int nv12_conversion(int dst_format) {
+    switch (dst_format) {
+        case RK_FORMAT_RGB_888:
+            return cv::COLOR_YUV2RGB_NV12;
+        case RK_FORMAT_BGR_888:
+            return cv::COLOR_YUV2BGR_NV12;
+        case RK_FORMAT_RGBA_8888:
+            return cv::COLOR_YUV2RGBA_NV12;
+        case RK_FORMAT_BGRA_8888:
+            return cv::COLOR_YUV2BGRA_NV12;
+        default:
+            return -1;
+    }
+}
+
+// 打包格式之间的颜色转换代码，不支持返回-1，格式相同不需要转换
+int packed_conversion(int src_format, int dst_format) {
+    bool src_rgb = src_format == RK_FORMAT_RGB_888 || src_format == RK_FORMAT_RGBA_8888;
+    bool dst_rgb = dst_format == RK_FORMAT_RGB_888 || dst_format == RK_FORMAT_RGBA_8888;
+    int src_cn = (int) image_format_bpp(src_format);
+    int dst_cn = (int) image_format_bpp(dst_format);
+    if (src_cn == 3 && dst_cn == 3) {
+        return cv::COLOR_RGB2BGR;
+    }
+    if (src_cn == 4 && dst_cn == 4) {
+        return cv::COLOR_RGBA2BGRA;
+    }
+    if (src_cn == 3 && dst_cn == 4) {
+        return src_rgb == dst_rgb ? cv::COLOR_RGB2RGBA : cv::COLOR_RGB2BGRA;
+    }
+    if (src_cn == 4 && dst_cn == 3) {
+        return src_rgb == dst_rgb ? cv::COLOR_RGBA2RGB : cv::COLOR_RGBA2BGR;
+    }
+    return -1;
+}
+
+cv::Mat wrap_packed(const rga_image_t &image, const cv::Rect &rect) {
+    int bpp = (int) image_format_bpp(image.format);
+    cv::Mat mat(image.height, image.width, packed_type(image.format), image.buf, (size_t) image.wstride * bpp);
+    return mat(rect);
+}
+
+// NV12源图中一个偶数对齐区域的视图：Y平面起点移到区域左上角，hstride相应减小，
+// 使buf + wstride * hstride仍指向该区域的UV起点，单遍内核按整幅图像处理即可
+rga_image_t nv12_view(const rga_image_t &image, const cv::Rect &rect) {
+    rga_image_t view = image;
+    view.buf = image.buf + (size_t) image.wstride * rect.y + rect.x;
+    view.width = rect.width;
+    view.height = rect.height;
+    view.hstride = image.hstride - rect.y / 2;
+    return view;
+}
+
+// 每个线程复用的临时图像，分辨率不变时不重新分配；同一次处理中只能取一次
+cv::Mat scratch_mat(int rows, int cols, int type) {
+    uchar *data = ScratchArena::forCurrentThread().reserve(SCRATCH_CONVERT, (size_t) rows * cols * CV_ELEM_SIZE(type));
+    return cv::Mat(rows, cols, type, data);
+}
+
+class CpuImageBackend : public ImageBackend {
+public:
+    const char *name() const override {
+        return "cpu";
+    }
+
+    long process(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                 const cv::Rect &dst_rect) override {
+        if (!src.buf || !dst.buf) {
+            return -1;
+        }
+        image_begin_cpu_access(src, false);
+        image_begin_cpu_access(dst, true);
+        bool ok;
+        if (is_nv12(src.format) && is_nv12(dst.format)) {
+            ok = copyNv12(src, src_rect, dst, dst_rect);
+        } else if (is_nv12(src.format)) {
+            ok = convertNv12(src, src_rect, dst, dst_rect);
+        } else {
+            ok = convertPacked(src, src_rect, dst, dst_rect);
+        }
+        image_end_cpu_access(dst, true);
+        image_end_cpu_access(src, false);
+        if (!ok) {
+            return -1;
+        }
+        return (long) (src_rect.area() * image_format_bpp(src.format) + dst_rect.area() * image_format_bpp(dst.format));
+    }
+
+    long letterbox(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                   const cv::Rect &dst_rect) override {
+        // 模型输入的常见情况：一次遍历完成缩放、颜色转换和填充
+        bool aligned = src_rect.x % 2 == 0 && src_rect.y % 2 == 0 && src_rect.width % 2 == 0 &&
+                       src_rect.height % 2 == 0;
+        if (!is_nv12(src.format) || dst.format != RK_FORMAT_RGB_888 || dst.wstride != dst.width || !aligned) {
+            return ImageBackend::letterbox(src, src_rect, dst, dst_rect);
+        }
+        image_begin_cpu_access(src, false);
+        image_begin_cpu_access(dst, true);
+        int64_t moved = nv12_letterbox_rgb(nv12_view(src, src_rect), dst_rect, dst.width, dst.height,
+                                           (uint8_t *) dst.buf);
+        image_end_cpu_access(dst, true);
+        image_end_cpu_access(src, false);
+        return (long) moved;
+    }
+
+private:
+    // NV12之间只支持整幅同尺寸拷贝，解码帧复制用
+    bool copyNv12(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                  const cv::Rect &dst_rect) {
+        if (src_rect != cv::Rect(0, 0, src.width, src.height) || dst_rect != cv::Rect(0, 0, dst.width, dst.height) ||
+            src.width != dst.width || src.height != dst.height) {
+            return false;
+        }
+        const char *src_uv = src.buf + (size_t) src.wstride * src.hstride;
+        char *dst_uv = dst.buf + (size_t) dst.wstride * dst.hstride;
+        for (int y = 0; y < src.height; y++) {
+            memcpy(dst.buf + (size_t) dst.wstride * y, src.buf + (size_t) src.wstride * y, src.width);
+        }
+        for (int y = 0; y < src.height / 2; y++) {
+            memcpy(dst_uv + (size_t) dst.wstride * y, src_uv + (size_t) src.wstride * y, src.width);
+        }
+        return true;
+    }
+
+    bool convertNv12(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                     const cv::Rect &dst_rect) {
+        int code = nv12_conversion(dst.format);
+        if (code < 0) {
+            return false;
+        }
+        // 色度按2x2采样，源区域对齐到偶数
+        cv::Rect rect(src_rect.x & ~1, src_rect.y & ~1, src_rect.width & ~1, src_rect.height & ~1);
+        if (rect.width == 0 || rect.height == 0) {
+            return false;
+        }
+        cv::Mat y_plane = cv::Mat(src.height, src.width, CV_8UC1, src.buf, src.wstride)(rect);
+        cv::Mat uv_plane = cv::Mat(src.height / 2, src.width / 2, CV_8UC2, src.buf + (size_t) src.wstride * src.hstride,
+                                   src.wstride)(cv::Rect(rect.x / 2, rect.y / 2, rect.width / 2, rect.height / 2));
+        cv::Mat out = wrap_packed(dst, dst_rect);
+
+        if (rect.size() == dst_rect.size()) {
+            // 尺寸和类型一致，结果直接写到目标区域
+            cv::cvtColorTwoPlane(y_plane, uv_plane, out, code);
+        } else if (dst_rect.area() < rect.area() && dst_rect.width % 2 == 0 && dst_rect.height % 2 == 0) {
+            // 缩小时先分别缩放Y和UV平面（按NV12布局放在同一块临时缓冲里），只在目标尺寸上做颜色转换
+            cv::Mat planes = scratch_mat(dst_rect.height * 3 / 2, dst_rect.width, CV_8UC1);
+            cv::Mat y_small = planes.rowRange(0, dst_rect.height);
+            cv::Mat uv_small(dst_rect.height / 2, dst_rect.width / 2, CV_8UC2, planes.ptr(dst_rect.height));
+            cv::resize(y_plane, y_small, y_small.size(), 0, 0, cv::INTER_LINEAR);
+            cv::resize(uv_plane, uv_small, uv_small.size(), 0, 0, cv::INTER_LINEAR);
+            cv::cvtColorTwoPlane(y_small, uv_small, out, code);
+        } else {
+            cv::Mat converted = scratch_mat(rect.height, rect.width, out.type());
+            cv::cvtColorTwoPlane(y_plane, uv_plane, converted, code);
+            cv::resize(converted, out, out.size(), 0, 0, cv::INTER_LINEAR);
+        }
+        return true;
+    }
+
+    bool convertPacked(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                       const cv::Rect &dst_rect) {
+        if (packed_type(src.format) < 0 || packed_type(dst.format) < 0) {
+            return false;
+        }
+        int code = src.format == dst.format ? -1 : packed_conversion(src.format, dst.format);
+        if (src.format != dst.format && code < 0) {
+            return false;
+        }
+        cv::Mat in = wrap_packed(src, src_rect);
+        cv::Mat out = wrap_packed(dst, dst_rect);
+        bool scaled = src_rect.size() != dst_rect.size();
+        if (code < 0) {
+            if (scaled) {
+                cv::resize(in, out, out.size(), 0, 0, cv::INTER_LINEAR);
+            } else {
+                in.copyTo(out);
+            }
+            return true;
+        }
+        if (scaled) {
+            // 先按源格式缩放到目标尺寸，再转换颜色
+            cv::Mat resized = scratch_mat(dst_rect.height, dst_rect.width, in.type());
+            cv::resize(in, resized, resized.size(), 0, 0, cv::INTER_LINEAR);
+            in = resized;
+        }
+        cv::cvtColor(in, out, code);
+        return true;
+    }
+};
+
+} // namespace
+
+ImageBackend *create_cpu_image_backend() {
+    return new CpuImageBackend();
+}
@@ -0,0 +1,39 @@
+// RGA图像处理后端：一次RGA操作完成区域裁剪、缩放和颜色转换
+
+#include "image_processor.h"
+
+namespace {
+
+class RgaImageBackend : public ImageBackend {
+public:
+    const char *name() const override {
+        return "rga";
+    }
+
+    long process(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                 const cv::Rect &dst_rect) override {
+        im_rect srect = {src_rect.x, src_rect.y, src_rect.width, src_rect.height};
+        im_rect drect = {dst_rect.x, dst_rect.y, dst_rect.width, dst_rect.height};
+        return rga_convert_region(src, srect, dst, drect);
+    }
+
+    // 填充区、缩放和颜色转换都作为任务放进同一次RGA提交
+    long fanout(const rga_image_t &src, const image_output_t *outputs, int count) override {
+        rga_output_t rga_outputs[IMG_FANOUT_MAX_OUTPUTS];
+        for (int i = 0; i < count; i++) {
+            const cv::Rect &rect = outputs[i].rect;
+            const cv::Rect &src_rect = outputs[i].src_rect;
+            rga_outputs[i].image = outputs[i].image;
+            rga_outputs[i].rect = {rect.x, rect.y, rect.width, rect.height};
+            rga_outputs[i].src_rect = {src_rect.x, src_rect.y, src_rect.width, src_rect.height};
+            rga_outputs[i].fill_outside = outputs[i].letterbox;
+        }
+        return rga_convert_multi(src, rga_outputs, count);
+    }
+};
+
+} // namespace
+
+ImageBackend *create_rga_image_backend() {
+    return new RgaImageBackend();
+}
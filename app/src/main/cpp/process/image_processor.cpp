@@ -0,0 +1,569 @@
+// 图像处理的后端选择、自检和失败回退
+
+#include "image_processor.h"
+
+#include <sys/time.h>
+#include <stdlib.h>
+#include <tuple>
+#include "logging.h"
+#include "dma_buffer.h"
+
+// 首选后端连续失败多少次后切换到另一个后端
+#define IMG_SWITCH_FAILURES 3
+// 自检每个后端运行的次数，第一次包含导入和初始化，计时取后几次的最小值
+#define IMG_SELFTEST_RUNS 3
+// 自检时RGA结果与CPU结果的平均差异上限，超过认为RGA对这种输入处理不正确
+#define IMG_SELFTEST_MAX_DIFF 8.0
+
+static int64_t now_us() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static bool is_nv12(int format) {
+    return format == RK_FORMAT_YCbCr_420_SP;
+}
+
+float image_format_bpp(int format) {
+    switch (format) {
+        case RK_FORMAT_RGB_888:
+        case RK_FORMAT_BGR_888:
+            return 3;
+        case RK_FORMAT_RGBA_8888:
+        case RK_FORMAT_BGRA_8888:
+            return 4;
+        case RK_FORMAT_YCbCr_420_SP:
+            return 1.5f;
+        default:
+            return 0;
+    }
+}
+
+size_t image_buffer_size(const rga_image_t &image) {
+    return (size_t) ((double) image.wstride * image.hstride * image_format_bpp(image.format));
+}
+
+void image_begin_cpu_access(const rga_image_t &image, bool write) {
+    if (image.fd >= 0) {
+        dma_buffer_sync_start(FRAME_BACKEND_DMA_HEAP, image.fd, write);
+    }
+}
+
+void image_end_cpu_access(const rga_image_t &image, bool write) {
+    if (image.fd >= 0) {
+        dma_buffer_sync_end(FRAME_BACKEND_DMA_HEAP, image.fd, write);
+    }
+}
+
+long image_fill_outside(const rga_image_t &image, const cv::Rect &rect) {
+    int bpp = (int) image_format_bpp(image.format);
+    if (bpp < 3 || !image.buf) {
+        return -1;
+    }
+    uint8_t *data = (uint8_t *) image.buf;
+    size_t stride = (size_t) image.wstride * bpp;
+    size_t row_bytes = (size_t) image.width * bpp;
+    long written = 0;
+    // 上下填充区按行清零，stride对齐部分不写
+    int bottom = rect.y + rect.height;
+    for (int y = 0; y < image.height; y++) {
+        if (y >= rect.y && y < bottom) {
+            continue;
+        }
+        memset(data + stride * y, 0, row_bytes);
+        written += (long) row_bytes;
+    }
+    // 左右填充区逐行清零
+    int right = rect.x + rect.width;
+    if (rect.x > 0 || right < image.width) {
+        size_t left_bytes = (size_t) rect.x * bpp;
+        size_t right_bytes = (size_t) (image.width - right) * bpp;
+        for (int y = rect.y; y < bottom; y++) {
+            uint8_t *row = data + stride * y;
+            memset(row, 0, left_bytes);
+            memset(row + (size_t) right * bpp, 0, right_bytes);
+        }
+        written += (long) (left_bytes + right_bytes) * rect.height;
+    }
+    return written;
+}
+
+long ImageBackend::letterbox(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                             const cv::Rect &dst_rect) {
+    // 填充区由CPU清零，DMA-buf在硬件写入前刷回cache，避免脏cache行覆盖硬件的结果
+    image_begin_cpu_access(dst, true);
+    long padded = image_fill_outside(dst, dst_rect);
+    image_end_cpu_access(dst, true);
+    if (padded < 0) {
+        return -1;
+    }
+    long moved = process(src, src_rect, dst, dst_rect);
+    return moved < 0 ? -1 : moved + padded;
+}
+
+namespace {
+
+// 自检用的图像：格式、尺寸和stride与实际调用相同，实际图像是DMA-buf时也按DMA-buf分配
+class SelfTestImage {
+public:
+    SelfTestImage() : backend_(FRAME_BACKEND_HEAP), fd_(-1), vaddr_(nullptr), size_(0) {
+        memset(&image, 0, sizeof(image));
+    }
+
+    ~SelfTestImage() {
+        if (vaddr_) {
+            dma_buffer_free(backend_, fd_, vaddr_, size_);
+        }
+    }
+
+    bool allocate(const rga_image_t &like) {
+        size_ = image_buffer_size(like);
+        backend_ = like.fd >= 0 ? FRAME_BACKEND_DMA_HEAP : FRAME_BACKEND_HEAP;
+        if (dma_buffer_alloc(backend_, size_, &fd_, &vaddr_) != 0 && backend_ != FRAME_BACKEND_HEAP) {
+            backend_ = FRAME_BACKEND_HEAP;
+            dma_buffer_alloc(backend_, size_, &fd_, &vaddr_);
+        }
+        if (!vaddr_) {
+            return false;
+        }
+        image = like;
+        image.fd = fd_;
+        image.buf = (char *) vaddr_;
+        return true;
+    }
+
+    // 平滑的渐变，各种插值方式的结果相差很小，差异大说明后端处理错了
+    void fillPattern() {
+        image_begin_cpu_access(image, true);
+        uint8_t *data = (uint8_t *) image.buf;
+        bool nv12 = is_nv12(image.format);
+        size_t stride = nv12 ? (size_t) image.wstride : (size_t) image.wstride * (int) image_format_bpp(image.format);
+        int rows = nv12 ? image.hstride * 3 / 2 : image.hstride;
+        for (int y = 0; y < rows; y++) {
+            uint8_t *row = data + stride * y;
+            bool chroma = nv12 && y >= image.hstride;
+            int ry = chroma ? (y - image.hstride) * 2 : y;
+            for (size_t x = 0; x < stride; x++) {
+                row[x] = chroma ? (uint8_t) (96 + x * 64 / stride + ry * 32 / image.hstride)
+                                : (uint8_t) (16 + x * 160 / stride + ry * 64 / image.hstride);
+            }
+        }
+        image_end_cpu_access(image, true);
+    }
+
+    rga_image_t image;
+
+private:
+    frame_backend_e backend_;
+    int fd_;
+    void *vaddr_;
+    size_t size_;
+};
+
+// 两幅图rect区域的平均逐字节差异，NV12比较整个缓冲
+double mean_difference(const rga_image_t &a, const rga_image_t &b, const cv::Rect &rect) {
+    image_begin_cpu_access(a, false);
+    image_begin_cpu_access(b, false);
+    const uint8_t *pa = (const uint8_t *) a.buf;
+    const uint8_t *pb = (const uint8_t *) b.buf;
+    int64_t sum = 0;
+    int64_t count = 0;
+    if (is_nv12(a.format)) {
+        size_t size = image_buffer_size(a);
+        for (size_t i = 0; i < size; i++) {
+            sum += abs((int) pa[i] - (int) pb[i]);
+        }
+        count = (int64_t) size;
+    } else {
+        int bpp = (int) image_format_bpp(a.format);
+        size_t stride = (size_t) a.wstride * bpp;
+        for (int y = rect.y; y < rect.y + rect.height; y++) {
+            size_t offset = stride * y + (size_t) rect.x * bpp;
+            for (size_t i = 0; i < (size_t) rect.width * bpp; i++) {
+                sum += abs((int) pa[offset + i] - (int) pb[offset + i]);
+            }
+        }
+        count = (int64_t) rect.width * rect.height * bpp;
+    }
+    image_end_cpu_access(b, false);
+    image_end_cpu_access(a, false);
+    return count > 0 ? (double) sum / count : 0;
+}
+
+bool rect_inside(const cv::Rect &rect, const rga_image_t &image) {
+    return rect.width > 0 && rect.height > 0 && rect.x >= 0 && rect.y >= 0 && rect.x + rect.width <= image.width &&
+           rect.y + rect.height <= image.height;
+}
+
+} // namespace
+
+bool ImageProcessor::Key::operator<(const Key &other) const {
+    return std::tie(op, srcFormat, dstFormat, srcWidth, srcHeight, dstWidth, dstHeight) <
+           std::tie(other.op, other.srcFormat, other.dstFormat, other.srcWidth, other.srcHeight, other.dstWidth,
+                    other.dstHeight);
+}
+
+ImageProcessor &ImageProcessor::getInstance() {
+    // 不析构：进程退出时其它线程可能还在处理图像
+    static ImageProcessor *instance = new ImageProcessor();
+    return *instance;
+}
+
+ImageProcessor::ImageProcessor() : forced_(IMG_BACKEND_AUTO), fanoutFailures_(0) {
+#if defined(__ANDROID__)
+    backends_[IMG_BACKEND_RGA] = create_rga_image_backend();
+#else
+    // 主机上没有RGA，全部走CPU
+    backends_[IMG_BACKEND_RGA] = nullptr;
+#endif
+    backends_[IMG_BACKEND_CPU] = create_cpu_image_backend();
+    for (int i = 0; i < IMG_OP_COUNT; i++) {
+        for (int j = 0; j < IMG_BACKEND_COUNT; j++) {
+            calls_[i][j].store(0);
+            failures_[i][j].store(0);
+            elapsedUs_[i][j].store(0);
+        }
+        fallbacks_[i].store(0);
+    }
+}
+
+const char *ImageProcessor::opName(image_op_e op) {
+    switch (op) {
+        case IMG_OP_CONVERT:
+            return "convert";
+        case IMG_OP_RESIZE:
+            return "resize";
+        case IMG_OP_LETTERBOX:
+            return "letterbox";
+        case IMG_OP_CROP:
+            return "crop";
+        case IMG_OP_BLIT:
+            return "blit";
+        case IMG_OP_FANOUT:
+            return "fanout";
+        default:
+            return "unknown";
+    }
+}
+
+const char *ImageProcessor::backendName(image_backend_e backend) {
+    switch (backend) {
+        case IMG_BACKEND_RGA:
+            return "rga";
+        case IMG_BACKEND_CPU:
+            return "cpu";
+        default:
+            return "auto";
+    }
+}
+
+bool ImageProcessor::hasBackend(image_backend_e backend) const {
+    return backend >= 0 && backend < IMG_BACKEND_COUNT && backends_[backend] != nullptr;
+}
+
+void ImageProcessor::forceBackend(image_backend_e backend) {
+    if (backend != IMG_BACKEND_AUTO && !hasBackend(backend)) {
+        NN_LOG_WARNING("ImageProcessor: backend %s not available", backendName(backend));
+        return;
+    }
+    forced_.store(backend);
+    NN_LOG_INFO("ImageProcessor: backend forced to %s", backendName(backend));
+}
+
+long ImageProcessor::convert(const rga_image_t &src, const rga_image_t &dst, image_backend_e *used) {
+    if (src.width != dst.width || src.height != dst.height) {
+        NN_LOG_ERROR("ImageProcessor: convert size mismatch %dx%d -> %dx%d", src.width, src.height, dst.width,
+                     dst.height);
+        return -1;
+    }
+    return run(IMG_OP_CONVERT, src, cv::Rect(0, 0, src.width, src.height), dst,
+               cv::Rect(0, 0, dst.width, dst.height), used);
+}
+
+long ImageProcessor::resize(const rga_image_t &src, const rga_image_t &dst, image_backend_e *used) {
+    return run(IMG_OP_RESIZE, src, cv::Rect(0, 0, src.width, src.height), dst,
+               cv::Rect(0, 0, dst.width, dst.height), used);
+}
+
+long ImageProcessor::letterbox(const rga_image_t &src, const rga_image_t &dst, const cv::Rect &dst_rect,
+                               image_backend_e *used) {
+    return run(IMG_OP_LETTERBOX, src, cv::Rect(0, 0, src.width, src.height), dst, dst_rect, used);
+}
+
+long ImageProcessor::crop(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                          image_backend_e *used) {
+    return run(IMG_OP_CROP, src, src_rect, dst, cv::Rect(0, 0, dst.width, dst.height), used);
+}
+
+long ImageProcessor::blit(const rga_image_t &src, const rga_image_t &dst, const cv::Rect &dst_rect,
+                          image_backend_e *used) {
+    return run(IMG_OP_BLIT, src, cv::Rect(0, 0, src.width, src.height), dst, dst_rect, used);
+}
+
+image_op_e ImageProcessor::outputOp(const image_output_t &output) {
+    if (output.letterbox) {
+        return IMG_OP_LETTERBOX;
+    }
+    return output.rect == cv::Rect(0, 0, output.image.width, output.image.height) ? IMG_OP_RESIZE : IMG_OP_BLIT;
+}
+
+long ImageProcessor::fanout(const rga_image_t &src, const image_output_t *outputs, int count,
+                            image_backend_e *used) {
+    if (used) {
+        *used = IMG_BACKEND_AUTO;
+    }
+    if (count <= 0 || count > IMG_FANOUT_MAX_OUTPUTS || !src.buf) {
+        NN_LOG_ERROR("ImageProcessor: fanout invalid source or %d outputs", count);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!outputs[i].image.buf || !rect_inside(outputs[i].rect, outputs[i].image) ||
+            !rect_inside(outputs[i].src_rect, src)) {
+            NN_LOG_ERROR("ImageProcessor: fanout output %d invalid image or region", i);
+            return -1;
+        }
+    }
+
+    // 是否合并沿用各输出单独处理时的自检和失败切换结果，任一输出不适合RGA就逐个处理
+    bool together = count > 1 && hasBackend(IMG_BACKEND_RGA) && forced_.load() != IMG_BACKEND_CPU &&
+                    fanoutFailures_.load() < IMG_SWITCH_FAILURES;
+    for (int i = 0; i < count && together; i++) {
+        image_op_e op = outputOp(outputs[i]);
+        const rga_image_t &dst = outputs[i].image;
+        const cv::Rect &src_rect = outputs[i].src_rect;
+        Key key = {op, src.format, dst.format, src_rect.width, src_rect.height, outputs[i].rect.width,
+                   outputs[i].rect.height};
+        together = choose(key, op, src, src_rect, dst, outputs[i].rect) == IMG_BACKEND_RGA;
+    }
+    if (together) {
+        int64_t start = now_us();
+        long moved = backends_[IMG_BACKEND_RGA]->fanout(src, outputs, count);
+        elapsedUs_[IMG_OP_FANOUT][IMG_BACKEND_RGA] += now_us() - start;
+        calls_[IMG_OP_FANOUT][IMG_BACKEND_RGA]++;
+        if (moved >= 0) {
+            fanoutFailures_.store(0);
+            if (used) {
+                *used = IMG_BACKEND_RGA;
+            }
+            return moved;
+        }
+        failures_[IMG_OP_FANOUT][IMG_BACKEND_RGA]++;
+        fallbacks_[IMG_OP_FANOUT]++;
+        if (++fanoutFailures_ == IMG_SWITCH_FAILURES) {
+            NN_LOG_WARNING("ImageProcessor: fanout %dx%d to %d outputs failed %d times on rga, processing "
+                           "outputs separately", src.width, src.height, count, IMG_SWITCH_FAILURES);
+        }
+    }
+
+    long total = 0;
+    for (int i = 0; i < count; i++) {
+        image_backend_e backend = IMG_BACKEND_AUTO;
+        long moved = run(outputOp(outputs[i]), src, outputs[i].src_rect, outputs[i].image, outputs[i].rect, &backend);
+        if (moved < 0) {
+            return -1;
+        }
+        if (i == 0 && used) {
+            *used = backend;
+        }
+        total += moved;
+    }
+    return total;
+}
+
+long ImageProcessor::run(image_op_e op, const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                         const cv::Rect &dst_rect, image_backend_e *used) {
+    if (used) {
+        *used = IMG_BACKEND_AUTO;
+    }
+    if (!src.buf || !dst.buf || !rect_inside(src_rect, src) || !rect_inside(dst_rect, dst)) {
+        NN_LOG_ERROR("ImageProcessor: %s invalid image or region (%d,%d %dx%d in %dx%d -> %d,%d %dx%d in %dx%d)",
+                     opName(op), src_rect.x, src_rect.y, src_rect.width, src_rect.height, src.width, src.height,
+                     dst_rect.x, dst_rect.y, dst_rect.width, dst_rect.height, dst.width, dst.height);
+        return -1;
+    }
+
+    Key key = {op, src.format, dst.format, src_rect.width, src_rect.height, dst_rect.width, dst_rect.height};
+    image_backend_e first = choose(key, op, src, src_rect, dst, dst_rect);
+    long moved = execute(first, op, src, src_rect, dst, dst_rect);
+    recordResult(key, first, moved >= 0);
+    if (moved >= 0) {
+        if (used) {
+            *used = first;
+        }
+        return moved;
+    }
+
+    // 强制指定后端时不回退，便于暴露问题
+    image_backend_e second = first == IMG_BACKEND_RGA ? IMG_BACKEND_CPU : IMG_BACKEND_RGA;
+    if (forced_.load() != IMG_BACKEND_AUTO || !hasBackend(second)) {
+        return -1;
+    }
+    uint64_t fallbacks = ++fallbacks_[op];
+    if (fallbacks == 1 || fallbacks % 100 == 0) {
+        NN_LOG_WARNING("ImageProcessor: %s %dx%d -> %dx%d failed on %s, falling back to %s (%llu fallbacks)",
+                       opName(op), src_rect.width, src_rect.height, dst_rect.width, dst_rect.height,
+                       backendName(first), backendName(second), (unsigned long long) fallbacks);
+    }
+    moved = execute(second, op, src, src_rect, dst, dst_rect);
+    recordResult(key, second, moved >= 0);
+    if (moved >= 0 && used) {
+        *used = second;
+    }
+    return moved;
+}
+
+long ImageProcessor::execute(image_backend_e backend, image_op_e op, const rga_image_t &src,
+                             const cv::Rect &src_rect, const rga_image_t &dst, const cv::Rect &dst_rect) {
+    ImageBackend *impl = backends_[backend];
+    int64_t start = now_us();
+    long moved = op == IMG_OP_LETTERBOX ? impl->letterbox(src, src_rect, dst, dst_rect)
+                                        : impl->process(src, src_rect, dst, dst_rect);
+    elapsedUs_[op][backend] += now_us() - start;
+    calls_[op][backend]++;
+    if (moved < 0) {
+        failures_[op][backend]++;
+    }
+    return moved;
+}
+
+image_backend_e ImageProcessor::choose(const Key &key, image_op_e op, const rga_image_t &src,
+                                       const cv::Rect &src_rect, const rga_image_t &dst, const cv::Rect &dst_rect) {
+    int forced = forced_.load();
+    if (forced != IMG_BACKEND_AUTO) {
+        return (image_backend_e) forced;
+    }
+    if (!hasBackend(IMG_BACKEND_RGA)) {
+        return IMG_BACKEND_CPU;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<Key, Choice>::iterator it = choices_.find(key);
+        if (it != choices_.end()) {
+            return it->second.preferred;
+        }
+    }
+
+    // 自检只在每种Key第一次出现时做一次，码流分辨率确定后的头几帧完成
+    // 其他线程正在自检时不等待，这一帧先用CPU，下一帧再检查
+    std::unique_lock<std::mutex> selfTestLock(selfTestMutex_, std::try_to_lock);
+    if (!selfTestLock.owns_lock()) {
+        return IMG_BACKEND_CPU;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<Key, Choice>::iterator it = choices_.find(key);
+        if (it != choices_.end()) {
+            return it->second.preferred;
+        }
+    }
+    Choice choice = selfTest(op, src, src_rect, dst, dst_rect);
+    std::lock_guard<std::mutex> lock(mutex_);
+    choices_[key] = choice;
+    return choice.preferred;
+}
+
+ImageProcessor::Choice ImageProcessor::selfTest(image_op_e op, const rga_image_t &src, const cv::Rect &src_rect,
+                                                const rga_image_t &dst, const cv::Rect &dst_rect) {
+    Choice choice;
+    choice.preferred = IMG_BACKEND_CPU;
+    for (int i = 0; i < IMG_BACKEND_COUNT; i++) {
+        choice.failures[i] = 0;
+        choice.working[i] = false;
+        choice.selfTestUs[i] = -1;
+    }
+
+    SelfTestImage testSrc;
+    SelfTestImage testDst[IMG_BACKEND_COUNT];
+    if (!testSrc.allocate(src)) {
+        NN_LOG_ERROR("ImageProcessor: self-test allocation failed, using cpu");
+        choice.working[IMG_BACKEND_CPU] = true;
+        return choice;
+    }
+    testSrc.fillPattern();
+
+    for (int i = 0; i < IMG_BACKEND_COUNT; i++) {
+        ImageBackend *impl = backends_[i];
+        if (!impl || !testDst[i].allocate(dst)) {
+            continue;
+        }
+        int64_t best = -1;
+        bool ok = true;
+        for (int run = 0; run < IMG_SELFTEST_RUNS && ok; run++) {
+            int64_t start = now_us();
+            long moved = op == IMG_OP_LETTERBOX
+                         ? impl->letterbox(testSrc.image, src_rect, testDst[i].image, dst_rect)
+                         : impl->process(testSrc.image, src_rect, testDst[i].image, dst_rect);
+            int64_t elapsed = now_us() - start;
+            ok = moved >= 0;
+            if (run > 0 && (best < 0 || elapsed < best)) {
+                best = elapsed;
+            }
+        }
+        choice.working[i] = ok;
+        choice.selfTestUs[i] = ok ? (double) best : -1;
+    }
+
+    // CPU的结果作为参考，RGA对某些格式、尺寸或对齐会输出错误的图像而不报错
+    double diff = 0;
+    if (choice.working[IMG_BACKEND_RGA] && choice.working[IMG_BACKEND_CPU]) {
+        diff = mean_difference(testDst[IMG_BACKEND_RGA].image, testDst[IMG_BACKEND_CPU].image, dst_rect);
+        if (diff > IMG_SELFTEST_MAX_DIFF) {
+            choice.working[IMG_BACKEND_RGA] = false;
+        }
+    }
+
+    if (choice.working[IMG_BACKEND_RGA] &&
+        (!choice.working[IMG_BACKEND_CPU] || choice.selfTestUs[IMG_BACKEND_RGA] <= choice.selfTestUs[IMG_BACKEND_CPU])) {
+        choice.preferred = IMG_BACKEND_RGA;
+    }
+    if (!choice.working[IMG_BACKEND_RGA] && !choice.working[IMG_BACKEND_CPU]) {
+        NN_LOG_ERROR("ImageProcessor: %s 0x%x -> 0x%x %dx%d -> %dx%d failed on all backends", opName(op),
+                     src.format, dst.format, src_rect.width, src_rect.height, dst_rect.width, dst_rect.height);
+    }
+    NN_LOG_INFO("ImageProcessor: %s 0x%x -> 0x%x %dx%d -> %dx%d rga=%.2fms%s cpu=%.2fms%s diff=%.2f, using %s",
+                opName(op), src.format, dst.format, src_rect.width, src_rect.height, dst_rect.width,
+                dst_rect.height, choice.selfTestUs[IMG_BACKEND_RGA] / 1000.0,
+                choice.working[IMG_BACKEND_RGA] ? "" : "(failed)", choice.selfTestUs[IMG_BACKEND_CPU] / 1000.0,
+                choice.working[IMG_BACKEND_CPU] ? "" : "(failed)", diff, backendName(choice.preferred));
+    return choice;
+}
+
+void ImageProcessor::recordResult(const Key &key, image_backend_e backend, bool ok) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<Key, Choice>::iterator it = choices_.find(key);
+    if (it == choices_.end()) {
+        return;
+    }
+    Choice &choice = it->second;
+    if (ok) {
+        choice.failures[backend] = 0;
+        return;
+    }
+    choice.failures[backend]++;
+    image_backend_e other = backend == IMG_BACKEND_RGA ? IMG_BACKEND_CPU : IMG_BACKEND_RGA;
+    if (backend == choice.preferred && choice.failures[backend] >= IMG_SWITCH_FAILURES && hasBackend(other)) {
+        choice.preferred = other;
+        choice.failures[backend] = 0;
+        NN_LOG_WARNING("ImageProcessor: %s %dx%d -> %dx%d switched to %s after %d failures on %s",
+                       opName((image_op_e) key.op), key.srcWidth, key.srcHeight, key.dstWidth, key.dstHeight,
+                       backendName(other), IMG_SWITCH_FAILURES, backendName(backend));
+    }
+}
+
+void ImageProcessor::logStats() {
+    for (int op = 0; op < IMG_OP_COUNT; op++) {
+        uint64_t rgaCalls = calls_[op][IMG_BACKEND_RGA].load();
+        uint64_t cpuCalls = calls_[op][IMG_BACKEND_CPU].load();
+        if (rgaCalls == 0 && cpuCalls == 0) {
+            continue;
+        }
+        NN_LOG_DEBUG("ImageProcessor: %s rga=%llu (%.2f ms avg, %llu failed) cpu=%llu (%.2f ms avg, %llu failed) "
+                     "fallbacks=%llu", opName((image_op_e) op), (unsigned long long) rgaCalls,
+                     rgaCalls > 0 ? elapsedUs_[op][IMG_BACKEND_RGA].load() / 1000.0 / rgaCalls : 0.0,
+                     (unsigned long long) failures_[op][IMG_BACKEND_RGA].load(), (unsigned long long) cpuCalls,
+                     cpuCalls > 0 ? elapsedUs_[op][IMG_BACKEND_CPU].load() / 1000.0 / cpuCalls : 0.0,
+                     (unsigned long long) failures_[op][IMG_BACKEND_CPU].load(),
+                     (unsigned long long) fallbacks_[op].load());
+    }
+}
@@ -0,0 +1,167 @@
+// 图像处理：颜色转换、缩放、letterbox、裁剪和贴图，RGA和CPU两个后端
+
+#ifndef RK3588_DEMO_IMAGE_PROCESSOR_H
+#define RK3588_DEMO_IMAGE_PROCESSOR_H
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include "rga_utils.h"
+
+typedef enum {
+    IMG_OP_CONVERT = 0,     // 尺寸相同，只做格式转换或拷贝
+    IMG_OP_RESIZE = 1,      // 整幅缩放，同时完成格式转换
+    IMG_OP_LETTERBOX = 2,   // 整幅缩放到目标区域，其余部分填0
+    IMG_OP_CROP = 3,        // 源图的一个区域缩放到整幅目标图
+    IMG_OP_BLIT = 4,        // 整幅缩放到目标区域，其余部分不写
+    IMG_OP_FANOUT = 5,      // 同一源图一次提交输出到多幅目标图，只用于统计
+    IMG_OP_COUNT = 6,
+} image_op_e;
+
+typedef enum {
+    IMG_BACKEND_AUTO = -1,  // 按自检结果选择
+    IMG_BACKEND_RGA = 0,
+    IMG_BACKEND_CPU = 1,
+    IMG_BACKEND_COUNT = 2,
+} image_backend_e;
+
+// 多输出处理中的一个输出：源图src_rect区域缩放到image的rect区域；letterbox时rect以外填0，否则不写
+typedef struct {
+    rga_image_t image;
+    cv::Rect rect;
+    bool letterbox;
+    cv::Rect src_rect;
+} image_output_t;
+
+#define IMG_FANOUT_MAX_OUTPUTS 8
+#define IMG_FANOUT_MAX_REGIONS (IMG_FANOUT_MAX_OUTPUTS - 1)    // 一次预处理最多的区域数，留一个输出给显示图
+
+// 后端接口，rga_image_t中fd >= 0的图像都是DMA-buf
+// 返回读写的字节数，不支持的格式或失败返回-1，不能退出进程
+class ImageBackend {
+public:
+    virtual ~ImageBackend() {}
+
+    virtual const char *name() const = 0;
+
+    // 源图src_rect区域缩放并转换到目标图dst_rect区域，目标图其余部分不写
+    virtual long process(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                         const cv::Rect &dst_rect) = 0;
+
+    // 源图src_rect区域缩放到dst_rect区域，其余部分填0；默认先由CPU把dst_rect以外清零，再process
+    virtual long letterbox(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                           const cv::Rect &dst_rect);
+
+    // 所有输出在一次提交中完成；不支持的后端返回-1，由ImageProcessor逐个处理
+    virtual long fanout(const rga_image_t &/*src*/, const image_output_t * /*outputs*/, int /*count*/) {
+        return -1;
+    }
+};
+
+ImageBackend *create_cpu_image_backend();
+// 只在Android上编译和创建
+ImageBackend *create_rga_image_backend();
+
+// CPU读写DMA-buf图像前后做cache同步，没有fd时什么都不做
+void image_begin_cpu_access(const rga_image_t &image, bool write);
+void image_end_cpu_access(const rga_image_t &image, bool write);
+
+// 每像素字节数，NV12为1.5；不支持的格式返回0
+float image_format_bpp(int format);
+
+// 图像所占的缓冲大小，包括stride对齐部分
+size_t image_buffer_size(const rga_image_t &image);
+
+// 把rect以外的部分清零，只支持RGB类的打包格式，返回写入的字节数
+long image_fill_outside(const rga_image_t &image, const cv::Rect &rect);
+
+// 统一的图像处理入口：每种操作、格式和分辨率第一次出现时两个后端各跑一次自检，
+// 结果正确且更快的后端作为首选；调用失败时自动改用另一个后端，首选连续失败多次后切换
+class ImageProcessor {
+public:
+    static ImageProcessor &getInstance();
+
+    // 以下接口返回读写的字节数，失败返回-1；used不为空时返回实际完成处理的后端
+    long convert(const rga_image_t &src, const rga_image_t &dst, image_backend_e *used = nullptr);
+
+    long resize(const rga_image_t &src, const rga_image_t &dst, image_backend_e *used = nullptr);
+
+    long letterbox(const rga_image_t &src, const rga_image_t &dst, const cv::Rect &dst_rect,
+                   image_backend_e *used = nullptr);
+
+    long crop(const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+              image_backend_e *used = nullptr);
+
+    long blit(const rga_image_t &src, const rga_image_t &dst, const cv::Rect &dst_rect,
+              image_backend_e *used = nullptr);
+
+    // 同一源图输出到多幅目标图：每个输出单独处理时都选RGA则合并成一次RGA提交，否则逐个处理
+    // 任一输出失败返回-1；used返回第一个输出实际使用的后端
+    long fanout(const rga_image_t &src, const image_output_t *outputs, int count, image_backend_e *used = nullptr);
+
+    // 强制使用某个后端，主机测试和问题排查用；IMG_BACKEND_AUTO恢复自动选择
+    void forceBackend(image_backend_e backend);
+
+    bool hasBackend(image_backend_e backend) const;
+
+    void logStats();
+
+    static const char *opName(image_op_e op);
+
+    static const char *backendName(image_backend_e backend);
+
+private:
+    // 选择按操作、格式和源/目标区域尺寸区分
+    struct Key {
+        int op;
+        int srcFormat;
+        int dstFormat;
+        int srcWidth;
+        int srcHeight;
+        int dstWidth;
+        int dstHeight;
+
+        bool operator<(const Key &other) const;
+    };
+
+    struct Choice {
+        image_backend_e preferred;
+        int failures[IMG_BACKEND_COUNT];   // 连续失败次数
+        bool working[IMG_BACKEND_COUNT];   // 自检是否通过
+        double selfTestUs[IMG_BACKEND_COUNT];
+    };
+
+    ImageProcessor();
+
+    long run(image_op_e op, const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+             const cv::Rect &dst_rect, image_backend_e *used);
+
+    long execute(image_backend_e backend, image_op_e op, const rga_image_t &src, const cv::Rect &src_rect,
+                 const rga_image_t &dst, const cv::Rect &dst_rect);
+
+    image_backend_e choose(const Key &key, image_op_e op, const rga_image_t &src, const cv::Rect &src_rect,
+                           const rga_image_t &dst, const cv::Rect &dst_rect);
+
+    Choice selfTest(image_op_e op, const rga_image_t &src, const cv::Rect &src_rect, const rga_image_t &dst,
+                    const cv::Rect &dst_rect);
+
+    void recordResult(const Key &key, image_backend_e backend, bool ok);
+
+    static image_op_e outputOp(const image_output_t &output);
+
+    ImageBackend *backends_[IMG_BACKEND_COUNT];
+    std::atomic<int> forced_;
+    std::mutex mutex_;          // 保护choices_
+    std::mutex selfTestMutex_;  // 自检串行执行，计时互不干扰；同一个Key只测一次
+    std::map<Key, Choice> choices_;
+
+    std::atomic<uint64_t> calls_[IMG_OP_COUNT][IMG_BACKEND_COUNT];
+    std::atomic<uint64_t> failures_[IMG_OP_COUNT][IMG_BACKEND_COUNT];
+    std::atomic<uint64_t> fallbacks_[IMG_OP_COUNT];
+    std::atomic<int64_t> elapsedUs_[IMG_OP_COUNT][IMG_BACKEND_COUNT];
+    std::atomic<int> fanoutFailures_;   // 合并提交连续失败次数，达到切换阈值后不再合并
+};
+
+#endif // RK3588_DEMO_IMAGE_PROCESSOR_H
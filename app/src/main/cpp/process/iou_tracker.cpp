@@ -0,0 +1,136 @@
+#include "iou_tracker.h"
+
+#include <algorithm>
+#include "detection_merge.h"
+
+namespace {
+
+struct Candidate {
+    float iou;
+    int detection;
+    int track;
+};
+
+cv::Point2f center(const cv::Rect2f &box) {
+    return cv::Point2f(box.x + box.width / 2, box.y + box.height / 2);
+}
+
+cv::Rect to_rect(const cv::Rect2f &box) {
+    return cv::Rect(cvRound(box.x), cvRound(box.y), cvRound(box.width), cvRound(box.height));
+}
+
+} // namespace
+
+IouTracker::IouTracker() : nextId_(0), lastPts_(0), hasPts_(false) {}
+
+void IouTracker::clear() {
+    tracks_.clear();
+    hasPts_ = false;
+}
+
+cv::Rect2f IouTracker::predictBox(const track_t &track, uint64_t pts) const {
+    float dt = pts > track.pts ? (float) std::min<uint64_t>(pts - track.pts, TRACK_MAX_PREDICT_MS) : 0.f;
+    cv::Rect2f box = track.box;
+    box.x += track.velocity.x * dt;
+    box.y += track.velocity.y * dt;
+    return box;
+}
+
+void IouTracker::predict(uint64_t pts, std::vector<Detection> &objects) const {
+    objects.clear();
+    for (const track_t &track: tracks_) {
+        Detection obj;
+        obj.class_id = track.classId;
+        obj.confidence = track.confidence;
+        obj.box = to_rect(predictBox(track, pts));
+        objects.push_back(obj);
+    }
+}
+
+void IouTracker::associate(uint64_t pts, const std::vector<Detection> &objects, std::vector<int> &matches) const {
+    std::vector<Candidate> candidates;
+    std::vector<cv::Rect> predicted(tracks_.size());
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        predicted[t] = to_rect(predictBox(tracks_[t], pts));
+    }
+    for (size_t d = 0; d < objects.size(); d++) {
+        for (size_t t = 0; t < tracks_.size(); t++) {
+            if (objects[d].class_id != tracks_[t].classId) {
+                continue;
+            }
+            float iou = detection_iou(objects[d].box, predicted[t]);
+            if (iou >= TRACK_MATCH_IOU) {
+                Candidate candidate = {iou, (int) d, (int) t};
+                candidates.push_back(candidate);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.iou > b.iou;
+    });
+    matches.assign(objects.size(), -1);
+    std::vector<bool> taken(tracks_.size(), false);
+    for (const Candidate &candidate: candidates) {
+        if (matches[candidate.detection] < 0 && !taken[candidate.track]) {
+            matches[candidate.detection] = candidate.track;
+            taken[candidate.track] = true;
+        }
+    }
+}
+
+int IouTracker::countMatched(uint64_t pts, const std::vector<Detection> &objects) const {
+    std::vector<int> matches;
+    associate(pts, objects, matches);
+    return (int) std::count_if(matches.begin(), matches.end(), [](int m) { return m >= 0; });
+}
+
+bool IouTracker::update(uint64_t pts, const std::vector<Detection> &objects) {
+    if (hasPts_ && pts < lastPts_) {
+        return false;
+    }
+    hasPts_ = true;
+    lastPts_ = pts;
+
+    std::vector<int> matches;
+    associate(pts, objects, matches);
+    std::vector<bool> matched(tracks_.size(), false);
+    for (size_t d = 0; d < objects.size(); d++) {
+        cv::Rect2f box(objects[d].box);
+        if (matches[d] < 0) {
+            track_t track;
+            track.id = nextId_++;
+            track.classId = objects[d].class_id;
+            track.confidence = objects[d].confidence;
+            track.box = box;
+            track.velocity = cv::Point2f(0, 0);
+            track.pts = pts;
+            track.hits = 1;
+            track.misses = 0;
+            tracks_.push_back(track);
+            continue;
+        }
+        track_t &track = tracks_[matches[d]];
+        matched[matches[d]] = true;
+        if (pts > track.pts) {
+            cv::Point2f velocity = (center(box) - center(track.box)) * (1.f / (float) (pts - track.pts));
+            track.velocity = track.velocity * (1 - TRACK_VELOCITY_ALPHA) + velocity * TRACK_VELOCITY_ALPHA;
+        }
+        track.box = box;
+        track.confidence = objects[d].confidence;
+        track.pts = pts;
+        track.hits++;
+        track.misses = 0;
+    }
+    // matched只覆盖更新前已有的目标，新建的目标在它之后
+    size_t existing = matched.size();
+    std::vector<track_t> kept;
+    kept.reserve(tracks_.size());
+    for (size_t t = 0; t < tracks_.size(); t++) {
+        if (t < existing && !matched[t] && ++tracks_[t].misses > TRACK_MAX_MISSES) {
+            continue;
+        }
+        kept.push_back(tracks_[t]);
+    }
+    tracks_.swap(kept);
+    return true;
+}
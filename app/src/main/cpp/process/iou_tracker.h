@@ -0,0 +1,59 @@
+// 按IoU关联的轻量多目标跟踪：匀速预测框的位置，供检测帧之间只对目标附近区域推理
+
+#ifndef RK3588_DEMO_IOU_TRACKER_H
+#define RK3588_DEMO_IOU_TRACKER_H
+
+#include <vector>
+#include <stdint.h>
+#include "yolo_datatype.h"
+
+#define TRACK_MATCH_IOU 0.3f        // 同类且预测框与检测框IoU超过它视为同一目标
+#define TRACK_MAX_MISSES 2          // 连续这么多帧没有关联上就删除
+#define TRACK_VELOCITY_ALPHA 0.5f   // 速度的平滑系数
+#define TRACK_MAX_PREDICT_MS 1000   // 预测时间最多外推这么久，时间戳跳变时不至于把框推出画面
+
+typedef struct {
+    int id;
+    int classId;
+    float confidence;
+    cv::Rect2f box;         // 最后一次关联时的框
+    cv::Point2f velocity;   // 框中心每毫秒的位移
+    uint64_t pts;           // 最后一次关联的时间戳（毫秒）
+    int hits;
+    int misses;
+} track_t;
+
+// 不加锁，由调用方保证串行访问
+class IouTracker {
+public:
+    IouTracker();
+
+    // 所有跟踪目标预测到pts时刻的框
+    void predict(uint64_t pts, std::vector<Detection> &objects) const;
+
+    // 用一帧的检测结果更新：贪心关联，未关联的检测新建目标，未关联的目标累计丢失次数
+    // 比上一次更新更早的帧（流水线中乱序完成）不更新，返回false
+    bool update(uint64_t pts, const std::vector<Detection> &objects);
+
+    // objects中能关联到某个跟踪目标（预测到pts）的个数
+    int countMatched(uint64_t pts, const std::vector<Detection> &objects) const;
+
+    void clear();
+
+    size_t size() const {
+        return tracks_.size();
+    }
+
+private:
+    cv::Rect2f predictBox(const track_t &track, uint64_t pts) const;
+
+    // 同类按IoU从大到小贪心关联，matches[i]为第i个检测关联到的目标下标，没有为-1
+    void associate(uint64_t pts, const std::vector<Detection> &objects, std::vector<int> &matches) const;
+
+    std::vector<track_t> tracks_;
+    int nextId_;
+    uint64_t lastPts_;
+    bool hasPts_;
+};
+
+#endif // RK3588_DEMO_IOU_TRACKER_H
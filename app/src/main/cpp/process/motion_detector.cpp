@@ -0,0 +1,231 @@
+#include "motion_detector.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <string.h>
+#include <sys/time.h>
+#include "image_processor.h"
+#include "logging.h"
+
+namespace {
+
+int64_t now_us() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// 格子内采样行的像素和，16位累加：每列最多4行x2x255，格子不超过512像素宽就不会溢出
+unsigned cell_sum(const uint8_t *const rows[MOTION_ROWS_PER_CELL], int x0, int width) {
+    unsigned sum = 0;
+    int x = 0;
+#if CV_SIMD128
+    cv::v_uint16x8 acc = cv::v_setzero_u16();
+    for (; x + 16 <= width; x += 16) {
+        for (int k = 0; k < MOTION_ROWS_PER_CELL; k++) {
+            cv::v_uint16x8 lo, hi;
+            cv::v_expand(cv::v_load(rows[k] + x0 + x), lo, hi);
+            acc += lo + hi;
+        }
+    }
+    sum = cv::v_reduce_sum(acc);
+#endif
+    for (; x < width; x++) {
+        for (int k = 0; k < MOTION_ROWS_PER_CELL; k++) {
+            sum += rows[k][x0 + x];
+        }
+    }
+    return sum;
+}
+
+// 与背景比较：返回变化的格子数，identical返回是否与上一帧完全相同；背景按1/4的权重向当前帧靠拢
+int compare_grid(const uint8_t *grid, const uint8_t *previous, uint8_t *background, int count, bool &identical) {
+    int changed = 0;
+    int i = 0;
+    uint8_t maxDiff = 0;
+#if CV_SIMD128
+    cv::v_uint8x16 threshold = cv::v_setall_u8(MOTION_CELL_DIFF);
+    cv::v_uint8x16 one = cv::v_setall_u8(1);
+    cv::v_uint8x16 frameDiff = cv::v_setzero_u8();
+    for (; i + 16 <= count; i += 16) {
+        cv::v_uint8x16 cur = cv::v_load(grid + i);
+        cv::v_uint8x16 bg = cv::v_load(background + i);
+        changed += (int) cv::v_reduce_sum((cv::v_absdiff(cur, bg) > threshold) & one);
+        frameDiff = cv::v_max(frameDiff, cv::v_absdiff(cur, cv::v_load(previous + i)));
+        cv::v_uint16x8 bg0, bg1, cur0, cur1;
+        cv::v_expand(bg, bg0, bg1);
+        cv::v_expand(cur, cur0, cur1);
+        cv::v_store(background + i, cv::v_rshr_pack<2>(bg0 + bg0 + bg0 + cur0, bg1 + bg1 + bg1 + cur1));
+    }
+    maxDiff = (uint8_t) cv::v_reduce_max(frameDiff);
+#endif
+    for (; i < count; i++) {
+        int bg = background[i];
+        if (std::abs(grid[i] - bg) > MOTION_CELL_DIFF) {
+            changed++;
+        }
+        maxDiff = std::max(maxDiff, (uint8_t) std::abs(grid[i] - previous[i]));
+        background[i] = (uint8_t) ((bg * 3 + grid[i] + 2) >> 2);
+    }
+    identical = maxDiff == 0;
+    return changed;
+}
+
+} // namespace
+
+MotionDetector::MotionDetector() : threshold_(MOTION_DEFAULT_THRESHOLD), keepAliveMs_(MOTION_DEFAULT_KEEPALIVE_MS),
+                                   resetPending_(false), frameWidth_(0), frameHeight_(0), cell_(0), gridWidth_(0),
+                                   gridHeight_(0), hasBackground_(false), lastInferMs_(0), lastMotionMs_(0),
+                                   unchangedSinceMs_(0), lastSampleMs_(0), frozen_(false), moving_(true), motion_(0), analyzed_(0), gated_(0),
+                                   keepAlive_(0), frozenEvents_(0), costUs_(0) {}
+
+void MotionDetector::configure(float threshold, int keepAliveMs) {
+    threshold_.store(threshold);
+    keepAliveMs_.store(std::max(keepAliveMs, 0));
+}
+
+void MotionDetector::reset() {
+    resetPending_.store(true);
+    frozen_.store(false);
+}
+
+// 每个格子取MOTION_ROWS_PER_CELL行、格子宽度的像素求平均，格子边长为16的倍数便于向量化
+void MotionDetector::downsample(const rga_image_t &frame) {
+    const uint8_t *y = (const uint8_t *) frame.buf;
+    int rowStep = cell_ / MOTION_ROWS_PER_CELL;
+    unsigned divisor = (unsigned) (cell_ * MOTION_ROWS_PER_CELL);
+    for (int gy = 0; gy < gridHeight_; gy++) {
+        const uint8_t *rows[MOTION_ROWS_PER_CELL];
+        for (int k = 0; k < MOTION_ROWS_PER_CELL; k++) {
+            rows[k] = y + (size_t) (gy * cell_ + k * rowStep + rowStep / 2) * frame.wstride;
+        }
+        uint8_t *out = grid_.data() + gy * gridWidth_;
+        for (int gx = 0; gx < gridWidth_; gx++) {
+            out[gx] = (uint8_t) ((cell_sum(rows, gx * cell_, cell_) + divisor / 2) / divisor);
+        }
+    }
+}
+
+int MotionDetector::sample(const rga_image_t &frame, int64_t nowMs) {
+    if (!frame.buf || frame.format != RK_FORMAT_YCbCr_420_SP || frame.width < 16 || frame.height < 16) {
+        return -1;
+    }
+    if (resetPending_.exchange(false)) {
+        hasBackground_ = false;
+    }
+    if (frame.width != frameWidth_ || frame.height != frameHeight_) {
+        frameWidth_ = frame.width;
+        frameHeight_ = frame.height;
+        cell_ = std::max(16, (frame.width / MOTION_MAX_GRID_W + 15) & ~15);
+        gridWidth_ = std::max(frame.width / cell_, 1);
+        gridHeight_ = std::max(frame.height / cell_, 1);
+        if (gridHeight_ * cell_ > frame.height) {
+            cell_ = 16;
+            gridWidth_ = frame.width / cell_;
+            gridHeight_ = frame.height / cell_;
+        }
+        grid_.assign(gridWidth_ * gridHeight_, 0);
+        hasBackground_ = false;
+        NN_LOG_DEBUG("MotionDetector: %dx%d -> %dx%d grid of %d px cells", frame.width, frame.height, gridWidth_,
+                     gridHeight_, cell_);
+    }
+
+    image_begin_cpu_access(frame, false);
+    downsample(frame);
+    image_end_cpu_access(frame, false);
+
+    int cells = (int) grid_.size();
+    int changed = cells;
+    bool identical = false;
+    if (!hasBackground_) {
+        // 第一帧（或分辨率变化、流重启后）作为背景，并且送推理
+        background_ = grid_;
+        previous_ = grid_;
+        hasBackground_ = true;
+        lastMotionMs_ = nowMs;
+        unchangedSinceMs_ = nowMs;
+        frozen_.store(false);
+    } else {
+        changed = compare_grid(grid_.data(), previous_.data(), background_.data(), cells, identical);
+        previous_.swap(grid_);
+    }
+    float motion = (float) changed / cells;
+    motion_.store(motion);
+
+    // 冻结：解码器输出的画面完全不变，交给卡住检测重启码流
+    if (!identical) {
+        unchangedSinceMs_ = nowMs;
+    }
+    bool frozen = nowMs - unchangedSinceMs_ >= MOTION_FROZEN_MS;
+    if (frozen != frozen_.load()) {
+        frozen_.store(frozen);
+        if (frozen) {
+            frozenEvents_++;
+            NN_LOG_WARNING("MotionDetector: %dx%d stream frozen for %lld ms", frameWidth_, frameHeight_,
+                           (long long) (nowMs - unchangedSinceMs_));
+        } else {
+            NN_LOG_INFO("MotionDetector: %dx%d stream resumed", frameWidth_, frameHeight_);
+        }
+    }
+    lastSampleMs_ = nowMs;
+    return changed;
+}
+
+void MotionDetector::observe(const rga_image_t &frame) {
+    int64_t nowMs = now_us() / 1000;
+    if (hasBackground_ && !resetPending_.load() && nowMs - lastSampleMs_ < MOTION_OBSERVE_MS) {
+        return;
+    }
+    sample(frame, nowMs);
+}
+
+bool MotionDetector::analyze(const rga_image_t &frame) {
+    int64_t start = now_us();
+    int64_t nowMs = start / 1000;
+    int changed = sample(frame, nowMs);
+    if (changed < 0) {
+        return true;
+    }
+    int cells = (int) grid_.size();
+
+    float threshold = threshold_.load();
+    if (threshold <= 0 || changed >= std::max(1.f, threshold * cells)) {
+        lastMotionMs_ = nowMs;
+    }
+    bool infer = nowMs - lastMotionMs_ <= MOTION_HOLD_MS;
+    moving_.store(infer);
+    if (!infer && nowMs - lastInferMs_ >= keepAliveMs_.load()) {
+        infer = true;
+        keepAlive_++;
+    }
+    if (infer) {
+        lastInferMs_ = nowMs;
+    } else {
+        gated_++;
+    }
+    analyzed_++;
+    costUs_ += now_us() - start;
+    return infer;
+}
+
+motion_stats_t MotionDetector::getStats() const {
+    motion_stats_t stats;
+    stats.analyzed = analyzed_.load();
+    stats.gated = gated_.load();
+    stats.keepAlive = keepAlive_.load();
+    stats.frozenEvents = frozenEvents_.load();
+    stats.avgCostUs = stats.analyzed > 0 ? (double) costUs_.load() / stats.analyzed : 0;
+    stats.motion = motion_.load();
+    stats.frozen = frozen_.load();
+    return stats;
+}
+
+void MotionDetector::logStats(int cameraIndex) {
+    motion_stats_t stats = getStats();
+    NN_LOG_DEBUG("Camera %d motion gate: analyzed=%llu gated=%llu (%.1f%%) keep-alive=%llu frozen=%d (events %llu) "
+                 "motion=%.4f cost=%.0f us/frame", cameraIndex, (unsigned long long) stats.analyzed,
+                 (unsigned long long) stats.gated,
+                 stats.analyzed > 0 ? stats.gated * 100.0 / stats.analyzed : 0.0,
+                 (unsigned long long) stats.keepAlive, stats.frozen, (unsigned long long) stats.frozenEvents,
+                 stats.motion, stats.avgCostUs);
+}
@@ -0,0 +1,96 @@
+// 解码路径上的画面变化检测：在降采样的亮度网格上比较运动，静止画面不送推理，并识别冻结的码流
+
+#ifndef RK3588_DEMO_MOTION_DETECTOR_H
+#define RK3588_DEMO_MOTION_DETECTOR_H
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include "rga_utils.h"
+
+#define MOTION_MAX_GRID_W 128           // 网格最多的列数，格子边长为16的倍数
+#define MOTION_ROWS_PER_CELL 4          // 每个格子只采样4行，4K画面每帧读取约1MB
+#define MOTION_CELL_DIFF 10             // 格子平均亮度与背景相差超过这个值算变化，平均后夜间噪声远小于它
+#define MOTION_DEFAULT_THRESHOLD 0.0f       // 默认关闭门控，由setCameraMotionGate开启；建议0.0005，1080p约4个格子
+#define MOTION_DEFAULT_KEEPALIVE_MS 2000    // 静止时强制推理的间隔，保证检测结果和卡住检测持续更新
+#define MOTION_HOLD_MS 1000             // 运动停止后继续推理的时间，避免目标停下的瞬间丢失
+#define MOTION_FROZEN_MS 3000           // 网格完全不变持续这么久认为码流冻结，真实画面总有噪声
+#define MOTION_OBSERVE_MS 500           // 不送推理的帧只按这个间隔检查冻结
+
+typedef struct {
+    uint64_t analyzed;      // 分析的帧数
+    uint64_t gated;         // 画面静止未送推理的帧数
+    uint64_t keepAlive;     // 静止时强制推理的帧数
+    uint64_t frozenEvents;  // 进入冻结状态的次数
+    double avgCostUs;       // 每帧平均耗时
+    float motion;           // 最近一帧的变化格子占比
+    bool frozen;
+} motion_stats_t;
+
+// 每路摄像头一个，analyze和observe只在解码线程调用，其余接口可以在任意线程调用
+class MotionDetector {
+public:
+    MotionDetector();
+
+    // threshold为变化格子占比，<=0关闭门控（每帧都推理，仍然检测冻结）；keepAliveMs为静止时强制推理的间隔
+    void configure(float threshold, int keepAliveMs);
+
+    // frame为NV12，只读Y平面；返回本帧是否需要推理
+    bool analyze(const rga_image_t &frame);
+
+    // 不送推理或压缩域判定静止的帧：只更新冻结状态，不做门控判断，间隔不足MOTION_OBSERVE_MS时直接返回
+    void observe(const rga_image_t &frame);
+
+    // 网格连续不变超过MOTION_FROZEN_MS
+    bool isFrozen() const {
+        return frozen_.load();
+    }
+
+    // 最近一帧有变化或在运动后的保持时间内，不含强制推理
+    bool isMoving() const {
+        return moving_.load();
+    }
+
+    // 流重启后重新建立背景，冻结状态立即清除
+    void reset();
+
+    motion_stats_t getStats() const;
+
+    void logStats(int cameraIndex);
+
+private:
+    void downsample(const rga_image_t &frame);
+
+    // 采样一帧并更新冻结状态，返回变化的格子数；帧格式不支持时返回-1
+    int sample(const rga_image_t &frame, int64_t nowMs);
+
+    std::atomic<float> threshold_;
+    std::atomic<int> keepAliveMs_;
+    std::atomic<bool> resetPending_;
+
+    // 以下只在解码线程访问
+    int frameWidth_;
+    int frameHeight_;
+    int cell_;
+    int gridWidth_;
+    int gridHeight_;
+    std::vector<uint8_t> grid_;
+    std::vector<uint8_t> previous_;
+    std::vector<uint8_t> background_;
+    bool hasBackground_;
+    int64_t lastInferMs_;
+    int64_t lastMotionMs_;
+    int64_t unchangedSinceMs_;
+    int64_t lastSampleMs_;
+
+    std::atomic<bool> frozen_;
+    std::atomic<bool> moving_;
+    std::atomic<float> motion_;
+    std::atomic<uint64_t> analyzed_;
+    std::atomic<uint64_t> gated_;
+    std::atomic<uint64_t> keepAlive_;
+    std::atomic<uint64_t> frozenEvents_;
+    std::atomic<int64_t> costUs_;
+};
+
+#endif // RK3588_DEMO_MOTION_DETECTOR_H
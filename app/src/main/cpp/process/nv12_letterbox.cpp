@@ -0,0 +1,208 @@
+// NV12直接到letterbox后的RGB模型输入的CPU实现
+
+#include "nv12_letterbox.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <vector>
+#include "scratch_arena.h"
+
+// 插值权重的定点位数，竖直和水平各8位
+#define NV12_WEIGHT_BITS 8
+#define NV12_WEIGHT_ONE (1 << NV12_WEIGHT_BITS)
+// 每段的输出行数
+#define NV12_ROWS_PER_STRIPE 16
+
+// YUV转RGB系数，与OpenCV的ITU-R BT.601实现相同，20位定点
+#define NV12_COEF_SHIFT 20
+#define NV12_CY 1220542
+#define NV12_CUB 2116026
+#define NV12_CUG (-409993)
+#define NV12_CVG (-852492)
+#define NV12_CVR 1673527
+
+namespace {
+
+// 一个方向上输出坐标对应的两个源坐标和后一个的权重，按分量分开存放便于向量化查表
+struct AxisTaps {
+    std::vector<int> i0;
+    std::vector<int> i1;
+    std::vector<ushort> w;
+};
+
+// 与cv::INTER_LINEAR相同的像素中心对齐：src = (dst + 0.5) * scale - 0.5，越界时钳到边缘
+// subsample为2时计算色度平面的坐标，色度样点位于2x2亮度块中心；stride为源平面中相邻样点的间隔
+void build_axis(int dst_len, int src_len, int subsample, int stride, AxisTaps &taps) {
+    taps.i0.resize(dst_len);
+    taps.i1.resize(dst_len);
+    taps.w.resize(dst_len);
+    int plane_len = src_len / subsample;
+    double scale = (double) src_len / dst_len;
+    for (int i = 0; i < dst_len; i++) {
+        double f = ((i + 0.5) * scale) / subsample - 0.5;
+        if (f < 0) {
+            f = 0;
+        }
+        int i0 = (int) f;
+        double frac = f - i0;
+        if (i0 >= plane_len - 1) {
+            i0 = plane_len - 1;
+            frac = 0;
+        }
+        taps.i0[i] = i0 * stride;
+        taps.i1[i] = std::min(i0 + 1, plane_len - 1) * stride;
+        taps.w[i] = (ushort) cvRound(frac * NV12_WEIGHT_ONE);
+    }
+}
+
+// 两行按权重竖直混合，结果带8位小数：a * (256 - w) + b * w，不超过65280
+void blend_rows(const uint8_t *a, const uint8_t *b, int w, uint16_t *out, int len) {
+    int x = 0;
+#if CV_SIMD128
+    cv::v_uint16x8 w0 = cv::v_setall_u16((ushort) (NV12_WEIGHT_ONE - w));
+    cv::v_uint16x8 w1 = cv::v_setall_u16((ushort) w);
+    for (; x <= len - 16; x += 16) {
+        cv::v_uint16x8 a0, a1, b0, b1;
+        cv::v_expand(cv::v_load(a + x), a0, a1);
+        cv::v_expand(cv::v_load(b + x), b0, b1);
+        // 结果不会超过65280，用不饱和的乘加，饱和版本在SSE和NEON上都要展开成32位
+        cv::v_store(out + x, cv::v_add_wrap(cv::v_mul_wrap(a0, w0), cv::v_mul_wrap(b0, w1)));
+        cv::v_store(out + x + 8, cv::v_add_wrap(cv::v_mul_wrap(a1, w0), cv::v_mul_wrap(b1, w1)));
+    }
+#endif
+    for (; x < len; x++) {
+        out[x] = (uint16_t) (a[x] * (NV12_WEIGHT_ONE - w) + b[x] * w);
+    }
+}
+
+#if CV_SIMD128
+// 按表取8个样点做水平插值，竖直混合的8位小数一起去掉，得到0~255的两组4个值
+inline void lerp_taps(const uint16_t *row, const int *i0, const int *i1, const ushort *w,
+                      cv::v_int32x4 &lo, cv::v_int32x4 &hi) {
+    cv::v_uint16x8 w1 = cv::v_load(w);
+    cv::v_uint16x8 w0 = cv::v_sub_wrap(cv::v_setall_u16(NV12_WEIGHT_ONE), w1);
+    cv::v_uint32x4 a0, a1, b0, b1;
+    cv::v_mul_expand(cv::v_lut(row, i0), w0, a0, a1);
+    cv::v_mul_expand(cv::v_lut(row, i1), w1, b0, b1);
+    cv::v_uint32x4 round = cv::v_setall_u32(1 << (NV12_WEIGHT_BITS * 2 - 1));
+    lo = cv::v_reinterpret_as_s32(cv::v_shr<NV12_WEIGHT_BITS * 2>(a0 + b0 + round));
+    hi = cv::v_reinterpret_as_s32(cv::v_shr<NV12_WEIGHT_BITS * 2>(a1 + b1 + round));
+}
+
+// 4个像素的YUV(已减去偏置)转RGB，结果为未饱和的int32
+inline void yuv_to_rgb4(const cv::v_int32x4 &y, const cv::v_int32x4 &u, const cv::v_int32x4 &v,
+                        cv::v_int32x4 &r, cv::v_int32x4 &g, cv::v_int32x4 &b) {
+    cv::v_int32x4 yc = y * cv::v_setall_s32(NV12_CY) + cv::v_setall_s32(1 << (NV12_COEF_SHIFT - 1));
+    r = cv::v_shr<NV12_COEF_SHIFT>(yc + v * cv::v_setall_s32(NV12_CVR));
+    g = cv::v_shr<NV12_COEF_SHIFT>(yc + v * cv::v_setall_s32(NV12_CVG) + u * cv::v_setall_s32(NV12_CUG));
+    b = cv::v_shr<NV12_COEF_SHIFT>(yc + u * cv::v_setall_s32(NV12_CUB));
+}
+#endif
+
+class Nv12LetterboxBody : public cv::ParallelLoopBody {
+public:
+    Nv12LetterboxBody(const rga_image_t &src, const cv::Rect &rect, int dst_width, uint8_t *dst)
+            : src_(src), rect_(rect), dst_width_(dst_width), dst_(dst) {
+        build_axis(rect.width, src.width, 1, 1, luma_x_);
+        build_axis(rect.width, src.width, 2, 2, chroma_x_);
+        build_axis(rect.height, src.height, 1, 1, luma_y_);
+        build_axis(rect.height, src.height, 2, 1, chroma_y_);
+    }
+
+    void operator()(const cv::Range &range) const CV_OVERRIDE {
+        const int src_width = src_.width;
+        const int width = rect_.width;
+        size_t row_bytes = (size_t) dst_width_ * 3;
+
+        // 竖直混合后的Y行和UV行，取自所在线程的临时缓冲
+        size_t blend_len = (size_t) cv::alignSize(src_width, 64);
+        uint16_t *blend_y = (uint16_t *) ScratchArena::forCurrentThread().reserve(
+                SCRATCH_ROWS, blend_len * 2 * sizeof(uint16_t));
+        uint16_t *blend_uv = blend_y + blend_len;
+
+        const uint8_t *y_plane = (const uint8_t *) src_.buf;
+        const uint8_t *uv_plane = y_plane + (size_t) src_.wstride * src_.hstride;
+
+        for (int y = range.start; y < range.end; y++) {
+            uint8_t *out = dst_ + row_bytes * y;
+            int ry = y - rect_.y;
+            if (ry < 0 || ry >= rect_.height) {
+                memset(out, 0, row_bytes);
+                continue;
+            }
+            memset(out, 0, (size_t) rect_.x * 3);
+            memset(out + (size_t) (rect_.x + width) * 3, 0, (size_t) (dst_width_ - rect_.x - width) * 3);
+
+            blend_rows(y_plane + (size_t) luma_y_.i0[ry] * src_.wstride,
+                       y_plane + (size_t) luma_y_.i1[ry] * src_.wstride, luma_y_.w[ry], blend_y, src_width);
+            blend_rows(uv_plane + (size_t) chroma_y_.i0[ry] * src_.wstride,
+                       uv_plane + (size_t) chroma_y_.i1[ry] * src_.wstride, chroma_y_.w[ry], blend_uv, src_width);
+            convertRow(blend_y, blend_uv, out + (size_t) rect_.x * 3, width);
+        }
+    }
+
+private:
+    // 水平插值和颜色转换，Y按OpenCV的做法减16后下限为0
+    void convertRow(const uint16_t *blend_y, const uint16_t *blend_uv, uint8_t *out, int width) const {
+        int x = 0;
+#if CV_SIMD128
+        cv::v_int32x4 zero = cv::v_setzero_s32(), bias_y = cv::v_setall_s32(16), bias_uv = cv::v_setall_s32(128);
+        for (; x <= width - 16; x += 16) {
+            cv::v_int32x4 r[4], g[4], b[4];
+            for (int k = 0; k < 2; k++) {
+                int xk = x + k * 8;
+                cv::v_int32x4 y0, y1, u0, u1, v0, v1;
+                lerp_taps(blend_y, &luma_x_.i0[xk], &luma_x_.i1[xk], &luma_x_.w[xk], y0, y1);
+                lerp_taps(blend_uv, &chroma_x_.i0[xk], &chroma_x_.i1[xk], &chroma_x_.w[xk], u0, u1);
+                lerp_taps(blend_uv + 1, &chroma_x_.i0[xk], &chroma_x_.i1[xk], &chroma_x_.w[xk], v0, v1);
+                yuv_to_rgb4(cv::v_max(y0 - bias_y, zero), u0 - bias_uv, v0 - bias_uv, r[k * 2], g[k * 2], b[k * 2]);
+                yuv_to_rgb4(cv::v_max(y1 - bias_y, zero), u1 - bias_uv, v1 - bias_uv, r[k * 2 + 1], g[k * 2 + 1],
+                            b[k * 2 + 1]);
+            }
+            cv::v_uint8x16 r8 = cv::v_pack_u(cv::v_pack(r[0], r[1]), cv::v_pack(r[2], r[3]));
+            cv::v_uint8x16 g8 = cv::v_pack_u(cv::v_pack(g[0], g[1]), cv::v_pack(g[2], g[3]));
+            cv::v_uint8x16 b8 = cv::v_pack_u(cv::v_pack(b[0], b[1]), cv::v_pack(b[2], b[3]));
+            cv::v_store_interleave(out + x * 3, r8, g8, b8);
+        }
+#endif
+        const int round = 1 << (NV12_WEIGHT_BITS * 2 - 1);
+        const int32_t half = 1 << (NV12_COEF_SHIFT - 1);
+        for (; x < width; x++) {
+            int lw = luma_x_.w[x], cw = chroma_x_.w[x];
+            int c0 = chroma_x_.i0[x], c1 = chroma_x_.i1[x];
+            int luma = (blend_y[luma_x_.i0[x]] * (NV12_WEIGHT_ONE - lw) + blend_y[luma_x_.i1[x]] * lw + round) >>
+                       (NV12_WEIGHT_BITS * 2);
+            int u = ((blend_uv[c0] * (NV12_WEIGHT_ONE - cw) + blend_uv[c1] * cw + round) >> (NV12_WEIGHT_BITS * 2)) -
+                    128;
+            int v = ((blend_uv[c0 + 1] * (NV12_WEIGHT_ONE - cw) + blend_uv[c1 + 1] * cw + round) >>
+                     (NV12_WEIGHT_BITS * 2)) - 128;
+            int32_t yc = std::max(0, luma - 16) * NV12_CY + half;
+            out[x * 3] = cv::saturate_cast<uint8_t>((yc + v * NV12_CVR) >> NV12_COEF_SHIFT);
+            out[x * 3 + 1] = cv::saturate_cast<uint8_t>((yc + v * NV12_CVG + u * NV12_CUG) >> NV12_COEF_SHIFT);
+            out[x * 3 + 2] = cv::saturate_cast<uint8_t>((yc + u * NV12_CUB) >> NV12_COEF_SHIFT);
+        }
+    }
+
+    const rga_image_t &src_;
+    cv::Rect rect_;
+    int dst_width_;
+    uint8_t *dst_;
+    AxisTaps luma_x_;
+    AxisTaps chroma_x_;
+    AxisTaps luma_y_;
+    AxisTaps chroma_y_;
+};
+
+} // namespace
+
+int64_t nv12_letterbox_rgb(const rga_image_t &src, const cv::Rect &dst_rect, int dst_width, int dst_height,
+                           uint8_t *dst) {
+    if (!src.buf || !dst || dst_rect.width <= 0 || dst_rect.height <= 0 || dst_rect.x < 0 || dst_rect.y < 0 ||
+        dst_rect.x + dst_rect.width > dst_width || dst_rect.y + dst_rect.height > dst_height) {
+        return -1;
+    }
+    Nv12LetterboxBody body(src, dst_rect, dst_width, dst);
+    cv::parallel_for_(cv::Range(0, dst_height), body, (double) dst_height / NV12_ROWS_PER_STRIPE);
+
+    // 每个输出行读两行Y和两行UV，写一行RGB
+    return (int64_t) dst_rect.height * src.width * 3 + (int64_t) dst_width * dst_height * 3;
+}
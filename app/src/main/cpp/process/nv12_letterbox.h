@@ -0,0 +1,17 @@
+// NV12直接到letterbox后的RGB模型输入的CPU实现
+
+#ifndef RK3588_DEMO_NV12_LETTERBOX_H
+#define RK3588_DEMO_NV12_LETTERBOX_H
+
+#include <opencv2/core.hpp>
+#include <stdint.h>
+#include "rga_utils.h"
+
+// 一次遍历完成双线性缩放、YUV转RGB和填充区清零，按输出行分段并行
+// src为NV12，原图缩放到dst中的dst_rect，dst为dst_width x dst_height的RGB，填充区为0
+// 颜色转换系数与cv::COLOR_YUV2RGB_NV12一致；色度按双线性插值，与先转RGB再缩放的结果平均相差约1个灰度级
+// 返回读写的字节数，参数不合法返回-1
+int64_t nv12_letterbox_rgb(const rga_image_t &src, const cv::Rect &dst_rect, int dst_width, int dst_height,
+                           uint8_t *dst);
+
+#endif // RK3588_DEMO_NV12_LETTERBOX_H
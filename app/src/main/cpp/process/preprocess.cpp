@@ -3,158 +3,46 @@
 #include "preprocess.h"
 
 #include "logging.h"
-#include "im2d.h"
-#include "rga.h"
 
-
-// opencv 版本的 letterbox
-LetterBoxInfo letterbox(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio)
+const LetterboxGeometry &letterbox_geometry(int src_width, int src_height, int dst_width, int dst_height)
 {
-    // img has to be 3 channels
-    if (img.channels() != 3)
-    {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
-    }
-    float img_width = img.cols;
-    float img_height = img.rows;
-
-    int letterbox_width = 0;
-    int letterbox_height = 0;
-
-    LetterBoxInfo info;
-    int padding_hor = 0;
-    int padding_ver = 0;
-
-    if (img_width / img_height > wh_ratio)
-    {
-        info.hor = false;
-        letterbox_width = img_width;
-        letterbox_height = img_width / wh_ratio;
-        info.pad = (letterbox_height - img_height) / 2.f;
-        padding_hor = 0;
-        padding_ver = info.pad;
-        
+    static thread_local LetterboxGeometry cached = {0, 0, 0, 0, {false, 0}, cv::Size(), cv::Rect()};
+    if (cached.src_width == src_width && cached.src_height == src_height && cached.dst_width == dst_width &&
+        cached.dst_height == dst_height)
+    {
+        return cached;
+    }
+
+    // 填充量按整数截断，与原先copyMakeBorder实现的取整方式相同，保证后处理还原坐标的结果不变
+    float wh_ratio = (float) dst_width / (float) dst_height;
+    LetterboxGeometry geometry;
+    geometry.src_width = src_width;
+    geometry.src_height = src_height;
+    geometry.dst_width = dst_width;
+    geometry.dst_height = dst_height;
+    if ((float) src_width / (float) src_height > wh_ratio)
+    {
+        int letterbox_height = src_width / wh_ratio;
+        geometry.info.hor = false;
+        geometry.info.pad = (letterbox_height - src_height) / 2.f;
+        geometry.letterbox_size = cv::Size(src_width, src_height + geometry.info.pad * 2);
+        float scale = (float) dst_height / geometry.letterbox_size.height;
+        int y = cvRound(geometry.info.pad * scale);
+        geometry.dst_rect = cv::Rect(0, y, dst_width, std::min(cvRound(src_height * scale), dst_height - y));
     }
     else
     {
-        info.hor = true;
-        letterbox_width = img_height * wh_ratio;
-        letterbox_height = img_height;
-        info.pad = (letterbox_width - img_width) / 2.f;
-        padding_hor = info.pad;
-        padding_ver = 0;
-    }
-    // 使用cv::copyMakeBorder函数进行填充边界
-    cv::copyMakeBorder(img, img_letterbox, padding_ver, padding_ver, padding_hor, padding_hor, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
-    return info;
+        int letterbox_width = src_height * wh_ratio;
+        geometry.info.hor = true;
+        geometry.info.pad = (letterbox_width - src_width) / 2.f;
+        geometry.letterbox_size = cv::Size(src_width + geometry.info.pad * 2, src_height);
+        float scale = (float) dst_width / geometry.letterbox_size.width;
+        int x = cvRound(geometry.info.pad * scale);
+        geometry.dst_rect = cv::Rect(x, 0, std::min(cvRound(src_width * scale), dst_width - x), dst_height);
+    }
+    NN_LOG_DEBUG("letterbox geometry %dx%d -> %dx%d: pad=%d hor=%d rect=(%d,%d %dx%d)", src_width, src_height,
+                 dst_width, dst_height, geometry.info.pad, geometry.info.hor, geometry.dst_rect.x,
+                 geometry.dst_rect.y, geometry.dst_rect.width, geometry.dst_rect.height);
+    cached = geometry;
+    return cached;
 }
-
-// opencv resize
-void cvimg2tensor(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor)
-{
-    // img has to be 3 channels
-    if (img.channels() != 3)
-    {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
-    }
-    // BGR to RGB
-    cv::Mat img_rgb;
-    cv::cvtColor(img, img_rgb, cv::COLOR_BGR2RGB);
-    // resize img
-    cv::Mat img_resized;
-    // resize img
-    cv::resize(img_rgb, img_resized, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
-    // BGR to RGB
-    memcpy(tensor.data, img_resized.data, tensor.attr.size);
-}
-
-// rga 版本的 resize
-void cvimg2tensor_rga(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor)
-{
-    // img has to be 3 channels
-    if (img.channels() != 3)
-    {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
-    }
-
-    cv::Mat img_rgb;
-    cv::cvtColor(img, img_rgb, cv::COLOR_BGR2RGB);
-
-    im_rect src_rect;
-    im_rect dst_rect;
-    memset(&src_rect, 0, sizeof(src_rect));
-    memset(&dst_rect, 0, sizeof(dst_rect));
-    rga_buffer_t src = wrapbuffer_virtualaddr((void *)img_rgb.data, img.cols, img.rows, RK_FORMAT_RGB_888);
-    rga_buffer_t dst = wrapbuffer_virtualaddr((void *)tensor.data, width, height, RK_FORMAT_RGB_888);
-    int ret = imcheck(src, dst, src_rect, dst_rect);
-    if (IM_STATUS_NOERROR != ret)
-    {
-        NN_LOG_ERROR("%d, check error! %s", __LINE__, imStrError((IM_STATUS)ret));
-        exit(-1);
-    }
-    imresize(src, dst);
-}
-
-// rga 版本的 letterbox
-LetterBoxInfo letterbox_rga(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio)
-{
-    // img has to be 3 channels
-    if (img.channels() != 3)
-    {
-        NN_LOG_ERROR("img has to be 3 channels");
-        exit(-1);
-    }
-    float img_width = img.cols;
-    float img_height = img.rows;
-
-    int letterbox_width = 0;
-    int letterbox_height = 0;
-
-    LetterBoxInfo info;
-    int padding_hor = 0;
-    int padding_ver = 0;
-
-    if (img_width / img_height > wh_ratio)
-    {
-        info.hor = false;
-        letterbox_width = img_width;
-        letterbox_height = img_width / wh_ratio;
-        info.pad = (letterbox_height - img_height) / 2.f;
-        padding_hor = 0;
-        padding_ver = info.pad;
-    }
-    else
-    {
-        info.hor = true;
-        letterbox_width = img_height * wh_ratio;
-        letterbox_height = img_height;
-        info.pad = (letterbox_width - img_width) / 2.f;
-        padding_hor = info.pad;
-        padding_ver = 0;
-    }
-    // rga add border
-    img_letterbox = cv::Mat::zeros(letterbox_height, letterbox_width, CV_8UC3);
-
-    im_rect src_rect;
-    im_rect dst_rect;
-    memset(&src_rect, 0, sizeof(src_rect));
-    memset(&dst_rect, 0, sizeof(dst_rect));
-
-    // NN_LOG_INFO("img size: %d, %d", img.cols, img.rows);
-
-    rga_buffer_t src = wrapbuffer_virtualaddr((void *)img.data, img.cols, img.rows, RK_FORMAT_RGB_888);
-    rga_buffer_t dst = wrapbuffer_virtualaddr((void *)img_letterbox.data, img_letterbox.cols, img_letterbox.rows, RK_FORMAT_RGB_888);
-    int ret = imcheck(src, dst, src_rect, dst_rect);
-    if (IM_STATUS_NOERROR != ret)
-    {
-        NN_LOG_ERROR("%d, check error! %s", __LINE__, imStrError((IM_STATUS)ret));
-        exit(-1);
-    }
-
-    immakeBorder(src, dst, padding_ver, padding_ver, padding_hor, padding_hor, 0, 0, 0);
-
-    return info;
-}
\ No newline at end of file
@@ -7,15 +7,18 @@
 #include "datatype.h"
 #include "rga_utils.h"
 
-//struct LetterBoxInfo
-//{
-//    bool hor;
-//    int pad;
-//};
+// letterbox几何参数：原图按模型宽高比填充后缩放到模型输入，等价于原图直接缩放到dst_rect，其余部分为填充
+struct LetterboxGeometry {
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    LetterBoxInfo info;         // 后处理用它还原坐标
+    cv::Size letterbox_size;    // 填充后的原图尺寸
+    cv::Rect dst_rect;          // 原图在模型输入中的区域
+};
 
-LetterBoxInfo letterbox(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio);
-LetterBoxInfo letterbox_rga(const cv::Mat& img, cv::Mat& img_letterbox, float wh_ratio);
-void cvimg2tensor(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor);
-void cvimg2tensor_rga(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor);
+// 按尺寸计算letterbox几何参数，每个线程缓存上一次的结果，尺寸不变时直接返回
+const LetterboxGeometry &letterbox_geometry(int src_width, int src_height, int dst_width, int dst_height);
 
 #endif // RK3588_DEMO_PREPROCESS_H
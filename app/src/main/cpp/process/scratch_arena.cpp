@@ -0,0 +1,69 @@
+// 推理路径上的临时图像缓冲
+
+#include "scratch_arena.h"
+
+#include "logging.h"
+
+std::atomic<uint64_t> ScratchArena::frames_(0);
+std::atomic<uint64_t> ScratchArena::allocations_(0);
+std::atomic<int64_t> ScratchArena::bytes_(0);
+
+ScratchArena::ScratchArena() : frameAllocations_(0) {
+}
+
+// 线程退出时缓冲随之释放
+ScratchArena::~ScratchArena() {
+    bytes_ -= (int64_t) bytes();
+}
+
+ScratchArena &ScratchArena::forCurrentThread() {
+    static thread_local ScratchArena arena;
+    return arena;
+}
+
+void ScratchArena::beginFrame() {
+    frameAllocations_ = 0;
+}
+
+int ScratchArena::endFrame() {
+    frames_++;
+    return frameAllocations_;
+}
+
+uchar *ScratchArena::reserve(scratch_slot_e slot, size_t bytes) {
+    cv::Mat &mat = mats_[slot];
+    if (mat.total() < bytes) {
+        int64_t previous = (int64_t) mat.total();
+        mat.create(1, (int) bytes, CV_8UC1);
+        bytes_ += (int64_t) bytes - previous;
+        allocations_++;
+        frameAllocations_++;
+    }
+    return mat.data;
+}
+
+size_t ScratchArena::bytes() const {
+    size_t total = 0;
+    for (int i = 0; i < SCRATCH_SLOT_COUNT; i++) {
+        total += mats_[i].total() * mats_[i].elemSize();
+    }
+    return total;
+}
+
+uint64_t ScratchArena::totalFrames() {
+    return frames_.load();
+}
+
+uint64_t ScratchArena::totalAllocations() {
+    return allocations_.load();
+}
+
+int64_t ScratchArena::totalBytes() {
+    return bytes_.load();
+}
+
+void ScratchArena::logStats() {
+    NN_LOG_DEBUG("ScratchArena: frames=%llu allocations=%llu held=%lld KB",
+                 (unsigned long long) totalFrames(), (unsigned long long) totalAllocations(),
+                 (long long) (totalBytes() / 1024));
+}
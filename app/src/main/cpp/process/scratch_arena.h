@@ -0,0 +1,51 @@
+// 推理路径上的临时图像缓冲
+
+#ifndef RK3588_DEMO_SCRATCH_ARENA_H
+#define RK3588_DEMO_SCRATCH_ARENA_H
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <stdint.h>
+
+// 预处理中用到的临时图像
+typedef enum {
+    SCRATCH_ROWS = 0,       // NV12转letterbox内核的行缓冲
+    SCRATCH_CONVERT = 1,    // CPU图像处理后端颜色转换或缩放的中间结果
+    SCRATCH_SLOT_COUNT = 2,
+} scratch_slot_e;
+
+// 每个线程一个，缓冲按当前码流分辨率分配后跨帧复用，只在需要更大的缓冲时重新分配
+// 每帧前后调用beginFrame/endFrame，统计这一帧里本线程重新分配了多少个缓冲
+class ScratchArena {
+public:
+    static ScratchArena &forCurrentThread();
+
+    void beginFrame();
+
+    // 返回本帧重新分配的缓冲数，稳定运行时应为0
+    int endFrame();
+
+    // 取槽位上至少bytes字节的缓冲，已有缓冲够大时直接复用
+    uchar *reserve(scratch_slot_e slot, size_t bytes);
+
+    size_t bytes() const;
+
+    static uint64_t totalFrames();
+    static uint64_t totalAllocations();
+    static int64_t totalBytes();
+    static void logStats();
+
+private:
+    ScratchArena();
+
+    ~ScratchArena();
+
+    cv::Mat mats_[SCRATCH_SLOT_COUNT];
+    int frameAllocations_;
+
+    static std::atomic<uint64_t> frames_;
+    static std::atomic<uint64_t> allocations_;
+    static std::atomic<int64_t> bytes_;     // 所有线程的缓冲总大小
+};
+
+#endif // RK3588_DEMO_SCRATCH_ARENA_H
@@ -0,0 +1,101 @@
+#include "tile_layout.h"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include "logging.h"
+
+namespace {
+
+struct LayoutKey {
+    int frame_width;
+    int frame_height;
+    int model_width;
+    int model_height;
+
+    bool operator<(const LayoutKey &other) const {
+        if (frame_width != other.frame_width) return frame_width < other.frame_width;
+        if (frame_height != other.frame_height) return frame_height < other.frame_height;
+        if (model_width != other.model_width) return model_width < other.model_width;
+        return model_height < other.model_height;
+    }
+};
+
+// 一个方向上的分块数和起点：块数按最小重叠计算，起点均匀分布，多出的空间都用作重叠
+int place_tiles(int length, int tile, std::vector<int> &starts) {
+    starts.clear();
+    if (tile >= length) {
+        starts.push_back(0);
+        return 1;
+    }
+    int overlap = (int) (tile * TILE_MIN_OVERLAP);
+    int count = (int) std::ceil((float) (length - overlap) / (tile - overlap));
+    for (int i = 0; i < count; i++) {
+        int start = count > 1 ? (int) ((int64_t) (length - tile) * i / (count - 1)) : 0;
+        starts.push_back(start & ~1);
+    }
+    return count;
+}
+
+TileLayout compute_layout(const LayoutKey &key) {
+    TileLayout layout;
+    layout.frame_width = key.frame_width;
+    layout.frame_height = key.frame_height;
+    layout.model_width = key.model_width;
+    layout.model_height = key.model_height;
+
+    // 从模型输入的TILE_MAX_SCALE倍开始，分块数超过上限时按比例放大分块
+    float scale = TILE_MAX_SCALE;
+    std::vector<int> xs, ys;
+    int tile_w = 0, tile_h = 0;
+    for (;;) {
+        tile_w = std::min((int) (key.model_width * scale) & ~1, key.frame_width & ~1);
+        tile_h = std::min((int) (key.model_height * scale) & ~1, key.frame_height & ~1);
+        layout.columns = place_tiles(key.frame_width, tile_w, xs);
+        layout.rows = place_tiles(key.frame_height, tile_h, ys);
+        if (layout.columns * layout.rows <= TILE_MAX_COUNT) {
+            break;
+        }
+        scale *= 1.25f;
+    }
+    for (int y: ys) {
+        for (int x: xs) {
+            layout.tiles.push_back(cv::Rect(x, y, tile_w, tile_h));
+        }
+    }
+    NN_LOG_INFO("tile layout %dx%d -> %dx%d: %dx%d tiles of %dx%d", key.frame_width, key.frame_height,
+                key.model_width, key.model_height, layout.columns, layout.rows, tile_w, tile_h);
+    return layout;
+}
+
+} // namespace
+
+const TileLayout &tile_layout(int frame_width, int frame_height, int model_width, int model_height) {
+    // 布局只增不删，map节点地址不变，返回的引用一直有效
+    static std::mutex mutex;
+    static std::map<LayoutKey, TileLayout> layouts;
+    LayoutKey key = {frame_width, frame_height, model_width, model_height};
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<LayoutKey, TileLayout>::iterator it = layouts.find(key);
+    if (it == layouts.end()) {
+        it = layouts.insert(std::make_pair(key, compute_layout(key))).first;
+    }
+    return it->second;
+}
+
+bool mosaic_cells(int count, int model_width, int model_height, std::vector<cv::Rect> &cells) {
+    cells.clear();
+    int grid = 1;
+    while (grid * grid < count) {
+        grid++;
+    }
+    if (count < 1 || grid > MOSAIC_MAX_GRID) {
+        return false;
+    }
+    int cell_width = (model_width / grid) & ~1;
+    int cell_height = (model_height / grid) & ~1;
+    for (int i = 0; i < count; i++) {
+        cells.push_back(cv::Rect((i % grid) * cell_width, (i / grid) * cell_height, cell_width, cell_height));
+    }
+    return true;
+}
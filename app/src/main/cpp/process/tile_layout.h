@@ -0,0 +1,32 @@
+// 高分辨率画面分块检测的分块布局，以及多个小区域拼进一幅模型输入时的格子布局
+
+#ifndef RK3588_DEMO_TILE_LAYOUT_H
+#define RK3588_DEMO_TILE_LAYOUT_H
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#define TILE_MAX_SCALE 2.0f         // 分块边长最多为模型输入的2倍，即每块缩小不超过2倍
+#define TILE_MIN_OVERLAP 0.15f      // 相邻分块至少重叠块边长的15%，跨块的小目标至少完整落在一块中
+#define TILE_MAX_COUNT 12           // 分块数上限，超过时增大分块
+#define MOSAIC_MAX_GRID 3           // 拼图最多3x3格
+
+// 画面按模型宽高比切成大小相同、互相重叠的分块，坐标和尺寸对齐到偶数
+struct TileLayout {
+    int frame_width;
+    int frame_height;
+    int model_width;
+    int model_height;
+    int columns;
+    int rows;
+    std::vector<cv::Rect> tiles;    // 按行排列
+};
+
+// 每种画面和模型尺寸只计算一次，之后返回缓存的布局；画面不大于一块时只有一块（整幅画面）
+const TileLayout &tile_layout(int frame_width, int frame_height, int model_width, int model_height);
+
+// count个区域拼进一幅模型输入：取能放下的最小k×k网格，格子按行排列，坐标和尺寸对齐到偶数
+// count超过MOSAIC_MAX_GRID的平方时返回false
+bool mosaic_cells(int count, int model_width, int model_height, std::vector<cv::Rect> &cells);
+
+#endif // RK3588_DEMO_TILE_LAYOUT_H
@@ -2,6 +2,7 @@
 #include <sys/time.h>
 
 #include "mpp_decoder.h"
+#include "frame_buffer_pool.h"
 #include <unistd.h>
 #include <pthread.h>
 #include <sys/syscall.h>
@@ -9,29 +10,97 @@
 #define LOGD printf
 // #define LOGD
 
-static unsigned long GetCurrentTimeMS()
+static int64_t GetCurrentTimeUS()
 {
     struct timeval tv;
     gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// 包的第一个NAL是否为参数集（H264 SPS/PPS，H265 VPS/SPS/PPS），等关键帧期间也要送入
+static bool IsParameterSet(MppCodingType type, const uint8_t *data, int size)
+{
+    int pos = 0;
+    if (size >= 4 && data[0] == 0 && data[1] == 0 && data[2] == 0 && data[3] == 1)
+    {
+        pos = 4;
+    }
+    else if (size >= 3 && data[0] == 0 && data[1] == 0 && data[2] == 1)
+    {
+        pos = 3;
+    }
+    if (pos >= size)
+    {
+        return false;
+    }
+    if (type == MPP_VIDEO_CodingHEVC)
+    {
+        int nal_type = (data[pos] >> 1) & 0x3f;
+        return nal_type >= 32 && nal_type <= 34;
+    }
+    int nal_type = data[pos] & 0x1f;
+    return nal_type == 7 || nal_type == 8;
 }
 
 MppDecoder::MppDecoder()
 {
 }
 
+// 最后一个引用释放时把缓冲还给解码器缓冲组
+struct MppFrameReleaser
+{
+    MppBuffer buffer;
+    std::shared_ptr<std::atomic<int>> retained;
+
+    void operator()(FrameBuffer *frame_buffer) const
+    {
+        mpp_buffer_put(buffer);
+        (*retained)--;
+        delete frame_buffer;
+    }
+};
+
+std::shared_ptr<FrameBuffer> MppDecoder::RetainCurrentFrame()
+{
+    if (cur_buffer == NULL)
+    {
+        return nullptr;
+    }
+    if (retained->load() >= MPI_DEC_BUFFER_COUNT - MPI_DEC_RETAIN_RESERVE)
+    {
+        retain_rejected++;
+        return nullptr;
+    }
+
+    FrameBuffer *frame_buffer = new FrameBuffer();
+    frame_buffer->data = (char *)mpp_buffer_get_ptr(cur_buffer);
+    frame_buffer->size = mpp_buffer_get_size(cur_buffer);
+    frame_buffer->fd = mpp_buffer_get_fd(cur_buffer);
+    frame_buffer->backend = FRAME_BACKEND_MPP;
+    frame_buffer->width = cur_width;
+    frame_buffer->height = cur_height;
+    frame_buffer->widthStride = cur_hor_stride;
+    frame_buffer->heightStride = cur_ver_stride;
+    frame_buffer->format = 0; // RGA格式由调用方填写
+
+    mpp_buffer_inc_ref(cur_buffer);
+    (*retained)++;
+    retained_total++;
+    MppFrameReleaser releaser;
+    releaser.buffer = cur_buffer;
+    releaser.retained = retained;
+    return std::shared_ptr<FrameBuffer>(frame_buffer, releaser);
+}
+
 MppDecoder::~MppDecoder()
 {
+    // 先停线程，之后才能销毁解码器上下文
+    Stop();
     if (loop_data.packet)
     {
         mpp_packet_deinit(&loop_data.packet);
         loop_data.packet = NULL;
     }
-    if (frame)
-    {
-        mpp_frame_deinit(&frame);
-        frame = NULL;
-    }
     if (mpp_ctx)
     {
         mpp_destroy(mpp_ctx);
@@ -40,18 +109,41 @@ MppDecoder::~MppDecoder()
 
     if (loop_data.frm_grp)
     {
+        UnregisterBuffers();
         mpp_buffer_group_put(loop_data.frm_grp);
         loop_data.frm_grp = NULL;
     }
 }
 
+void MppDecoder::RegisterBuffer(MppBuffer buffer, int fd, void *ptr)
+{
+    for (size_t i = 0; i < registered_buffers.size(); i++)
+    {
+        if (registered_buffers[i].fd == fd && registered_buffers[i].ptr == ptr)
+        {
+            return;
+        }
+    }
+    RegisteredBuffer registered = {fd, ptr, mpp_buffer_get_size(buffer)};
+    registered_buffers.push_back(registered);
+    dma_buffer_notify_alloc(fd, ptr, registered.size);
+}
+
+void MppDecoder::UnregisterBuffers()
+{
+    // 清空后缓冲组会重新分配，旧的fd和地址不能再命中导入句柄；仍被下游持有的帧此后按未登记缓冲导入
+    for (size_t i = 0; i < registered_buffers.size(); i++)
+    {
+        dma_buffer_notify_free(registered_buffers[i].fd, registered_buffers[i].ptr, registered_buffers[i].size);
+    }
+    registered_buffers.clear();
+}
+
 // MPP 解码器初始化
-int MppDecoder::Init(int video_type, int fps, void *userdata)
+int MppDecoder::Init(int video_type, void *userdata)
 {
     MPP_RET ret = MPP_OK;
     this->userdata = userdata;
-    this->fps = fps;
-    this->last_frame_time_ms = 0;
     if (video_type == 264)
     {
         mpp_type = MPP_VIDEO_CodingAVC;
@@ -71,7 +163,6 @@ int MppDecoder::Init(int video_type, int fps, void *userdata)
 
     MppDecCfg cfg = NULL;
 
-    MppCtx mpp_ctx = NULL;
     ret = mpp_create(&mpp_ctx, &mpp_mpi);
     if (MPP_OK != ret)
     {
@@ -79,6 +170,11 @@ int MppDecoder::Init(int video_type, int fps, void *userdata)
         return 0;
     }
 
+    // 送包和取帧都按超时阻塞，由各自的线程等待，不再用usleep轮询
+    RK_S64 timeout = MPI_DEC_POLL_TIMEOUT_MS;
+    mpp_mpi->control(mpp_ctx, MPP_SET_INPUT_TIMEOUT, &timeout);
+    mpp_mpi->control(mpp_ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+
     ret = mpp_init(mpp_ctx, MPP_CTX_DEC, mpp_type);
     if (ret)
     {
@@ -127,6 +223,16 @@ int MppDecoder::Init(int video_type, int fps, void *userdata)
 
 int MppDecoder::Reset()
 {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        packets_dropped += packet_queue.size();
+        packet_queue.clear();
+        waiting_key = key_seen;
+    }
+    {
+        std::lock_guard<std::mutex> lock(inflight_mutex);
+        inflight.clear();
+    }
     if (mpp_mpi != NULL)
     {
         mpp_mpi->reset(mpp_ctx);
@@ -134,293 +240,364 @@ int MppDecoder::Reset()
     return 0;
 }
 
-int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos)
+int MppDecoder::Decode(uint8_t *pkt_data, int pkt_size, int pkt_eos, int64_t pts, bool key_frame)
 {
-    MpiDecLoopData *data = &loop_data;
-    RK_U32 pkt_done = 0;
-    RK_U32 err_info = 0;
-    MPP_RET ret = MPP_OK;
-    MppCtx ctx = data->ctx;
-    MppApi *mpi = data->mpi;
-
-    size_t read_size = 0;
-    size_t packet_size = data->packet_size;
-
-    LOGD("receive packet size=%d ", pkt_size);
+    if (pkt_data == NULL || pkt_size <= 0)
+    {
+        return -1;
+    }
+    bool param_set = !key_frame && IsParameterSet(mpp_type, pkt_data, pkt_size);
 
-    if (packet == NULL)
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (stopping)
+    {
+        // Stop()正在等待线程退出，期间到达的包直接丢弃
+        packets_dropped++;
+        return -1;
+    }
+    if (!started)
     {
-        ret = mpp_packet_init(&packet, NULL, 0);
-        if (ret != MPP_OK || packet == NULL) {
-            LOGD("Error: mpp_packet_init failed, ret=%d, packet=%p", ret, packet);
-            return ret;
+        Start();
+    }
+    if (key_frame)
+    {
+        key_seen = true;
+        waiting_key = false;
+    }
+    else if (waiting_key && !param_set)
+    {
+        packets_dropped++;
+        return -1;
+    }
+    if (packet_queue.size() >= MPI_DEC_PACKET_QUEUE)
+    {
+        // 解码跟不上码流：积压的包全部丢弃，从关键帧恢复；调用方不提供关键帧标志时只丢当前包
+        LOGD("decoder input queue full (%zu packets), dropping", packet_queue.size());
+        if (!key_seen)
+        {
+            packets_dropped++;
+            return -1;
+        }
+        packets_dropped += packet_queue.size();
+        packet_queue.clear();
+        if (!key_frame)
+        {
+            // 参数集仍然送入，否则之后的关键帧可能无法解码
+            waiting_key = true;
+            if (!param_set)
+            {
+                packets_dropped++;
+                return -1;
+            }
         }
     }
 
-    // 🔧 修复: 在使用packet前再次检查是否为空
-    if (packet == NULL) {
-        LOGD("Error: packet is NULL before setting data");
-        return MPP_ERR_NULL_PTR;
+    QueuedPacket item;
+    if (!free_payloads.empty())
+    {
+        item.data.swap(free_payloads.back());
+        free_payloads.pop_back();
     }
+    item.data.assign(pkt_data, pkt_data + pkt_size);
+    item.pts = pts;
+    item.eos = pkt_eos != 0;
+    item.enqueue_us = GetCurrentTimeUS();
+    packet_queue.push_back(std::move(item));
+    queue_cond.notify_one();
+    return 0;
+}
 
-    ///////////////////////////////////////////////
-    // ret = mpp_packet_init(&packet, frame_data, frame_size);
-    mpp_packet_set_data(packet, pkt_data);
-    mpp_packet_set_size(packet, pkt_size);
-    mpp_packet_set_pos(packet, pkt_data);
-    mpp_packet_set_length(packet, pkt_size);
-    // setup eos flag
-    if (pkt_eos)
-        mpp_packet_set_eos(packet);
-    do
+// 持有queue_mutex时调用
+void MppDecoder::Start()
+{
+    started = true;
+    input_thread = std::thread(&MppDecoder::InputLoop, this);
+    output_thread = std::thread(&MppDecoder::OutputLoop, this);
+}
+
+void MppDecoder::Stop()
+{
     {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cond.notify_all();
+    if (input_thread.joinable())
+    {
+        input_thread.join();
+    }
+    if (output_thread.joinable())
+    {
+        output_thread.join();
+    }
+    // 线程已退出，丢弃残留的包；之后再调用Decode会重新启动线程，从关键帧开始
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        packets_dropped += packet_queue.size();
+        packet_queue.clear();
+        waiting_key = key_seen;
+        started = false;
+        stopping = false;
+    }
+    std::lock_guard<std::mutex> lock(inflight_mutex);
+    inflight.clear();
+}
 
-        RK_S32 times = 5;
-        // send the packet first if packet is not done
-        if (!pkt_done)
+int MppDecoder::GetQueuedPackets()
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return (int) packet_queue.size();
+}
+
+double MppDecoder::GetAverageLatencyMs() const
+{
+    unsigned long long frames = frames_out.load();
+    return frames > 0 ? latency_us_total.load() / 1000.0 / frames : 0;
+}
+
+// 送包线程：解码器内部队列满时put按超时阻塞，只影响这个线程，不会反压到网络线程
+void MppDecoder::InputLoop()
+{
+    MppCtx ctx = loop_data.ctx;
+    MppApi *mpi = loop_data.mpi;
+    while (true)
+    {
+        QueuedPacket item;
         {
-            ret = mpi->decode_put_packet(ctx, packet);
-            if (MPP_OK == ret)
-                pkt_done = 1;
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cond.wait(lock, [this] { return stopping.load() || !packet_queue.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            item = std::move(packet_queue.front());
+            packet_queue.pop_front();
         }
-        // then get all available frame and release
-        do
-        {
-            RK_S32 get_frm = 0;
-            RK_U32 frm_eos = 0;
 
-        try_again:
-            ret = mpi->decode_get_frame(ctx, &frame);
-            if (MPP_ERR_TIMEOUT == ret)
+        MppPacket packet = NULL;
+        MPP_RET ret = mpp_packet_init(&packet, item.data.data(), item.data.size());
+        if (ret != MPP_OK || packet == NULL)
+        {
+            LOGD("Error: mpp_packet_init failed, ret=%d", ret);
+            continue;
+        }
+        mpp_packet_set_pts(packet, item.pts);
+        if (item.eos)
+        {
+            mpp_packet_set_eos(packet);
+        }
+        {
+            std::lock_guard<std::mutex> lock(inflight_mutex);
+            InFlightPacket entry = {item.pts, item.enqueue_us};
+            inflight.push_back(entry);
+            if (inflight.size() > MPI_DEC_PACKET_QUEUE)
             {
-                if (times > 0)
-                {
-                    times--;
-                    usleep(2000);
-                    goto try_again;
-                }
-                LOGD("decode_get_frame failed too much time ");
+                inflight.pop_front();
             }
-
-            if (MPP_OK != ret)
+        }
+        while (!stopping)
+        {
+            ret = mpi->decode_put_packet(ctx, packet);
+            if (ret == MPP_OK)
             {
-                LOGD("decode_get_frame failed ret %d ", ret);
                 break;
             }
-
-            if (frame)
+            if (ret != MPP_ERR_TIMEOUT && ret != MPP_ERR_BUFFER_FULL)
             {
-                RK_U32 hor_stride = mpp_frame_get_hor_stride(frame);
-                RK_U32 ver_stride = mpp_frame_get_ver_stride(frame);
-                RK_U32 hor_width = mpp_frame_get_width(frame);
-                RK_U32 ver_height = mpp_frame_get_height(frame);
-                RK_U32 buf_size = mpp_frame_get_buf_size(frame);
-                RK_S64 pts = mpp_frame_get_pts(frame);
-                RK_S64 dts = mpp_frame_get_dts(frame);
-
-                LOGD("decoder require buffer w:h [%d:%d] stride [%d:%d] buf_size %d pts=%lld dts=%lld ",
-                     hor_width, ver_height, hor_stride, ver_stride, buf_size, pts, dts);
-
-                if (mpp_frame_get_info_change(frame))
-                {
-
-                    LOGD("decode_get_frame get info changed found ");
-                    // ret = mpp_buffer_group_get_internal(&data->frm_grp, MPP_BUFFER_TYPE_DRM);
-                    // if (ret) {
-                    //     LOGD("get mpp buffer group  failed ret %d ", ret);
-                    //     break;
-                    // }
-                    // mpi->control(ctx, MPP_DEC_SET_EXT_BUF_GROUP, data->frm_grp);
-                    // mpi->control(ctx, MPP_DEC_SET_INFO_CHANGE_READY, NULL);
-                    if (NULL == data->frm_grp)
-                    {
-                        /* If buffer group is not set create one and limit it */
-                        ret = mpp_buffer_group_get_internal(&data->frm_grp, MPP_BUFFER_TYPE_DRM);
-                        if (ret)
-                        {
-                            LOGD("%p get mpp buffer group failed ret %d ", ctx, ret);
-                            break;
-                        }
-
-                        /* Set buffer to mpp decoder */
-                        ret = mpi->control(ctx, MPP_DEC_SET_EXT_BUF_GROUP, data->frm_grp);
-                        if (ret)
-                        {
-                            LOGD("%p set buffer group failed ret %d ", ctx, ret);
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        /* If old buffer group exist clear it */
-                        ret = mpp_buffer_group_clear(data->frm_grp);
-                        if (ret)
-                        {
-                            LOGD("%p clear buffer group failed ret %d ", ctx, ret);
-                            break;
-                        }
-                    }
-
-                    /* Use limit config to limit buffer count to 24 with buf_size */
-                    ret = mpp_buffer_group_limit_config(data->frm_grp, buf_size, 24);
-                    if (ret)
-                    {
-                        LOGD("%p limit buffer group failed ret %d ", ctx, ret);
-                        break;
-                    }
-
-                    /*
-                     * All buffer group config done. Set info change ready to let
-                     * decoder continue decoding
-                     */
-                    ret = mpi->control(ctx, MPP_DEC_SET_INFO_CHANGE_READY, NULL);
-                    if (ret)
-                    {
-                        LOGD("%p info change ready failed ret %d ", ctx, ret);
-                        break;
-                    }
-
-                    this->last_frame_time_ms = GetCurrentTimeMS();
-                }
-                else
-                {
-                    // 🔧 修复: 在访问frame前检查是否为空
-                    if (frame != NULL) {
-                        err_info = mpp_frame_get_errinfo(frame) | mpp_frame_get_discard(frame);
-                        if (err_info)
-                        {
-                            LOGD("decoder_get_frame get err info:%d discard:%d. ",
-                                 mpp_frame_get_errinfo(frame), mpp_frame_get_discard(frame));
-                        }
-                    } else {
-                        LOGD("Warning: frame is NULL in error info check, skipping");
-                        err_info = 0;
-                    }
-                    data->frame_count++;
-                    struct timeval tv;
-                    gettimeofday(&tv, NULL);
-                    LOGD("get one frame %ld ", (tv.tv_sec * 1000 + tv.tv_usec / 1000));
-                    // mpp_frame_get_width(frame);
-                    // char *input_data =(char *) mpp_buffer_get_ptr(mpp_frame_get_buffer(frame));
-                    // 🔧 修复: 在callback调用前再次检查frame是否为空，并正确管理MPP缓冲区引用计数
-                    if (callback != nullptr && frame != NULL)
-                    {
-                        MppBuffer buffer = mpp_frame_get_buffer(frame);
-                        if (buffer != NULL) {
-                            // 🔧 关键修复: 增加缓冲区引用计数，防止在callback执行期间被释放
-                            mpp_buffer_inc_ref(buffer);
-
-                            MppFrameFormat format = mpp_frame_get_fmt(frame);
-                            char *data_vir = (char *)mpp_buffer_get_ptr(buffer);
-                            int fd = mpp_buffer_get_fd(buffer);
-                            LOGD("data_vir=%p fd=%d ", data_vir, fd);
-                            if (data_vir != NULL) {
-                                callback(this->userdata, hor_stride, ver_stride, hor_width, ver_height, format, fd, data_vir);
-                            } else {
-                                LOGD("Warning: data_vir is NULL, skipping callback");
-                            }
-
-                            // 🔧 关键修复: callback执行完毕后，减少缓冲区引用计数
-                            mpp_buffer_put(buffer);
-                        } else {
-                            LOGD("Warning: frame buffer is NULL, skipping callback");
-                        }
-                    }
-                    unsigned long cur_time_ms = GetCurrentTimeMS();
-                    long time_gap = 1000 / this->fps - (cur_time_ms - this->last_frame_time_ms);
-                    LOGD("time_gap=%ld", time_gap);
-                    if (time_gap > 0)
-                    {
-                        usleep(time_gap * 1000);
-                    }
-                    this->last_frame_time_ms = GetCurrentTimeMS();
-                }
-
-                // 🔧 修复: 在访问frame前检查是否为空，防止段错误
-                if (frame != NULL) {
-                    frm_eos = mpp_frame_get_eos(frame);
-
-                    // 🔧 关键修复: 确保frame被正确释放，避免缓冲区引用计数异常
-                    ret = mpp_frame_deinit(&frame);
-                    if (ret != MPP_OK) {
-                        LOGD("Warning: mpp_frame_deinit failed with ret=%d", ret);
-                    }
-                    frame = NULL;
-                } else {
-                    LOGD("Warning: frame is NULL before mpp_frame_get_eos, skipping");
-                    frm_eos = 1; // 设置为结束标志，避免无限循环
-                }
-
-                // if(frame_pre!=NULL)
-                // {
-                //     mpp_frame_deinit(&frame_pre);
-                // }
-                // &frame_pre=&frame;
-
-                get_frm = 1;
+                LOGD("decode_put_packet failed ret %d ", ret);
+                break;
             }
+        }
+        // 解码器在put时已拷贝了包数据
+        mpp_packet_deinit(&packet);
 
-            // try get runtime frame memory usage
-            if (data->frm_grp)
-            {
-                size_t usage = mpp_buffer_group_usage(data->frm_grp);
-                if (usage > data->max_usage)
-                    data->max_usage = usage;
-            }
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (free_payloads.size() < MPI_DEC_FREE_PAYLOADS)
+        {
+            free_payloads.push_back(std::move(item.data));
+        }
+    }
+}
+
+// 取帧线程：get按超时阻塞等待输出帧，帧回调也在这个线程上执行
+void MppDecoder::OutputLoop()
+{
+    MppCtx ctx = loop_data.ctx;
+    MppApi *mpi = loop_data.mpi;
+    while (!stopping)
+    {
+        MppFrame frame = NULL;
+        MPP_RET ret = mpi->decode_get_frame(ctx, &frame);
+        if (ret == MPP_ERR_TIMEOUT || (ret == MPP_OK && frame == NULL))
+        {
+            continue;
+        }
+        if (ret != MPP_OK)
+        {
+            // 出错时不能空转，等一个超时周期再取
+            LOGD("decode_get_frame failed ret %d ", ret);
+            usleep(MPI_DEC_POLL_TIMEOUT_MS * 1000);
+            continue;
+        }
+
+        HandleFrame(frame);
+        if (mpp_frame_get_eos(frame))
+        {
+            LOGD("found last frame ");
+        }
+        ret = mpp_frame_deinit(&frame);
+        if (ret != MPP_OK)
+        {
+            LOGD("Warning: mpp_frame_deinit failed with ret=%d", ret);
+        }
+
+        // try get runtime frame memory usage
+        if (loop_data.frm_grp)
+        {
+            size_t usage = mpp_buffer_group_usage(loop_data.frm_grp);
+            if (usage > loop_data.max_usage)
+                loop_data.max_usage = usage;
+        }
+    }
+}
 
-            // if last packet is send but last frame is not found continue
-            if (pkt_eos && pkt_done && !frm_eos)
+MppDecoder::InFlightPacket MppDecoder::MatchInFlight(int64_t frame_pts)
+{
+    InFlightPacket match = {frame_pts, 0};
+    std::lock_guard<std::mutex> lock(inflight_mutex);
+    if (inflight.empty())
+    {
+        return match;
+    }
+    // 参数集和解码失败的包没有输出帧，找到对应的包后把它之前的都清掉
+    for (size_t i = 0; i < inflight.size(); i++)
+    {
+        if (inflight[i].pts == frame_pts)
+        {
+            match = inflight[i];
+            inflight.erase(inflight.begin(), inflight.begin() + i + 1);
+            return match;
+        }
+    }
+    if (frame_pts == 0)
+    {
+        match = inflight.front();
+        inflight.pop_front();
+    }
+    return match;
+}
+
+void MppDecoder::HandleFrame(MppFrame frame)
+{
+    MpiDecLoopData *data = &loop_data;
+    MppCtx ctx = data->ctx;
+    MppApi *mpi = data->mpi;
+    MPP_RET ret = MPP_OK;
+
+    RK_U32 hor_stride = mpp_frame_get_hor_stride(frame);
+    RK_U32 ver_stride = mpp_frame_get_ver_stride(frame);
+    RK_U32 hor_width = mpp_frame_get_width(frame);
+    RK_U32 ver_height = mpp_frame_get_height(frame);
+    RK_U32 buf_size = mpp_frame_get_buf_size(frame);
+    RK_S64 pts = mpp_frame_get_pts(frame);
+
+    if (mpp_frame_get_info_change(frame))
+    {
+        LOGD("decode_get_frame get info changed found w:h [%d:%d] stride [%d:%d] buf_size %d ",
+             hor_width, ver_height, hor_stride, ver_stride, buf_size);
+        if (NULL == data->frm_grp)
+        {
+            /* If buffer group is not set create one and limit it */
+            ret = mpp_buffer_group_get_internal(&data->frm_grp, MPP_BUFFER_TYPE_DRM);
+            if (ret)
             {
-                usleep(1 * 1000);
-                continue;
+                LOGD("%p get mpp buffer group failed ret %d ", ctx, ret);
+                return;
             }
 
-            if (frm_eos)
+            /* Set buffer to mpp decoder */
+            ret = mpi->control(ctx, MPP_DEC_SET_EXT_BUF_GROUP, data->frm_grp);
+            if (ret)
             {
-                LOGD("found last frame ");
-                break;
+                LOGD("%p set buffer group failed ret %d ", ctx, ret);
+                return;
             }
-
-            if (data->frame_num > 0 && data->frame_count >= data->frame_num)
+        }
+        else
+        {
+            /* If old buffer group exist clear it */
+            UnregisterBuffers();
+            ret = mpp_buffer_group_clear(data->frm_grp);
+            if (ret)
             {
-                data->eos = 1;
-                break;
+                LOGD("%p clear buffer group failed ret %d ", ctx, ret);
+                return;
             }
+        }
 
-            if (get_frm)
-                continue;
-            break;
-        } while (1);
-
-        if (data->frame_num > 0 && data->frame_count >= data->frame_num)
+        /* Use limit config to limit buffer count to 24 with buf_size */
+        ret = mpp_buffer_group_limit_config(data->frm_grp, buf_size, MPI_DEC_BUFFER_COUNT);
+        if (ret)
         {
-            data->eos = 1;
-            LOGD("reach max frame number %d ", data->frame_count);
-            break;
+            LOGD("%p limit buffer group failed ret %d ", ctx, ret);
+            return;
         }
 
-        if (pkt_done)
-            break;
-
         /*
-         * why sleep here:
-         * mpi->decode_put_packet will failed when packet in internal queue is
-         * full,waiting the package is consumed .Usually hardware decode one
-         * frame which resolution is 1080p needs 2 ms,so here we sleep 3ms
-         * * is enough.
+         * All buffer group config done. Set info change ready to let
+         * decoder continue decoding
          */
-        usleep(3 * 1000);
-    } while (1);
+        ret = mpi->control(ctx, MPP_DEC_SET_INFO_CHANGE_READY, NULL);
+        if (ret)
+        {
+            LOGD("%p info change ready failed ret %d ", ctx, ret);
+        }
+        return;
+    }
 
-    // 🔧 修复: 在释放packet前检查是否为空，防止段错误
-    if (packet != NULL) {
-        mpp_packet_deinit(&packet);
-        packet = NULL;
-    } else {
-        LOGD("Warning: packet is NULL in deinit, skipping");
+    RK_U32 err_info = mpp_frame_get_errinfo(frame) | mpp_frame_get_discard(frame);
+    if (err_info)
+    {
+        LOGD("decoder_get_frame get err info:%d discard:%d. ",
+             mpp_frame_get_errinfo(frame), mpp_frame_get_discard(frame));
     }
+    data->frame_count++;
 
-    return ret;
+    InFlightPacket source = MatchInFlight(pts);
+    if (source.enqueue_us > 0)
+    {
+        latency_us_total += GetCurrentTimeUS() - source.enqueue_us;
+        frames_out++;
+    }
+
+    MppBuffer buffer = mpp_frame_get_buffer(frame);
+    if (callback == nullptr || buffer == NULL)
+    {
+        return;
+    }
+    // 增加缓冲区引用计数，防止在callback执行期间被释放
+    mpp_buffer_inc_ref(buffer);
+    MppFrameFormat format = mpp_frame_get_fmt(frame);
+    char *data_vir = (char *)mpp_buffer_get_ptr(buffer);
+    int fd = mpp_buffer_get_fd(buffer);
+    if (data_vir != NULL)
+    {
+        RegisterBuffer(buffer, fd, data_vir);
+        // 回调中可以用RetainCurrentFrame持有这块缓冲，避免同步拷贝
+        cur_buffer = buffer;
+        cur_width = hor_width;
+        cur_height = ver_height;
+        cur_hor_stride = hor_stride;
+        cur_ver_stride = ver_stride;
+        cur_pts = source.pts;
+        callback(this->userdata, hor_stride, ver_stride, hor_width, ver_height, format, fd, data_vir);
+        cur_buffer = NULL;
+    }
+    else
+    {
+        LOGD("Warning: data_vir is NULL, skipping callback");
+    }
+    mpp_buffer_put(buffer);
 }
 
 int MppDecoder::SetCallback(MppDecoderFrameCallback callback)
@@ -6,10 +6,24 @@
 #include "mpp_frame.h"
 #include <string.h>
 #include <pthread.h>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #define MPI_DEC_STREAM_SIZE         (SZ_4K)
 #define MPI_DEC_LOOP_COUNT          4
 #define MAX_FILE_NAME_LENGTH        256
+#define MPI_DEC_BUFFER_COUNT        24      // 解码输出缓冲组的缓冲数上限
+#define MPI_DEC_RETAIN_RESERVE      8       // 留给参考帧和解码输出的缓冲数，其余才允许被下游持有
+#define MPI_DEC_PACKET_QUEUE        64      // 等待送入解码器的包数上限，25fps约2.5秒
+#define MPI_DEC_POLL_TIMEOUT_MS     100     // 送包和取帧的阻塞超时，超时后检查是否要退出
+#define MPI_DEC_FREE_PAYLOADS       8       // 复用的包缓冲数
+
+struct FrameBuffer;
 
 typedef void (*MppDecoderFrameCallback)(void* userdata, int width_stride, int height_stride, int width, int height, int format, int fd, void* data);
 
@@ -38,10 +52,29 @@ public:
     MppApi *mpp_mpi         = NULL;
     MppDecoder();
     ~MppDecoder();
-    int Init(int video_type, int fps, void* userdata);
+    // 不按帧率限速，输出节奏由下游按时间戳控制
+    int Init(int video_type, void* userdata);
     int SetCallback(MppDecoderFrameCallback callback);
-    int Decode(uint8_t* pkt_data, int pkt_size, int pkt_eos);
+    // 拷贝到输入队列后立即返回，不阻塞调用线程（ZLMediaKit网络线程）；送包、取帧和帧回调都在解码器自己的线程上
+    // 队列满时丢弃积压的包，之后等到下一个关键帧再送入，避免缺少参考帧花屏；返回-1表示本包被丢弃
+    int Decode(uint8_t* pkt_data, int pkt_size, int pkt_eos, int64_t pts = 0, bool key_frame = false);
     int Reset();
+    // 停止送包和取帧线程并丢弃未送入的包，析构时自动调用；可以重复调用，之后的Decode会重新启动线程
+    void Stop();
+
+    // 只能在帧回调中调用：当前输出帧的时间戳，即对应的包送入Decode时的pts
+    int64_t GetCurrentFramePts() const { return cur_pts; }
+    int GetQueuedPackets();
+    unsigned long long GetDroppedPackets() const { return packets_dropped.load(); }
+    // 从Decode收到包到输出帧回调的平均耗时
+    double GetAverageLatencyMs() const;
+
+    // 只能在帧回调中调用：持有当前输出帧的解码缓冲，直到返回的FrameBuffer最后一个引用释放
+    // 被持有的缓冲数达到上限（缓冲组快用完）时返回nullptr，调用方需要自己拷贝数据
+    std::shared_ptr<FrameBuffer> RetainCurrentFrame();
+    int GetRetainedCount() const { return retained->load(); }
+    unsigned long long GetRetainedTotal() const { return retained_total.load(); }
+    unsigned long long GetRetainRejected() const { return retain_rejected.load(); }
 private:
     // base flow context
     MpiCmd mpi_cmd      = MPP_CMD_BASE;
@@ -53,14 +86,68 @@ private:
     size_t packet_size  = 2400*1300*3/2;
     MpiDecLoopData loop_data;
     // bool vedio_type;//判断vedio是h264/h265
-    MppPacket packet = NULL;
-    MppFrame  frame  = NULL;
-    pthread_t th=NULL;
-    MppDecoderFrameCallback callback;
-    int fps = -1;
-    unsigned long last_frame_time_ms = 0;
+    MppDecoderFrameCallback callback = nullptr;
 
     void* userdata = NULL;
+
+    // 输入队列：网络线程只拷贝入队，送包线程取出后阻塞送入解码器
+    struct QueuedPacket {
+        std::vector<uint8_t> data;
+        int64_t pts;
+        bool eos;
+        int64_t enqueue_us;
+    };
+    std::mutex queue_mutex;
+    std::condition_variable queue_cond;
+    std::deque<QueuedPacket> packet_queue;
+    std::vector<std::vector<uint8_t>> free_payloads;
+    bool key_seen = false;          // 调用方提供了关键帧标志，丢包后才能等关键帧恢复
+    bool waiting_key = false;
+    std::thread input_thread;
+    std::thread output_thread;
+    bool started = false;
+    std::atomic<bool> stopping{false};
+
+    // 已送入还没有输出的包，按pts找到输出帧对应的包，计算延迟；解码器没有带回pts时按顺序对应
+    struct InFlightPacket {
+        int64_t pts;
+        int64_t enqueue_us;
+    };
+    std::mutex inflight_mutex;
+    std::deque<InFlightPacket> inflight;
+    std::atomic<unsigned long long> packets_dropped{0};
+    std::atomic<unsigned long long> frames_out{0};
+    std::atomic<long long> latency_us_total{0};
+
+    void Start();
+    void InputLoop();
+    void OutputLoop();
+    void HandleFrame(MppFrame frame);
+    // 输出帧对应的包的pts和入队时间，没有找到时enqueue_us为0
+    InFlightPacket MatchInFlight(int64_t frame_pts);
+
+    int64_t cur_pts = 0;
+
+    // 回调期间的当前帧，供RetainCurrentFrame使用
+    MppBuffer cur_buffer = NULL;
+    RK_U32 cur_width = 0;
+    RK_U32 cur_height = 0;
+    RK_U32 cur_hor_stride = 0;
+    RK_U32 cur_ver_stride = 0;
+    // 下游持有的缓冲数，释放器也引用它，解码器销毁后缓冲仍可以安全归还
+    std::shared_ptr<std::atomic<int>> retained = std::make_shared<std::atomic<int>>(0);
+    std::atomic<unsigned long long> retained_total{0};
+    std::atomic<unsigned long long> retain_rejected{0};
+
+    // 登记到dma_buffer通知的缓冲组缓冲，RGA据此缓存导入句柄；缓冲组清空或释放时注销
+    struct RegisteredBuffer {
+        int fd;
+        void *ptr;
+        size_t size;
+    };
+    std::vector<RegisteredBuffer> registered_buffers;
+    void RegisterBuffer(MppBuffer buffer, int fd, void *ptr);
+    void UnregisterBuffers();
 };
 
 size_t mpp_frame_get_buf_size(const MppFrame s);
@@ -3,6 +3,7 @@
 
 #include "mpp_encoder.h"
 #include "mpp_buffer.h"
+#include "frame_buffer_pool.h"
 
 #define MPP_ALIGN(x, a) (((x) + (a)-1) & ~((a)-1))
 #define SZ_4K 4096
@@ -838,6 +839,15 @@ void *MppEncoder::ImportBuffer(int index, size_t size, int fd, int type)
     return buf;
 }
 
+void *MppEncoder::ImportFrameBuffer(int index, const FrameBuffer &buffer)
+{
+    if (!buffer.isDmaBuf())
+    {
+        return NULL;
+    }
+    return ImportBuffer(index, buffer.size, buffer.fd, MPP_BUFFER_TYPE_EXT_DMA);
+}
+
 void *MppEncoder::GetInputFrameBuffer()
 {
     int ret;
@@ -60,6 +60,8 @@ typedef struct
     MppEncSeiMode sei_mode;
 } MppEncoderParams;
 
+struct FrameBuffer;
+
 class MppEncoder {
   public:
     MppEncoder();
@@ -70,6 +72,8 @@ class MppEncoder {
     int GetHeader(char* enc_buf, int max_size);
     int Reset();
     void* ImportBuffer(int index, size_t size, int fd, int type);
+    // 帧缓冲池中的DMA-buf直接导入为编码输入，不是DMA-buf时返回NULL，需要拷贝到GetInputFrameBuffer
+    void* ImportFrameBuffer(int index, const FrameBuffer& buffer);
     size_t GetFrameSize();
     void* GetInputFrameBuffer();
     int GetInputFrameBufferFd(void* mpp_buffer);
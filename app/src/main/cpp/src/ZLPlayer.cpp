@@ -11,6 +11,13 @@
 #include "ZLPlayer.h"
 #include "mpp_err.h"
 #include "cv_draw.h"
+#include "cpu_topology.h"
+#include "cpu_budget.h"
+#include "npu_capacity_allocator.h"
+#include "memory_governor.h"
+#include "bandwidth_meter.h"
+#include "image_processor.h"
+#include "crop_scheduler.h"
 // Yolov8ThreadPool *yolov8_thread_pool;   // 线程池
 
 extern pthread_mutex_t windowMutex;     // 静态初始化 所
@@ -28,6 +35,9 @@ void *rtps_process(void *arg) {
         } else {
             LOGW("Failed to set RTSP thread priority for camera %d", player->app_ctx.camera_index);
         }
+        CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_STREAM, "rtsp_process");
+        // 该线程在get_detect_result中做颜色转换和画框，计入CPU预算
+        CpuBudgetScope budget(THREAD_ROLE_STREAM);
 
         player->process_video_rtsp();
     } else {
@@ -39,6 +49,7 @@ void *rtps_process(void *arg) {
 void *desplay_process(void *arg) {
     ZLPlayer *player = (ZLPlayer *) arg;
     if (player) {
+        CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_RENDER, "render");
         while (1) {
             player->display();
         }
@@ -132,6 +143,10 @@ void ZLPlayer::stopRtspStream() {
         } else {
             LOGW("RTSP thread join failed, result: %d", result);
         }
+        // 播放器已释放，不会再有新包；停掉解码线程，丢弃旧流残留的包，重启后从关键帧开始
+        if (app_ctx.decoder) {
+            app_ctx.decoder->Stop();
+        }
 
         pid_rtsp = 0;
         LOGD("RTSP stream stopped");
@@ -150,12 +165,19 @@ void ZLPlayer::setNativeWindow(ANativeWindow *window) {
 
     // 设置新的专用窗口
     dedicatedWindow = window;
+    displayTileW = 0;
+    displayTileH = 0;
     if (dedicatedWindow) {
         ANativeWindow_acquire(dedicatedWindow);
+        // 设置缓冲尺寸之前取到的是Surface的实际尺寸
+        displayTileW = ANativeWindow_getWidth(dedicatedWindow);
+        displayTileH = ANativeWindow_getHeight(dedicatedWindow);
         LOGD("Dedicated native window set for ZLPlayer instance");
     } else {
         LOGD("Dedicated native window cleared for ZLPlayer instance");
     }
+    app_ctx.display_window_w = displayTileW;
+    app_ctx.display_window_h = displayTileH;
 
     pthread_mutex_unlock(&windowMutex);
 }
@@ -176,28 +198,93 @@ void ZLPlayer::setPerformanceConfig(int cameraIndex, int totalCameras, bool perf
         app_ctx.thread_pool_size = 3;   // 更多摄像头时进一步减少
     }
 
-    LOGD("Camera %d performance config: threads=%d, performance_mode=%s",
-         cameraIndex, app_ctx.thread_pool_size, performanceMode ? "true" : "false");
+    // 推理队列深度：性能模式更严格，主摄像头允许更大队列
+    int maxPending = performanceMode ? 3 : 5;
+    if (cameraIndex == 0) {
+        maxPending += 2;
+    }
+    if (app_ctx.rateController) {
+        app_ctx.rateController->setMaxPendingInference(maxPending);
+        // 检测帧率由全局NPU算力分配决定
+        npu_admission_e admission = NpuCapacityAllocator::getInstance().registerCamera(cameraIndex, app_ctx.rateController);
+        if (admission != NPU_ADMISSION_ADMITTED) {
+            LOGW("Camera %d NPU admission state %d, detection fps %.1f", cameraIndex, admission,
+                 NpuCapacityAllocator::getInstance().getAllocatedFps(cameraIndex));
+        }
+    }
+
+    LOGD("Camera %d performance config: threads=%d, max pending=%d, performance_mode=%s",
+         cameraIndex, app_ctx.thread_pool_size, maxPending, performanceMode ? "true" : "false");
 }
 
-// 性能优化：优化线程池
+// 性能优化：按当前配置在运行时调整线程池大小，不需要重建播放器
 void ZLPlayer::optimizeThreadPool() {
-    if (app_ctx.yolov5ThreadPool && app_ctx.thread_pool_size > 0) {
-        // 重新初始化线程池（如果支持动态调整）
-        LOGD("Optimizing thread pool size to %d threads", app_ctx.thread_pool_size);
-        // 注意：这里可能需要根据Yolov5ThreadPool的实际API进行调整
+    if (app_ctx.yolov5ThreadPool && app_ctx.thread_pool_size > 0 && modelFileContent != nullptr) {
+        int current = app_ctx.yolov5ThreadPool->get_thread_count();
+        if (current == app_ctx.thread_pool_size) {
+            return;
+        }
+        LOGD("Camera %d resizing thread pool from %d to %d threads",
+             app_ctx.camera_index, current, app_ctx.thread_pool_size);
+        nn_error_e ret = app_ctx.yolov5ThreadPool->resize(app_ctx.thread_pool_size);
+        if (ret != NN_SUCCESS) {
+            LOGW("Camera %d thread pool resize incomplete: %d threads active",
+                 app_ctx.camera_index, app_ctx.yolov5ThreadPool->get_thread_count());
+        }
     }
 }
 
-// 性能优化：设置帧率限制
+// 性能优化：设置显示帧率限制
 void ZLPlayer::setFrameRateLimit(int targetFps) {
     if (targetFps > 0 && targetFps <= 60) {
-        int intervalMs = 1000 / targetFps;
-        nextRendTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(intervalMs);
-        LOGD("Frame rate limit set to %d FPS (%d ms interval)", targetFps, intervalMs);
+        if (app_ctx.rateController) {
+            app_ctx.rateController->setDisplayFps(targetFps);
+        }
+        LOGD("Camera %d display frame rate limit set to %d FPS", app_ctx.camera_index, targetFps);
+    }
+}
+
+// 性能优化：设置送推理帧率限制，<=0表示不限速（仅受队列深度限制）
+void ZLPlayer::setInferenceRateLimit(float targetFps) {
+    if (targetFps > 0 && targetFps <= 60) {
+        // 作为该摄像头的检测帧率上限交给算力分配器，实际帧率可能因算力不足更低
+        NpuCapacityAllocator &allocator = NpuCapacityAllocator::getInstance();
+        npu_camera_policy_t policy;
+        allocator.getCameraPolicy(app_ctx.camera_index, policy);
+        policy.maxFps = targetFps;
+        if (policy.minFps > targetFps) {
+            policy.minFps = targetFps;
+        }
+        allocator.setCameraPolicy(app_ctx.camera_index, policy);
+        LOGD("Camera %d inference frame rate limit set to %.1f FPS (allocated %.1f FPS)",
+             app_ctx.camera_index, targetFps, allocator.getAllocatedFps(app_ctx.camera_index));
+    }
+}
+
+void ZLPlayer::setMotionGate(float threshold, int keepAliveMs) {
+    if (app_ctx.motionDetector) {
+        app_ctx.motionDetector->configure(threshold, keepAliveMs);
+        LOGD("Camera %d motion gate: threshold %.4f, keep-alive %d ms", app_ctx.camera_index, threshold,
+             keepAliveMs);
     }
 }
 
+void ZLPlayer::setActivityGate(int mode, float threshold, bool skipDecode) {
+    if (mode < ACTIVITY_GATE_OFF || mode > ACTIVITY_GATE_CASCADE) {
+        LOGW("Camera %d invalid activity gate mode %d", app_ctx.camera_index, mode);
+        return;
+    }
+    if (app_ctx.activityEstimator) {
+        app_ctx.activityEstimator->configure((activity_gate_e) mode, threshold, skipDecode);
+        LOGD("Camera %d activity gate: mode %d, threshold %.2f, skip decode %d", app_ctx.camera_index, mode,
+             threshold, skipDecode);
+    }
+}
+
+float ZLPlayer::getActivityScore() {
+    return app_ctx.activityEstimator ? app_ctx.activityEstimator->getScore() : 0;
+}
+
 // 内存使用监控
 void ZLPlayer::logMemoryUsage() {
     // 读取进程内存信息
@@ -214,10 +301,20 @@ void ZLPlayer::logMemoryUsage() {
         fclose(file);
     }
 
+    // 各线程的CPU迁移统计是进程级的，只由主摄像头输出
+    if (app_ctx.camera_index == 0) {
+        CpuTopology::getInstance().logThreadStats();
+        CpuBudget::getInstance().logStatus();
+        NpuCapacityAllocator::getInstance().logStatus();
+        FrameBufferPool::getInstance().logStats();
+        rga_handle_cache_log_stats();
+        MemoryGovernor::getInstance().logStatus();
+    }
+
     // 记录线程池状态
     if (app_ctx.yolov5ThreadPool) {
-        LOGD("Camera %d ThreadPool status: configured with %d threads",
-             app_ctx.camera_index, app_ctx.thread_pool_size);
+        LOGD("Camera %d ThreadPool status: configured with %d threads, %d active",
+             app_ctx.camera_index, app_ctx.thread_pool_size, app_ctx.yolov5ThreadPool->get_thread_count());
     }
 }
 
@@ -235,6 +332,13 @@ bool ZLPlayer::isStuck() {
         return true;
     }
 
+    // 解码器持续输出完全相同的画面，码流已冻结，显示和检测都在空转
+    if (app_ctx.motionDetector && app_ctx.motionDetector->isFrozen()) {
+        app_ctx.is_stuck = true;
+        LOGW("Camera %d detected as stuck: stream frozen", app_ctx.camera_index);
+        return true;
+    }
+
     // 如果连续失败次数过多，也认为卡住
     if (app_ctx.consecutive_failures > 50) {
         app_ctx.is_stuck = true;
@@ -269,7 +373,16 @@ bool ZLPlayer::attemptRestart() {
     // 等待一段时间后重新启动
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
-    // 重新启动RTSP流
+    // 重新启动RTSP流，时间戳从新的流重新计算
+    if (app_ctx.rateController) {
+        app_ctx.rateController->reset();
+    }
+    if (app_ctx.motionDetector) {
+        app_ctx.motionDetector->reset();
+    }
+    if (app_ctx.activityEstimator) {
+        app_ctx.activityEstimator->reset();
+    }
     startRtspStream();
 
     // 重置状态
@@ -319,6 +432,9 @@ ZLPlayer::ZLPlayer(char *modelFileData, int modelDataLen) {
     app_ctx.camera_index = 0;
     app_ctx.performance_mode = true;
     app_ctx.last_frame_time = std::chrono::steady_clock::now();
+    app_ctx.rateController = new FrameRateController();
+    app_ctx.motionDetector = new MotionDetector();
+    app_ctx.activityEstimator = new PacketActivityEstimator();
 
     // 初始化卡住检测参数
     app_ctx.last_successful_frame = std::chrono::steady_clock::now();
@@ -332,6 +448,8 @@ ZLPlayer::ZLPlayer(char *modelFileData, int modelDataLen) {
     // yolov8_thread_pool = new Yolov8ThreadPool(); // 创建线程池
     // yolov8_thread_pool->setUpWithModelData(20, this->modelFileContent, this->modelFileSize);
     app_ctx.yolov5ThreadPool = new Yolov5ThreadPool(); // 创建线程池
+    // 流水线模式：预处理、NPU推理、后处理分级执行，thread_pool_size对应NPU上下文数（上限每核2个）
+    app_ctx.yolov5ThreadPool->setPipelineMode(true);
     if (this->modelFileContent != nullptr && this->modelFileSize > 0) {
         app_ctx.yolov5ThreadPool->setUpWithModelData(app_ctx.thread_pool_size, this->modelFileContent, this->modelFileSize);
         LOGD("YOLOv5 thread pool initialized with %d threads", app_ctx.thread_pool_size);
@@ -347,7 +465,7 @@ ZLPlayer::ZLPlayer(char *modelFileData, int modelDataLen) {
     if (app_ctx.decoder == nullptr) {
         LOGD("create decoder");
         MppDecoder *decoder = new MppDecoder();           // 创建解码器
-        decoder->Init(264, 25, &app_ctx);                 // 初始化解码器
+        decoder->Init(264, &app_ctx);                     // 初始化解码器
         decoder->SetCallback(mpp_decoder_frame_callback); // 设置回调函数，用来处理解码后的数据
         app_ctx.decoder = decoder;                        // 将解码器赋值给上下文
     } else {
@@ -362,26 +480,42 @@ void API_CALL
 
 on_track_frame_out(void *user_data, mk_frame frame) {
     rknn_app_context_t *ctx = (rknn_app_context_t *) user_data;
+    // ZLMediaKit的网络线程不是我们创建的，在首次回调时绑定CPU
+    static thread_local bool affinityApplied = false;
+    if (!affinityApplied) {
+        affinityApplied = true;
+        CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_NETWORK, "zlm_network");
+    }
     // LOGD("on_track_frame_out ctx=%p\n", ctx);
     const char *data = mk_frame_get_data(frame);
-    ctx->dts = mk_frame_get_dts(frame);
-    ctx->pts = mk_frame_get_pts(frame);
     size_t size = mk_frame_get_data_size(frame);
-    if (mk_frame_get_flags(frame) & MK_FRAME_FLAG_IS_KEY) {
+    int flags = mk_frame_get_flags(frame);
+    if (flags & MK_FRAME_FLAG_IS_KEY) {
         LOGD("Key frame size: %zu", size);
-    } else if (MK_FRAME_FLAG_DROP_ABLE & mk_frame_get_flags(frame)) {
+    } else if (MK_FRAME_FLAG_DROP_ABLE & flags) {
         LOGD("Drop able: %zu", size);
-    } else if (MK_FRAME_FLAG_IS_CONFIG & mk_frame_get_flags(frame)) {
+    } else if (MK_FRAME_FLAG_IS_CONFIG & flags) {
         LOGD("Config frame: %zu", size);
-    } else if (MK_FRAME_FLAG_NOT_DECODE_ABLE & mk_frame_get_flags(frame)) {
+    } else if (MK_FRAME_FLAG_NOT_DECODE_ABLE & flags) {
         LOGD("Not decode able: %zu", size);
     } else {
         // LOGD("P-frame: %zu", size);
     }
 
+    // 解码前按编码帧大小估计画面活动；空闲的非优先摄像头不解码非参考帧，时间戳也不更新
+    bool payload = !(flags & (MK_FRAME_FLAG_IS_CONFIG | MK_FRAME_FLAG_NOT_DECODE_ABLE));
+    if (payload && ctx->activityEstimator &&
+        !ctx->activityEstimator->onPacket(size, flags & MK_FRAME_FLAG_IS_KEY, flags & MK_FRAME_FLAG_DROP_ABLE,
+                                          !MemoryGovernor::getInstance().isPriorityCamera(ctx->camera_index))) {
+        return;
+    }
+    ctx->dts = mk_frame_get_dts(frame);
+    ctx->pts = mk_frame_get_pts(frame);
+
     // LOGD("ctx->dts :%ld, ctx->pts :%ld", ctx->dts, ctx->pts);
     // LOGD("decoder=%p\n", ctx->decoder);
-    ctx->decoder->Decode((uint8_t *) data, size, 0);
+    // 只拷贝入队，不等待解码；时间戳随包送入，解码输出时带回到帧回调
+    ctx->decoder->Decode((uint8_t *) data, size, 0, ctx->pts, flags & MK_FRAME_FLAG_IS_KEY);
 }
 
 void API_CALL
@@ -486,6 +620,7 @@ void ZLPlayer::renderFrameToWindow(uint8_t *src_data, int width, int height, int
     for (int h = 0; h < copy_height; h++) {
         memcpy(dst_data + h * dst_linesize, src_data + h * src_line_size, copy_width);
     }
+    BandwidthMeter::record(BW_SITE_RENDER_COPY, (int64_t) copy_width * copy_height, (int64_t) copy_width * copy_height);
 
     // 数据刷新
     ANativeWindow_unlockAndPost(targetWindow); // 解锁后 并且刷新 window_buffer的数据显示画面
@@ -562,6 +697,7 @@ void renderFrame(uint8_t *src_data, int width, int height, int src_line_size) {
         // 通用的
         memcpy(dst_data + i * dst_linesize, src_data + i * src_line_size, copy_width);
     }
+    BandwidthMeter::record(BW_SITE_RENDER_COPY, (int64_t) copy_width * copy_height, (int64_t) copy_width * copy_height);
 
     // 数据刷新
     ANativeWindow_unlockAndPost(window); // 解锁后 并且刷新 window_buffer的数据显示画面
@@ -585,7 +721,57 @@ void ZLPlayer::display() {
     nextRendTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(renderIntervalMs);
 }
 
+void ZLPlayer::getDisplayTileSize(int &width, int &height) {
+    if (!dedicatedWindow) {
+        return;
+    }
+    fitDisplayTile(displayTileW, displayTileH, width, height);
+}
+
+void ZLPlayer::fitDisplayTile(int windowW, int windowH, int &width, int &height) {
+    if (windowW <= 0 || windowH <= 0) {
+        return;
+    }
+    // RGA要求RGBA宽度16对齐；只缩小不放大，放大交给显示合成
+    int tileW = windowW & ~15;
+    int tileH = windowH & ~1;
+    if (tileW >= 64 && tileH >= 64 && (int64_t) tileW * tileH < (int64_t) width * height) {
+        width = tileW;
+        height = tileH;
+    }
+}
+
+// 同样几何尺寸下估算旧RGBA路径的流量：解码NV12->RGBA，预处理RGBA->RGB，送显RGBA->RGB->RGBA绘制，原尺寸拷贝到窗口
+// 两条路径共有的CPU预处理部分直接沿用实测值
+void ZLPlayer::recordFrameTraffic(const frame_data_t &frame, int tileW, int tileH, bool drew) {
+    double strided = (double) frame.widthStride * frame.heightStride;
+    double pixels = (double) frame.screenW * frame.screenH;
+    double tile = (double) tileW * tileH;
+    // 直接持有解码器缓冲的帧没有解码拷贝
+    bool copied = !(frame.buffer && frame.buffer->backend == FRAME_BACKEND_MPP);
+    double nv12Conversions = (copied ? strided * 1.5 * 2 : 0) + pixels * (1.5 + 3) + pixels * 1.5 + tile * 4 +
+                             tile * 4 * 2;
+    double rgbaConversions = strided * (1.5 + 4) + strided * (4 + 3) + (drew ? pixels * (4 + 3 + 3 + 4) : 0) +
+                             pixels * 4 * 2;
+    trafficBytes += frame.bytesMoved;
+    trafficLegacyBytes += frame.bytesMoved + (int64_t) (rgbaConversions - nv12Conversions);
+    trafficFrames++;
+}
+
+void ZLPlayer::logFrameTraffic() {
+    int frames = trafficFrames.exchange(0);
+    int64_t bytes = trafficBytes.exchange(0);
+    int64_t legacyBytes = trafficLegacyBytes.exchange(0);
+    if (frames <= 0) {
+        return;
+    }
+    LOGD("Camera %d frame traffic: %.0f KB/frame over %d frames (RGBA path would be %.0f KB/frame)",
+         app_ctx.camera_index, bytes / 1024.0 / frames, frames, legacyBytes / 1024.0 / frames);
+}
+
 void ZLPlayer::get_detect_result() {
+    // 送显阶段的转换和渲染拷贝都记到本摄像头
+    BandwidthCameraScope bandwidthScope(app_ctx.camera_index);
     try {
         std::vector<Detection> objects;
         // LOGD("decoder_callback Getting result count :%d", app_ctx.result_cnt);
@@ -596,8 +782,48 @@ void ZLPlayer::get_detect_result() {
             return;
         }
 
-        auto ret_code = app_ctx.yolov5ThreadPool->getTargetResultNonBlock(objects, app_ctx.result_cnt);
-        if (ret_code == NN_SUCCESS) {
+        // 按帧号顺序取结果，缺失的帧号由重排缓冲超时跳过，不会卡住显示
+        // 显示线程按固定间隔运行，送显帧率可能更高：一次取完已就绪的结果，只渲染最新的送显帧，积压不会越来越多
+        std::shared_ptr<frame_data_t> frameData;
+        std::vector<Detection> result;
+        std::shared_ptr<frame_data_t> readyFrame;
+        int superseded = 0;
+        nn_error_e ret_code;
+        while ((ret_code = app_ctx.yolov5ThreadPool->getNextResult(result, readyFrame)) == NN_SUCCESS) {
+            if (!readyFrame || !readyFrame->data) {
+                LOGE("Camera %d frameData is null or invalid", app_ctx.camera_index);
+                updateFrameStatus(false);
+                continue;
+            }
+            app_ctx.result_cnt++;
+
+            // 静止画面未推理的帧沿用前一个推理结果，检测框不会在两次推理之间闪烁
+            if (!readyFrame->inferenceSkipped) {
+                lastDetections = result;
+            }
+
+            // 送显帧率在解码回调中按码流时间戳判断，不送显的帧只取检测结果，不做颜色转换
+            if (readyFrame->displaySkipped) {
+                LOGD("Camera %d frame %d skipped display (rate limit)", app_ctx.camera_index, readyFrame->frameId);
+                readyFrame->releaseData();
+                updateFrameStatus(true);
+                continue;
+            }
+            if (frameData) {
+                frameData->releaseData();
+                superseded++;
+            }
+            frameData = readyFrame;
+        }
+        if (ret_code != NN_RESULT_NOT_READY) {
+            LOGW("Camera %d get_detect_result failed with code: %d", app_ctx.camera_index, ret_code);
+            updateFrameStatus(false);
+        }
+        if (superseded > 0) {
+            LOGD("Camera %d display behind, dropped %d older frames", app_ctx.camera_index, superseded);
+        }
+        if (frameData) {
+        objects = lastDetections;
 
         uint8_t idx;
         for (idx = 0; idx < objects.size(); idx++) {
@@ -605,79 +831,92 @@ void ZLPlayer::get_detect_result() {
             LOGD("objects[%d].prop: %f\n", idx, objects[idx].confidence);
             LOGD("objects[%d].class name: %s\n", idx, objects[idx].className.c_str());
         }
-        auto frameData = app_ctx.yolov5ThreadPool->getTargetImgResult(app_ctx.result_cnt);
-        if (!frameData || !frameData->data) {
-            LOGE("Camera %d frameData is null or invalid", app_ctx.camera_index);
+
+        LOGD("Camera %d Get detect result frame %d counter:%d start display",
+             app_ctx.camera_index, frameData->frameId, app_ctx.result_cnt);
+
+        // NV12 -> 窗口尺寸的RGBA，一次完成缩放和颜色转换，检测框直接画在RGBA上
+        int tileW = frameData->screenW;
+        int tileH = frameData->screenH;
+        getDisplayTileSize(tileW, tileH);
+        int srcFd = frameData->buffer && frameData->buffer->isDmaBuf() ? frameData->buffer->fd : -1;
+        frameData->memCharge.moveTo(MEM_STAGE_DISPLAY);
+        std::shared_ptr<FrameBuffer> displayBuffer;
+        MemoryCharge displayCharge;
+        long converted = -1;
+        if (frameData->displayBuffer && frameData->displayW == tileW && frameData->displayH == tileH) {
+            // 预处理时已经和模型输入在同一次RGA提交中生成
+            displayBuffer = frameData->displayBuffer;
+            frameData->displayCharge.moveTo(MEM_STAGE_DISPLAY);
+            converted = 0;
+        } else {
+            frameData->displayBuffer.reset();
+            frameData->displayCharge.release();
+            displayBuffer = FrameBufferPool::getInstance().acquire((size_t) tileW * tileH * 4);
+            displayCharge.assign(app_ctx.camera_index, MEM_STAGE_DISPLAY, (int64_t) tileW * tileH * 4);
+        }
+        if (displayBuffer && converted < 0) {
+            rga_image_t src = rga_image(srcFd, frameData->data, frameData->screenW, frameData->screenH,
+                                        frameData->frameFormat, frameData->widthStride, frameData->heightStride);
+            rga_image_t dst = rga_image(displayBuffer->isDmaBuf() ? displayBuffer->fd : -1, displayBuffer->data,
+                                        tileW, tileH, RK_FORMAT_RGBA_8888);
+            converted = ImageProcessor::getInstance().resize(src, dst);
+            if (converted >= 0) {
+                BandwidthMeter::record(BW_SITE_DISPLAY_CONVERT, rga_image_bytes(src), rga_image_bytes(dst));
+            }
+        }
+        if (converted < 0) {
+            LOGE("Camera %d frame %d display conversion failed", app_ctx.camera_index, frameData->frameId);
+            frameData->releaseData();
             updateFrameStatus(false);
             return;
         }
+        frameData->bytesMoved += converted;
 
-        app_ctx.result_cnt++;
-        LOGD("Camera %d Get detect result counter:%d start display", app_ctx.camera_index, app_ctx.result_cnt);
-        
-        // 在显示之前绘制检测框
-        if (objects.size() > 0) {
-            // 将RGBA数据转换为cv::Mat进行绘制
-            cv::Mat display_mat(frameData->screenH, frameData->screenW, CV_8UC4, frameData->data);
-            
-            // 转换为RGB格式进行绘制（OpenCV绘制需要RGB格式）
-            cv::Mat rgb_mat;
-            cv::cvtColor(display_mat, rgb_mat, cv::COLOR_RGBA2RGB);
-            
-            // 绘制检测框
-            DrawDetections(rgb_mat, objects);
-            LOGD("Drew %zu detection boxes", objects.size());
-            
-            // 转换回RGBA格式
-            cv::cvtColor(rgb_mat, display_mat, cv::COLOR_RGB2RGBA);
-        }
+        // CPU绘制和渲染拷贝前同步DMA-buf cache，否则可能读到RGA写入前的旧数据
+        displayBuffer->beginCpuAccess(true);
 
-        // 添加时间戳信息到日志中，帮助调试时间同步问题
-        struct timeval now;
-        gettimeofday(&now, NULL);
-        static struct timeval lastDisplayTime = {0, 0};
-        
-        if (lastDisplayTime.tv_sec != 0) {
-            long displayGap = (now.tv_sec - lastDisplayTime.tv_sec) * 1000 + 
-                             (now.tv_usec - lastDisplayTime.tv_usec) / 1000;
-            LOGD("Display interval: %ld ms", displayGap);
-            
-            // 如果显示间隔太短，适当延迟以保持帧率稳定
-            if (displayGap < 33) { // 约30fps
-                std::this_thread::sleep_for(std::chrono::milliseconds(33 - displayGap));
+        // 在显示之前绘制检测框，坐标从原图缩放到显示尺寸
+        if (objects.size() > 0) {
+            cv::Mat display_mat(tileH, tileW, CV_8UC4, displayBuffer->data);
+            float sx = (float) tileW / frameData->screenW;
+            float sy = (float) tileH / frameData->screenH;
+            for (auto &object: objects) {
+                object.box = cv::Rect(cvRound(object.box.x * sx), cvRound(object.box.y * sy),
+                                      cvRound(object.box.width * sx), cvRound(object.box.height * sy));
             }
+            DrawDetections(display_mat, objects);
+            LOGD("Drew %zu detection boxes", objects.size());
         }
-        lastDisplayTime = now;
 
         // 使用专用窗口渲染，如果没有专用窗口则使用全局窗口
+        int tileStride = tileW * 4;
         bool renderSuccess = false;
         try {
             if (dedicatedWindow) {
-                renderFrameToWindow((uint8_t *) frameData->data, frameData->screenW, frameData->screenH, frameData->screenStride, dedicatedWindow);
+                renderFrameToWindow((uint8_t *) displayBuffer->data, tileW, tileH, tileStride, dedicatedWindow);
                 renderSuccess = true;
             } else {
-                renderFrame((uint8_t *) frameData->data, frameData->screenW, frameData->screenH, frameData->screenStride);
+                renderFrame((uint8_t *) displayBuffer->data, tileW, tileH, tileStride);
                 renderSuccess = true;
             }
         } catch (...) {
             LOGE("Camera %d render failed", app_ctx.camera_index);
             renderSuccess = false;
         }
+        displayBuffer->endCpuAccess(true);
+        // 渲染时逐行拷贝到窗口缓冲
+        frameData->bytesMoved += (int64_t) tileStride * tileH * 2;
+        recordFrameTraffic(*frameData, tileW, tileH, !objects.empty());
 
-        // 释放内存
-        delete frameData->data;
-        frameData->data = nullptr;
+        // 释放内存，缓冲回到帧缓冲池
+        displayBuffer.reset();
+        displayCharge.release();
+        frameData->releaseData();
 
         // 更新帧状态
         updateFrameStatus(renderSuccess);
 
-    } else if (NN_RESULT_NOT_READY == ret_code) {
-        // 结果未准备好，不算失败
-        // LOGD("decoder_callback wait for result ready");
-    } else {
-        // 其他错误情况
-        LOGW("Camera %d get_detect_result failed with code: %d", app_ctx.camera_index, ret_code);
-        updateFrameStatus(false);
     }
 
     } catch (const std::exception& e) {
@@ -929,6 +1168,29 @@ int ZLPlayer::process_video_rtsp() {
                 // 定期记录内存使用情况
                 if (status_check_count % 200 == 0) { // 每20秒记录一次内存
                     logMemoryUsage();
+                    if (app_ctx.rateController) {
+                        app_ctx.rateController->logStats(app_ctx.camera_index);
+                    }
+                    if (app_ctx.motionDetector) {
+                        app_ctx.motionDetector->logStats(app_ctx.camera_index);
+                    }
+                    if (app_ctx.activityEstimator) {
+                        app_ctx.activityEstimator->logStats(app_ctx.camera_index);
+                    }
+                    CropScheduler::getInstance().logStats(app_ctx.camera_index);
+                    if (app_ctx.yolov5ThreadPool) {
+                        app_ctx.yolov5ThreadPool->getReorderBuffer().logStats(app_ctx.camera_index);
+                    }
+                    logFrameTraffic();
+                    BandwidthMeter::getInstance().logReport(app_ctx.camera_index);
+                    if (app_ctx.decoder) {
+                        LOGD("Camera %d decoder buffers: retained=%d zero-copy=%llu copied(group busy)=%llu",
+                             app_ctx.camera_index, app_ctx.decoder->GetRetainedCount(),
+                             app_ctx.decoder->GetRetainedTotal(), app_ctx.decoder->GetRetainRejected());
+                        LOGD("Camera %d decoder queue: queued=%d dropped=%llu avg latency=%.1f ms",
+                             app_ctx.camera_index, app_ctx.decoder->GetQueuedPackets(),
+                             app_ctx.decoder->GetDroppedPackets(), app_ctx.decoder->GetAverageLatencyMs());
+                    }
                 }
             }
 
@@ -966,6 +1228,11 @@ int ZLPlayer::process_video_rtsp() {
 ZLPlayer::~ZLPlayer() {
     LOGD("ZLPlayer destructor called - cleaning up resources");
 
+    // 0. 先停解码线程：帧回调会访问线程池、帧率控制器和画面检测器，必须在它们销毁前停止
+    if (app_ctx.decoder) {
+        app_ctx.decoder->Stop();
+    }
+
     // 1. 停止RTSP线程
     if (pid_rtsp != 0) {
         LOGD("Stopping RTSP thread in destructor");
@@ -1008,13 +1275,28 @@ ZLPlayer::~ZLPlayer() {
         LOGD("Cleaned up MPP decoder");
     }
 
-    // 6. 释放RTSP URL
+    // 6. 清理帧率控制器
+    if (app_ctx.rateController) {
+        NpuCapacityAllocator::getInstance().unregisterCamera(app_ctx.camera_index, app_ctx.rateController);
+        delete app_ctx.rateController;
+        app_ctx.rateController = nullptr;
+    }
+    if (app_ctx.motionDetector) {
+        delete app_ctx.motionDetector;
+        app_ctx.motionDetector = nullptr;
+    }
+    if (app_ctx.activityEstimator) {
+        delete app_ctx.activityEstimator;
+        app_ctx.activityEstimator = nullptr;
+    }
+
+    // 7. 释放RTSP URL
     if (rtsp_url != nullptr) {
         delete[] rtsp_url;
         rtsp_url = nullptr;
     }
 
-    // 7. 释放模型数据
+    // 8. 释放模型数据
     if (modelFileContent != nullptr) {
         delete[] modelFileContent;  // 🔧 修复: 使用delete[]释放new[]分配的内存
         modelFileContent = nullptr;
@@ -1023,29 +1305,68 @@ ZLPlayer::~ZLPlayer() {
     LOGD("ZLPlayer destructor completed");
 }
 
-static struct timeval lastRenderTime;
-
 void ZLPlayer::mpp_decoder_frame_callback(void *userdata, int width_stride, int height_stride, int width, int height, int format, int fd, void *data) {
     rknn_app_context_t *ctx = (rknn_app_context_t *) userdata;
     struct timeval start;
     struct timeval end;
     struct timeval memCpyEnd;
     gettimeofday(&start, NULL);
-    
-    // 使用RTSP时间戳进行更好的时间同步
-    static uint64_t lastPts = 0;
-    uint64_t currentPts = ctx->pts;
-    
-    long frameGap = start.tv_sec * 1000 + start.tv_usec / 1000 - lastRenderTime.tv_usec / 1000 - lastRenderTime.tv_sec * 1000;
-    
-    // 如果帧间隔太短（小于25ms），说明解码速度过快，需要控制
-    if (frameGap < 25 && lastRenderTime.tv_sec != 0) {
-        LOGD("Frame gap too short (%ld ms), skipping frame to maintain sync", frameGap);
-        return; // 跳过这一帧，保持同步
+    // 帧回调在MppDecoder的取帧线程上执行，线程由解码器创建，在首次回调时绑定CPU
+    static thread_local bool affinityApplied = false;
+    if (!affinityApplied) {
+        affinityApplied = true;
+        CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_NETWORK, "mpp_decoder");
+    }
+
+    // 使用RTSP时间戳进行时间同步，每路摄像头独立限速，不再互相抢占
+    // 解码器有输入队列，网络线程上的ctx->pts可能已经领先，要用这一帧自己的时间戳
+    uint64_t currentPts = ctx->decoder->GetCurrentFramePts();
+    int detectPoolSize = ctx->yolov5ThreadPool->get_task_size();
+    ctx->frame_cnt++;
+
+    // 送显和推理各自限速：送显帧率由setFrameRateLimit决定，不受NPU分配的检测帧率影响
+    bool shouldDisplay = ctx->rateController->admitDisplay(currentPts);
+    bool shouldInference = ctx->rateController->offerInference(currentPts, detectPoolSize);
+    if (!shouldInference) {
+        // 未送推理的帧仍然送显，不经过NPU直接进入重排缓冲；NPU分配拒绝的摄像头只显示不检测
+        LOGD("Camera %d Frame %d skipped inference (pool size: %d, max: %d, PTS: %lu)",
+             ctx->camera_index, ctx->frame_cnt, detectPoolSize,
+             ctx->rateController->getMaxPendingInference(), currentPts);
+    }
+
+    // 画面静止时不送推理：帧照常送显，沿用上一次的检测结果；门控的帧不消耗推理令牌
+    // 级联模式下先看压缩域活动，判定静止的帧不做像素门控
+    bool motionGated = false;
+    activity_gate_e activityMode = ctx->activityEstimator ? ctx->activityEstimator->getMode() : ACTIVITY_GATE_OFF;
+    bool packetInfer = activityMode == ACTIVITY_GATE_OFF || ctx->activityEstimator->admitInference();
+    rga_image_t luma = rga_image(fd, (char *) data, width, height, RK_FORMAT_YCbCr_420_SP, width_stride,
+                                 height_stride);
+    if (!shouldInference || (activityMode == ACTIVITY_GATE_CASCADE && !packetInfer)) {
+        // 不需要判断画面是否静止，但仍然低频检查冻结，否则压缩域判定静止的冻结码流永远不会被发现
+        motionGated = shouldInference;
+        if (ctx->motionDetector) {
+            ctx->motionDetector->observe(luma);
+        }
+    } else if (ctx->motionDetector) {
+        motionGated = !ctx->motionDetector->analyze(luma);
+        if (activityMode == ACTIVITY_GATE_SHADOW) {
+            ctx->activityEstimator->recordAgreement(ctx->motionDetector->isMoving());
+        }
+    }
+
+    if ((!shouldInference || motionGated) && !shouldDisplay) {
+        // 既不推理也不送显的帧直接跳过，不做拷贝，节省RGA和内存带宽
+        return;
+    }
+
+    // 全局在途帧内存接近上限时，先丢非优先摄像头的帧，再限制优先摄像头的队列深度
+    int64_t frameBytes = (int64_t) width_stride * height_stride * 3 / 2;
+    mem_admit_e memAdmit = MemoryGovernor::getInstance().admitFrame(ctx->camera_index, frameBytes, detectPoolSize);
+    if (memAdmit != MEM_ADMIT) {
+        LOGD("Camera %d Frame %d shed by memory governor (reason %d, pool size: %d)",
+             ctx->camera_index, ctx->frame_cnt, memAdmit, detectPoolSize);
+        return;
     }
-    
-    LOGD("mpp_decoder_frame_callback Frame gap: %ld ms, PTS: %lu", frameGap, currentPts);
-    gettimeofday(&lastRenderTime, NULL);
 
     // 12,441,600 3840x2160x3/2
     // int imgSize = width * height * get_bpp_from_format(RK_FORMAT_RGBA_8888);
@@ -1086,25 +1407,62 @@ void ZLPlayer::mpp_decoder_frame_callback(void *userdata, int width_stride, int
     return;
 #endif
 
-    int dstImgSize = width_stride * height_stride * get_bpp_from_format(RK_FORMAT_RGBA_8888);
+    // 队列中保持解码器输出的NV12，推理和显示各自只做一次到目标格式的转换
+    // 1080p: NV12 3133440字节，展开成RGBA是8355840字节
+    int dstImgSize = width_stride * height_stride * get_bpp_from_format(RK_FORMAT_YCbCr_420_SP);
     LOGD("img size is %d", dstImgSize);
-    // img size is 33177600 1080p: 8355840
-    char *dstBuf = new char[dstImgSize]();
-    // rga_change_color_async(width_stride, height_stride, RK_FORMAT_YCbCr_420_SP, (char *) data,
-    // width_stride, height_stride, RK_FORMAT_RGBA_8888, dstBuf);
-
-    rga_change_color(width_stride, height_stride, RK_FORMAT_YCbCr_420_SP, (char *) data,
-                     width_stride, height_stride, RK_FORMAT_RGBA_8888, dstBuf);
+    long copiedBytes = 0;
+    // 优先直接持有解码器缓冲，推理和显示读解码器内存；缓冲组快用完时才拷贝到帧缓冲池
+    std::shared_ptr<FrameBuffer> dstBuffer = ctx->decoder->RetainCurrentFrame();
+    if (!dstBuffer) {
+        // 从帧缓冲池取缓冲，RGA会写满整个缓冲，不需要清零
+        dstBuffer = FrameBufferPool::getInstance().acquire(dstImgSize);
+        if (!dstBuffer) {
+            LOGE("Camera %d frame buffer allocation failed, frame dropped", ctx->camera_index);
+            return;
+        }
+        // 解码器缓冲在回调返回后会被复用，拷贝一份NV12；DMA-buf缓冲按fd交给RGA
+        rga_image_t src = rga_image(fd, (char *) data, width_stride, height_stride, RK_FORMAT_YCbCr_420_SP);
+        rga_image_t dst = rga_image(dstBuffer->isDmaBuf() ? dstBuffer->fd : -1, dstBuffer->data, width_stride,
+                                    height_stride, RK_FORMAT_YCbCr_420_SP);
+        copiedBytes = ImageProcessor::getInstance().convert(src, dst);
+        if (copiedBytes < 0) {
+            LOGE("Camera %d NV12 frame copy failed, frame dropped", ctx->camera_index);
+            return;
+        }
+        BandwidthCameraScope bandwidthScope(ctx->camera_index);
+        BandwidthMeter::record(BW_SITE_DECODE_COPY, rga_image_bytes(src), rga_image_bytes(dst));
+    }
+    char *dstBuf = dstBuffer->data;
+    dstBuffer->width = width;
+    dstBuffer->height = height;
+    dstBuffer->widthStride = width_stride;
+    dstBuffer->heightStride = height_stride;
+    dstBuffer->format = RK_FORMAT_YCbCr_420_SP;
 
     auto frameData = std::make_shared<frame_data_t>();
     frameData->dataSize = dstImgSize;
-    frameData->screenStride = width * get_bpp_from_format(RK_FORMAT_RGBA_8888);
+    frameData->screenStride = width_stride;
+    frameData->bytesMoved = copiedBytes;
     frameData->data = dstBuf;
+    frameData->buffer = dstBuffer;
     frameData->screenW = width;
     frameData->screenH = height;
     frameData->heightStride = height_stride;
     frameData->widthStride = width_stride;
-    frameData->frameFormat = RK_FORMAT_RGBA_8888;
+    frameData->frameFormat = RK_FORMAT_YCbCr_420_SP;
+    frameData->cameraIndex = ctx->camera_index;
+    frameData->pts = currentPts;
+    frameData->memCharge.assign(ctx->camera_index, MEM_STAGE_DECODE, dstImgSize);
+    frameData->displaySkipped = !shouldDisplay;
+    // 有专用窗口时按送显尺寸让预处理顺带生成显示图，和模型输入一起提交给RGA
+    if (shouldDisplay && ctx->display_window_w > 0 && ctx->display_window_h > 0) {
+        int tileW = width;
+        int tileH = height;
+        fitDisplayTile(ctx->display_window_w, ctx->display_window_h, tileW, tileH);
+        frameData->displayW = tileW;
+        frameData->displayH = tileH;
+    }
 
     // LOGD(">>>>>  frame id:%d", frameData->frameId);
     // LOGD("mpp_decoder_frame_callback task list size :%d", ctx->mppDataThreadPool->get_task_size());
@@ -1113,40 +1471,37 @@ void ZLPlayer::mpp_decoder_frame_callback(void *userdata, int width_stride, int
     // ctx->renderFrameQueue->push(frameData);
 
     frameData->frameId = ctx->job_cnt;
-    int detectPoolSize = ctx->yolov5ThreadPool->get_task_size();
-    LOGD("detectPoolSize :%d", detectPoolSize);
-
-    // 添加帧跳跃控制，避免推理队列过载
-    // 但不能破坏时间同步机制
-    ctx->frame_cnt++;
-    
-    // 优化后的推理策略：统一每2帧处理1帧（50%处理率）
-    int maxQueueSize = ctx->performance_mode ? 3 : 5;  // 性能模式更严格的队列控制
-    int frameSkip = 2;  // 统一设置为每2帧处理1帧，提高检测频率
 
-    // 根据摄像头优先级调整处理策略
-    bool isHighPriority = (ctx->camera_index == 0);  // 第一个摄像头优先级最高
-    if (isHighPriority) {
-        maxQueueSize += 2;  // 高优先级摄像头允许更大队列
-        // 高优先级摄像头保持每2帧处理1帧，不再进一步减少跳帧
-        // frameSkip 保持为2，确保所有摄像头使用统一的处理频率
+    if (!shouldInference || motionGated) {
+        // 不经过NPU，按帧号直接放入重排缓冲，和推理结果一起按序送显
+        // 检测暂停时不沿用旧的检测框，送一个空结果把画面上的框清掉
+        frameData->inferenceSkipped = !ctx->rateController->isInferencePaused();
+        frameData->memCharge.moveTo(MEM_STAGE_REORDER);
+        ctx->yolov5ThreadPool->getReorderBuffer().push(frameData->frameId, std::vector<Detection>(), frameData);
+        ctx->job_cnt++;
+        if (motionGated) {
+            LOGD("Camera %d Frame %d skipped inference (static scene)", ctx->camera_index, ctx->frame_cnt);
+        }
+        return;
     }
 
-    bool shouldInference = (ctx->frame_cnt % frameSkip == 0 && detectPoolSize < maxQueueSize);
-
-    if (shouldInference) {
-        // 提交推理任务
-        ctx->yolov5ThreadPool->submitTask(frameData);
+    // 提交推理任务，提交可能阻塞，阻塞期间也算在推理阶段
+    frameData->memCharge.moveTo(MEM_STAGE_INFERENCE);
+    BandwidthMeter::getInstance().countFrame(ctx->camera_index);
+    nn_error_e submitted = ctx->yolov5ThreadPool->submitTask(frameData);
+    if (submitted != NN_SUCCESS) {
+        // 线程池调整或模型切换期间没有推理实例：帧号仍要交给重排缓冲，否则显示要等缺帧超时；不消耗推理令牌
+        LOGW("Camera %d Frame %d submit failed (%d), display only", ctx->camera_index, ctx->frame_cnt, submitted);
+        frameData->inferenceSkipped = true;
+        frameData->memCharge.moveTo(MEM_STAGE_REORDER);
+        ctx->yolov5ThreadPool->getReorderBuffer().push(frameData->frameId, std::vector<Detection>(), frameData);
         ctx->job_cnt++;
-        LOGD("Camera %d Frame %d submitted to inference pool (priority: %s, skip_rate: 1/2)",
-             ctx->camera_index, ctx->frame_cnt, isHighPriority ? "high" : "normal");
-    } else {
-        // 跳过推理，直接释放内存
-        delete frameData->data;
-        frameData->data = nullptr;
-        LOGD("Camera %d Frame %d skipped inference (pool size: %d, max: %d, skip_rate: 1/2)",
-             ctx->camera_index, ctx->frame_cnt, detectPoolSize, maxQueueSize);
+        return;
     }
+    ctx->rateController->commitInference();
+    ctx->job_cnt++;
+    LOGD("Camera %d Frame %d submitted to inference pool (pool size: %d, PTS: %lu)",
+         ctx->camera_index, ctx->frame_cnt, detectPoolSize, currentPts);
 
     //    if (ctx->frame_cnt % 2 == 1) {
     //        // if (detectPoolSize < MAX_TASK) {
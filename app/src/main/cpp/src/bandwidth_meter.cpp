@@ -0,0 +1,191 @@
+#include "bandwidth_meter.h"
+#include "log4c.h"
+
+#include <algorithm>
+#include <string>
+#include <sys/time.h>
+
+static thread_local int g_bw_camera = -1;
+
+// 线程自己的计数器，线程退出时交回BandwidthMeter
+struct BandwidthThreadSlot {
+    BandwidthMeter::Counters *counters;
+
+    BandwidthThreadSlot() : counters(nullptr) {}
+
+    ~BandwidthThreadSlot() {
+        if (counters) {
+            BandwidthMeter::getInstance().retire(counters);
+        }
+    }
+};
+
+static thread_local BandwidthThreadSlot g_bw_slot;
+
+static int64_t now_us() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// 只有所属线程写，relaxed读改写即可，不需要原子加
+static inline void add_relaxed(std::atomic<uint64_t> &counter, int64_t bytes) {
+    counter.store(counter.load(std::memory_order_relaxed) + (uint64_t) bytes, std::memory_order_relaxed);
+}
+
+BandwidthMeter::Counters::Counters() {
+    for (int i = 0; i < BW_METER_MAX_CAMERAS; i++) {
+        for (int j = 0; j < BW_SITE_COUNT; j++) {
+            read[i][j].store(0);
+            written[i][j].store(0);
+        }
+    }
+}
+
+BandwidthMeter &BandwidthMeter::getInstance() {
+    // 不析构：线程退出时还会交回计数
+    static BandwidthMeter *instance = new BandwidthMeter();
+    return *instance;
+}
+
+BandwidthMeter::BandwidthMeter() {
+    int64_t now = now_us();
+    for (int i = 0; i < BW_METER_MAX_CAMERAS; i++) {
+        frames_[i].store(0);
+        for (int j = 0; j < BW_SITE_COUNT; j++) {
+            lastRead_[i][j] = 0;
+            lastWritten_[i][j] = 0;
+        }
+        lastFrames_[i] = 0;
+        lastReportUs_[i] = now;
+    }
+}
+
+const char *BandwidthMeter::siteName(bw_site_e site) {
+    switch (site) {
+        case BW_SITE_DECODE_COPY:
+            return "decode_copy";
+        case BW_SITE_PREPROCESS_RGA:
+            return "preprocess_rga";
+        case BW_SITE_LETTERBOX:
+            return "letterbox";
+        case BW_SITE_TENSOR:
+            return "tensor";
+        case BW_SITE_NPU_OUTPUT:
+            return "npu_output";
+        case BW_SITE_DISPLAY_CONVERT:
+            return "display_convert";
+        case BW_SITE_RENDER_COPY:
+            return "render_copy";
+        default:
+            return "unknown";
+    }
+}
+
+void BandwidthMeter::setCurrentCamera(int cameraIndex) {
+    g_bw_camera = cameraIndex;
+}
+
+int BandwidthMeter::getCurrentCamera() {
+    return g_bw_camera;
+}
+
+BandwidthMeter::Counters *BandwidthMeter::registerThread() {
+    Counters *counters = new Counters();
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(counters);
+    return counters;
+}
+
+void BandwidthMeter::retire(Counters *counters) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < BW_METER_MAX_CAMERAS; i++) {
+        for (int j = 0; j < BW_SITE_COUNT; j++) {
+            retired_.read[i][j] += counters->read[i][j].load();
+            retired_.written[i][j] += counters->written[i][j].load();
+        }
+    }
+    threads_.erase(std::remove(threads_.begin(), threads_.end(), counters), threads_.end());
+    delete counters;
+}
+
+void BandwidthMeter::record(bw_site_e site, int64_t readBytes, int64_t writtenBytes) {
+    int camera = g_bw_camera;
+    if (camera < 0 || camera >= BW_METER_MAX_CAMERAS || site < 0 || site >= BW_SITE_COUNT) {
+        return;
+    }
+    if (!g_bw_slot.counters) {
+        g_bw_slot.counters = getInstance().registerThread();
+    }
+    add_relaxed(g_bw_slot.counters->read[camera][site], readBytes);
+    add_relaxed(g_bw_slot.counters->written[camera][site], writtenBytes);
+}
+
+void BandwidthMeter::countFrame(int cameraIndex) {
+    if (cameraIndex >= 0 && cameraIndex < BW_METER_MAX_CAMERAS) {
+        frames_[cameraIndex]++;
+    }
+}
+
+void BandwidthMeter::snapshot(int cameraIndex, uint64_t *read, uint64_t *written) {
+    for (int j = 0; j < BW_SITE_COUNT; j++) {
+        read[j] = retired_.read[cameraIndex][j].load();
+        written[j] = retired_.written[cameraIndex][j].load();
+    }
+    for (size_t i = 0; i < threads_.size(); i++) {
+        for (int j = 0; j < BW_SITE_COUNT; j++) {
+            read[j] += threads_[i]->read[cameraIndex][j].load(std::memory_order_relaxed);
+            written[j] += threads_[i]->written[cameraIndex][j].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void BandwidthMeter::logReport(int cameraIndex) {
+    if (cameraIndex < 0 || cameraIndex >= BW_METER_MAX_CAMERAS) {
+        return;
+    }
+    uint64_t read[BW_SITE_COUNT];
+    uint64_t written[BW_SITE_COUNT];
+    uint64_t deltaRead[BW_SITE_COUNT];
+    uint64_t deltaWritten[BW_SITE_COUNT];
+    uint64_t frames;
+    double seconds;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot(cameraIndex, read, written);
+        for (int j = 0; j < BW_SITE_COUNT; j++) {
+            deltaRead[j] = read[j] - lastRead_[cameraIndex][j];
+            deltaWritten[j] = written[j] - lastWritten_[cameraIndex][j];
+            lastRead_[cameraIndex][j] = read[j];
+            lastWritten_[cameraIndex][j] = written[j];
+        }
+        uint64_t totalFrames = frames_[cameraIndex].load();
+        frames = totalFrames - lastFrames_[cameraIndex];
+        lastFrames_[cameraIndex] = totalFrames;
+        int64_t now = now_us();
+        seconds = (now - lastReportUs_[cameraIndex]) / 1000000.0;
+        lastReportUs_[cameraIndex] = now;
+    }
+
+    uint64_t total = 0;
+    for (int j = 0; j < BW_SITE_COUNT; j++) {
+        total += deltaRead[j] + deltaWritten[j];
+    }
+    if (total == 0 || seconds <= 0) {
+        return;
+    }
+    double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+    LOGD("Camera %d bandwidth: %.1f MB/s, %.0f KB/frame over %llu frames in %.1f s", cameraIndex,
+         total / seconds / (1024.0 * 1024.0), total * perFrame / 1024.0, (unsigned long long) frames, seconds);
+    std::string detail;
+    char item[96];
+    for (int j = 0; j < BW_SITE_COUNT; j++) {
+        if (deltaRead[j] == 0 && deltaWritten[j] == 0) {
+            continue;
+        }
+        snprintf(item, sizeof(item), " %s=%.0f/%.0f", siteName((bw_site_e) j), deltaRead[j] * perFrame / 1024.0,
+                 deltaWritten[j] * perFrame / 1024.0);
+        detail += item;
+    }
+    LOGD("Camera %d bandwidth per frame (read/written KB):%s", cameraIndex, detail.c_str());
+}
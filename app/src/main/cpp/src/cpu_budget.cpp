@@ -0,0 +1,113 @@
+#include "cpu_budget.h"
+#include "log4c.h"
+
+#include <opencv2/core.hpp>
+
+// AUTO模式下每个角色最多给OpenCV的线程数
+#define CV_BUDGET_DEFAULT_CAP 2
+
+CpuBudget &CpuBudget::getInstance() {
+    static CpuBudget instance;
+    return instance;
+}
+
+CpuBudget::CpuBudget() : appliedThreads_(-1), changes_(0) {
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        activeWorkers_[i] = 0;
+        modes_[i] = CV_BUDGET_AUTO;
+        caps_[i] = CV_BUDGET_DEFAULT_CAP;
+    }
+    // 网络线程只做解码回调里的RGA转换，不调用OpenCV
+    modes_[THREAD_ROLE_NETWORK] = CV_BUDGET_SINGLE;
+}
+
+bool CpuBudget::setRolePolicy(thread_role_e role, cv_budget_mode_e mode, int cap) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT || mode < CV_BUDGET_AUTO || mode > CV_BUDGET_CAPPED) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    modes_[role] = mode;
+    caps_[role] = cap > 0 ? cap : 1;
+    LOGD("CpuBudget: role %s policy mode=%d cap=%d", thread_role_name(role), mode, caps_[role]);
+    applyLocked();
+    return true;
+}
+
+void CpuBudget::workerStarted(thread_role_e role) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    activeWorkers_[role]++;
+    applyLocked();
+}
+
+void CpuBudget::workerStopped(thread_role_e role) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (activeWorkers_[role] > 0) {
+        activeWorkers_[role]--;
+    }
+    applyLocked();
+}
+
+int CpuBudget::getActiveWorkers(thread_role_e role) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return activeWorkers_[role];
+}
+
+int CpuBudget::getOpenCVThreads() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appliedThreads_;
+}
+
+// cv::setNumThreads是进程级的，所以各角色的策略取最小值：只要有一个角色要求单线程，整体就单线程
+int CpuBudget::computeThreadsLocked() {
+    int threads = CpuTopology::getInstance().getCpuCount();
+    for (int role = 0; role < THREAD_ROLE_COUNT; role++) {
+        if (activeWorkers_[role] == 0) {
+            continue;
+        }
+        int roleThreads;
+        if (modes_[role] == CV_BUDGET_SINGLE) {
+            roleThreads = 1;
+        } else if (modes_[role] == CV_BUDGET_CAPPED) {
+            roleThreads = caps_[role];
+        } else {
+            int roleCpus = (int) CpuTopology::getInstance().getRoleCpus((thread_role_e) role).size();
+            int idle = roleCpus - activeWorkers_[role];
+            roleThreads = idle > caps_[role] ? caps_[role] : idle;
+        }
+        if (roleThreads < threads) {
+            threads = roleThreads;
+        }
+    }
+    return threads < 1 ? 1 : threads;
+}
+
+void CpuBudget::applyLocked() {
+    int threads = computeThreadsLocked();
+    if (threads == appliedThreads_) {
+        return;
+    }
+    cv::setNumThreads(threads);
+    LOGD("CpuBudget: OpenCV threads %d -> %d (workers: network=%d stream=%d inference=%d render=%d)",
+         appliedThreads_, threads,
+         activeWorkers_[THREAD_ROLE_NETWORK], activeWorkers_[THREAD_ROLE_STREAM],
+         activeWorkers_[THREAD_ROLE_INFERENCE], activeWorkers_[THREAD_ROLE_RENDER]);
+    appliedThreads_ = threads;
+    changes_++;
+}
+
+void CpuBudget::logStatus() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LOGD("CpuBudget: OpenCV threads=%d (reported %d), changes=%llu, workers: network=%d stream=%d inference=%d render=%d",
+         appliedThreads_, cv::getNumThreads(), (unsigned long long) changes_,
+         activeWorkers_[THREAD_ROLE_NETWORK], activeWorkers_[THREAD_ROLE_STREAM],
+         activeWorkers_[THREAD_ROLE_INFERENCE], activeWorkers_[THREAD_ROLE_RENDER]);
+}
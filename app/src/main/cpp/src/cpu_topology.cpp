@@ -0,0 +1,343 @@
+#include "cpu_topology.h"
+#include "log4c.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+static const char *g_thread_role_names[THREAD_ROLE_COUNT] = {"network", "stream", "inference", "render"};
+
+const char *thread_role_name(thread_role_e role) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        return "unknown";
+    }
+    return g_thread_role_names[role];
+}
+
+static bool read_long_from_file(const std::string &path, long long &value) {
+    FILE *fp = fopen(path.c_str(), "r");
+    if (!fp) {
+        return false;
+    }
+    bool ok = fscanf(fp, "%lld", &value) == 1;
+    fclose(fp);
+    return ok;
+}
+
+// 在 /proc 文件中查找 "key ... value" 形式的行
+static bool read_proc_field(const std::string &path, const char *key, long long &value) {
+    FILE *fp = fopen(path.c_str(), "r");
+    if (!fp) {
+        return false;
+    }
+    char line[256];
+    size_t keyLen = strlen(key);
+    bool found = false;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, keyLen) == 0) {
+            char *p = line + keyLen;
+            while (*p == ' ' || *p == '\t' || *p == ':') {
+                p++;
+            }
+            value = atoll(p);
+            found = true;
+            break;
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+// /proc/<tid>/stat 第39个字段是线程最近运行的CPU
+static int read_last_cpu(pid_t tid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int) tid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+
+    char *p = strrchr(buf, ')');
+    if (!p) {
+        return -1;
+    }
+    int field = 2;
+    while (*p && field < 39) {
+        if (*p == ' ') {
+            field++;
+        }
+        p++;
+    }
+    return field == 39 ? atoi(p) : -1;
+}
+
+static pid_t current_tid() {
+    return (pid_t) syscall(SYS_gettid);
+}
+
+static bool bind_thread(pid_t tid, const std::vector<int> &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); i++) {
+        CPU_SET(cpus[i], &set);
+    }
+    return sched_setaffinity(tid, sizeof(cpu_set_t), &set) == 0;
+}
+
+CpuTopology &CpuTopology::getInstance() {
+    static CpuTopology instance;
+    return instance;
+}
+
+CpuTopology::CpuTopology() : loaded_(false) {
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        roleOverridden_[i] = false;
+    }
+}
+
+bool CpuTopology::load(const std::string &sysfsRoot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sysfsRoot_ = sysfsRoot;
+    capacities_.clear();
+    bigCores_.clear();
+    littleCores_.clear();
+
+    // 依次探测cpu0、cpu1...，没有cpu_capacity的内核视为同构CPU
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/cpu%d", sysfsRoot.c_str(), cpu);
+        if (access(path, F_OK) != 0) {
+            break;
+        }
+        long long capacity = 1024;
+        snprintf(path, sizeof(path), "%s/cpu%d/cpu_capacity", sysfsRoot.c_str(), cpu);
+        read_long_from_file(path, capacity);
+        capacities_.push_back((int) capacity);
+    }
+
+    if (capacities_.empty()) {
+        long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+        for (long cpu = 0; cpu < cpuCount; cpu++) {
+            capacities_.push_back(1024);
+        }
+        LOGW("CpuTopology: no cpu entries under %s, assuming %ld symmetric CPUs", sysfsRoot.c_str(), cpuCount);
+    }
+
+    int maxCapacity = *std::max_element(capacities_.begin(), capacities_.end());
+    for (int cpu = 0; cpu < (int) capacities_.size(); cpu++) {
+        if (capacities_[cpu] == maxCapacity) {
+            bigCores_.push_back(cpu);
+        } else {
+            littleCores_.push_back(cpu);
+        }
+        LOGD("CpuTopology: cpu%d capacity=%d (%s)", cpu, capacities_[cpu],
+             capacities_[cpu] == maxCapacity ? "big" : "little");
+    }
+
+    buildDefaultRoles();
+    loaded_ = true;
+    return true;
+}
+
+// 默认映射：推理和网络解码放大核，取结果画框和渲染放小核；同构CPU时不限制
+void CpuTopology::buildDefaultRoles() {
+    std::vector<int> all;
+    for (int cpu = 0; cpu < (int) capacities_.size(); cpu++) {
+        all.push_back(cpu);
+    }
+    const std::vector<int> &little = littleCores_.empty() ? all : littleCores_;
+
+    std::vector<int> defaults[THREAD_ROLE_COUNT];
+    defaults[THREAD_ROLE_NETWORK] = bigCores_;
+    defaults[THREAD_ROLE_INFERENCE] = bigCores_;
+    defaults[THREAD_ROLE_STREAM] = little;
+    defaults[THREAD_ROLE_RENDER] = little;
+
+    for (int role = 0; role < THREAD_ROLE_COUNT; role++) {
+        if (!roleOverridden_[role]) {
+            roleCpus_[role] = littleCores_.empty() ? all : defaults[role];
+        }
+    }
+}
+
+bool CpuTopology::parseCpuList(const std::string &cpuList, std::vector<int> &cpus) {
+    cpus.clear();
+    size_t pos = 0;
+    while (pos < cpuList.size()) {
+        size_t end = cpuList.find(',', pos);
+        if (end == std::string::npos) {
+            end = cpuList.size();
+        }
+        std::string item = cpuList.substr(pos, end - pos);
+        pos = end + 1;
+        if (item.empty()) {
+            continue;
+        }
+
+        int first = 0;
+        int last = 0;
+        int matched = sscanf(item.c_str(), "%d-%d", &first, &last);
+        if (matched == 1) {
+            last = first;
+        } else if (matched != 2) {
+            return false;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return true;
+}
+
+bool CpuTopology::configureRole(thread_role_e role, const std::string &cpuList) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        return false;
+    }
+    if (!loaded_) {
+        load();
+    }
+    std::vector<int> cpus;
+    if (!parseCpuList(cpuList, cpus)) {
+        LOGE("CpuTopology: invalid cpu list '%s' for role %s", cpuList.c_str(), thread_role_name(role));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] >= (int) capacities_.size()) {
+            LOGE("CpuTopology: cpu%d in '%s' does not exist (%zu CPUs)", cpus[i], cpuList.c_str(),
+                 capacities_.size());
+            return false;
+        }
+    }
+    roleOverridden_[role] = !cpus.empty();
+    if (cpus.empty()) {
+        buildDefaultRoles();
+    } else {
+        roleCpus_[role] = cpus;
+    }
+    LOGD("CpuTopology: role %s configured with '%s'", thread_role_name(role), cpuList.c_str());
+
+    // 已经启动的该角色线程立即按新的CPU集合重新绑定，之后启动的线程在applyToCurrentThread中绑定
+    if (!roleCpus_[role].empty()) {
+        for (const ThreadRecord &record: threads_) {
+            char base[64];
+            snprintf(base, sizeof(base), "/proc/self/task/%d", (int) record.tid);
+            if (record.role != role || access(base, F_OK) != 0) {
+                continue;
+            }
+            if (!bind_thread(record.tid, roleCpus_[role])) {
+                LOGW("Thread %s (tid %d) rebind failed for role %s", record.name.c_str(), (int) record.tid,
+                     thread_role_name(role));
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<int> CpuTopology::getRoleCpus(thread_role_e role) {
+    if (!loaded_) {
+        load();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        return std::vector<int>();
+    }
+    return roleCpus_[role];
+}
+
+std::vector<int> CpuTopology::getBigCores() {
+    if (!loaded_) {
+        load();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bigCores_;
+}
+
+std::vector<int> CpuTopology::getLittleCores() {
+    if (!loaded_) {
+        load();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return littleCores_;
+}
+
+int CpuTopology::getCpuCount() {
+    if (!loaded_) {
+        load();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (int) capacities_.size();
+}
+
+bool CpuTopology::applyToCurrentThread(thread_role_e role, const char *threadName) {
+    std::vector<int> cpus = getRoleCpus(role);
+    pid_t tid = current_tid();
+
+    bool applied = false;
+    if (!cpus.empty()) {
+        if (bind_thread(0, cpus)) {
+            applied = true;
+            LOGD("Thread %s (tid %d) bound to %zu CPUs for role %s",
+                 threadName ? threadName : "", (int) tid, cpus.size(), thread_role_name(role));
+        } else {
+            LOGW("Thread %s (tid %d) sched_setaffinity failed for role %s",
+                 threadName ? threadName : "", (int) tid, thread_role_name(role));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThreadRecord record;
+    record.tid = tid;
+    record.role = role;
+    record.name = threadName ? threadName : "";
+    record.lastMigrations = 0;
+    record.lastSwitches = 0;
+    threads_.push_back(record);
+    return applied;
+}
+
+void CpuTopology::logThreadStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = threads_.begin(); it != threads_.end();) {
+        char base[64];
+        snprintf(base, sizeof(base), "/proc/self/task/%d", (int) it->tid);
+        if (access(base, F_OK) != 0) {
+            // 线程已退出
+            it = threads_.erase(it);
+            continue;
+        }
+
+        long long migrations = -1;
+        read_proc_field(std::string(base) + "/sched", "se.nr_migrations", migrations);
+
+        long long voluntary = 0;
+        long long involuntary = 0;
+        read_proc_field(std::string(base) + "/status", "voluntary_ctxt_switches", voluntary);
+        read_proc_field(std::string(base) + "/status", "nonvoluntary_ctxt_switches", involuntary);
+        long long switches = voluntary + involuntary;
+
+        int lastCpu = read_last_cpu(it->tid);
+        LOGD("Thread %s (tid %d, role %s): cpu=%d migrations=%lld (+%lld) ctx switches=%lld (+%lld, involuntary %lld)",
+             it->name.c_str(), (int) it->tid, thread_role_name(it->role), lastCpu,
+             migrations, migrations >= 0 ? migrations - it->lastMigrations : 0,
+             switches, switches - it->lastSwitches, involuntary);
+
+        if (migrations >= 0) {
+            it->lastMigrations = migrations;
+        }
+        it->lastSwitches = switches;
+        ++it;
+    }
+}
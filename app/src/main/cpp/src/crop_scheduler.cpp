@@ -0,0 +1,194 @@
+#include "crop_scheduler.h"
+#include "log4c.h"
+#include "tile_layout.h"
+#include "image_processor.h"
+
+#include <algorithm>
+
+static bool valid_camera(int cameraIndex) {
+    return cameraIndex >= 0 && cameraIndex < CROP_MAX_CAMERAS;
+}
+
+// 预测框放大并裁到画面内，坐标和尺寸对齐到偶数
+static cv::Rect expand_box(const cv::Rect &box, int frameWidth, int frameHeight) {
+    int width = std::max(cvRound(box.width * CROP_EXPAND), CROP_MIN_SIZE);
+    int height = std::max(cvRound(box.height * CROP_EXPAND), CROP_MIN_SIZE);
+    int x = box.x + box.width / 2 - width / 2;
+    int y = box.y + box.height / 2 - height / 2;
+    cv::Rect rect = cv::Rect(x, y, width, height) & cv::Rect(0, 0, frameWidth, frameHeight);
+    int x0 = rect.x & ~1;
+    int y0 = rect.y & ~1;
+    return cv::Rect(x0, y0, (rect.x + rect.width - x0) & ~1, (rect.y + rect.height - y0) & ~1);
+}
+
+// 相交的区域合并成外接矩形，直到互不相交
+static void merge_crops(std::vector<cv::Rect> &crops) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < crops.size() && !merged; i++) {
+            for (size_t j = i + 1; j < crops.size(); j++) {
+                if ((crops[i] & crops[j]).area() > 0) {
+                    crops[i] |= crops[j];
+                    crops.erase(crops.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+CropScheduler &CropScheduler::getInstance() {
+    static CropScheduler instance;
+    return instance;
+}
+
+CropScheduler::CropScheduler() {
+    for (int i = 0; i < CROP_MAX_CAMERAS; i++) {
+        resetState(cameras_[i], 0);
+    }
+}
+
+void CropScheduler::resetState(CameraState &state, int interval) {
+    state.interval = interval;
+    state.sequence = 0;
+    state.tracker.clear();
+    state.hasBaseline = false;
+    for (int i = 0; i < 4; i++) {
+        state.counts[i] = 0;
+        state.npuUs[i] = 0;
+    }
+    state.fallbacks = 0;
+    state.recallMatched = 0;
+    state.recallTotal = 0;
+}
+
+void CropScheduler::setInterval(int cameraIndex, int interval) {
+    if (!valid_camera(cameraIndex)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    resetState(cameras_[cameraIndex], interval > 1 ? interval : 0);
+    LOGD("Camera %d tracking-guided crop detection: full frame every %d frames%s", cameraIndex, interval,
+         interval > 1 ? "" : " (off)");
+}
+
+int CropScheduler::getInterval(int cameraIndex) {
+    if (!valid_camera(cameraIndex)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cameras_[cameraIndex].interval;
+}
+
+crop_plan_e CropScheduler::plan(int cameraIndex, uint64_t pts, int frameWidth, int frameHeight, int modelWidth,
+                                int modelHeight, std::vector<cv::Rect> &crops) {
+    crops.clear();
+    if (!valid_camera(cameraIndex)) {
+        return CROP_PLAN_OFF;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    CameraState &state = cameras_[cameraIndex];
+    if (state.interval <= 1) {
+        return CROP_PLAN_OFF;
+    }
+    if (state.sequence++ % state.interval == 0) {
+        return CROP_PLAN_FULL;
+    }
+
+    std::vector<Detection> predicted;
+    state.tracker.predict(pts, predicted);
+    for (const Detection &obj: predicted) {
+        cv::Rect crop = expand_box(obj.box, frameWidth, frameHeight);
+        if (crop.width > 0 && crop.height > 0) {
+            crops.push_back(crop);
+        }
+    }
+    if (crops.empty()) {
+        return CROP_PLAN_IDLE;
+    }
+    merge_crops(crops);
+    if ((int) crops.size() > IMG_FANOUT_MAX_REGIONS) {
+        // 拼图最多9格，但一次预处理只能输出IMG_FANOUT_MAX_REGIONS个区域，目标太多时整幅检测
+        crops.clear();
+        state.fallbacks++;
+        return CROP_PLAN_FULL;
+    }
+
+    // 每个区域在格子里的缩放比例不能小于整幅画面缩放到模型输入的比例，否则不如整幅检测
+    std::vector<cv::Rect> cells;
+    bool fits = mosaic_cells((int) crops.size(), modelWidth, modelHeight, cells);
+    float fullScale = std::min((float) modelWidth / frameWidth, (float) modelHeight / frameHeight);
+    for (size_t i = 0; fits && i < crops.size(); i++) {
+        float scale = std::min((float) cells[i].width / crops[i].width, (float) cells[i].height / crops[i].height);
+        fits = scale >= fullScale;
+    }
+    if (!fits) {
+        crops.clear();
+        state.fallbacks++;
+        return CROP_PLAN_FULL;
+    }
+    return CROP_PLAN_CROPS;
+}
+
+void CropScheduler::update(int cameraIndex, crop_plan_e plan, uint64_t pts, const std::vector<Detection> &objects,
+                           int64_t npuUs) {
+    if (!valid_camera(cameraIndex) || plan == CROP_PLAN_OFF) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    CameraState &state = cameras_[cameraIndex];
+    if (state.interval <= 1) {
+        return;
+    }
+    state.counts[plan]++;
+    state.npuUs[plan] += npuUs;
+    if (plan == CROP_PLAN_IDLE) {
+        return;
+    }
+    if (plan == CROP_PLAN_FULL) {
+        // 整幅检测出的目标中，区域检测期间已经在跟踪的比例；新出现的目标要等到整幅检测才能发现，也算漏检
+        if (state.hasBaseline) {
+            state.recallMatched += state.tracker.countMatched(pts, objects);
+            state.recallTotal += objects.size();
+        }
+        state.hasBaseline = true;
+    }
+    state.tracker.update(pts, objects);
+}
+
+crop_stats_t CropScheduler::getStats(int cameraIndex) {
+    crop_stats_t stats = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    if (!valid_camera(cameraIndex)) {
+        return stats;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const CameraState &state = cameras_[cameraIndex];
+    stats.fullFrames = state.counts[CROP_PLAN_FULL];
+    stats.cropFrames = state.counts[CROP_PLAN_CROPS];
+    stats.idleFrames = state.counts[CROP_PLAN_IDLE];
+    stats.fallbackFrames = state.fallbacks;
+    stats.fullNpuMs = stats.fullFrames > 0 ? state.npuUs[CROP_PLAN_FULL] / 1000.0 / stats.fullFrames : 0;
+    uint64_t frames = stats.fullFrames + stats.cropFrames + stats.idleFrames;
+    int64_t npuUs = state.npuUs[CROP_PLAN_FULL] + state.npuUs[CROP_PLAN_CROPS];
+    stats.npuMsPerFrame = frames > 0 ? npuUs / 1000.0 / frames : 0;
+    stats.recall = state.recallTotal > 0 ? (double) state.recallMatched / state.recallTotal : 1.0;
+    stats.recallSamples = state.recallTotal;
+    stats.tracks = (int) state.tracker.size();
+    return stats;
+}
+
+void CropScheduler::logStats(int cameraIndex) {
+    if (getInterval(cameraIndex) <= 1) {
+        return;
+    }
+    crop_stats_t stats = getStats(cameraIndex);
+    LOGD("Camera %d crop detection: full=%llu (fallback %llu) crops=%llu idle=%llu tracks=%d, NPU %.2f ms/frame "
+         "vs %.2f ms full-frame baseline (%.0f%% saved), recall %.1f%% over %llu objects",
+         cameraIndex, (unsigned long long) stats.fullFrames, (unsigned long long) stats.fallbackFrames,
+         (unsigned long long) stats.cropFrames, (unsigned long long) stats.idleFrames, stats.tracks,
+         stats.npuMsPerFrame, stats.fullNpuMs,
+         stats.fullNpuMs > 0 ? (1 - stats.npuMsPerFrame / stats.fullNpuMs) * 100 : 0.0,
+         stats.recall * 100, (unsigned long long) stats.recallSamples);
+}
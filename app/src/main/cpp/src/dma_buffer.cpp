@@ -0,0 +1,201 @@
+#include "dma_buffer.h"
+#include "log4c.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <new>
+
+// 与 linux/dma-heap.h、linux/dma-buf.h 布局一致，避免依赖NDK版本自带的头文件
+struct aibox_dma_heap_allocation_data {
+    uint64_t len;
+    uint32_t fd;
+    uint32_t fd_flags;
+    uint64_t heap_flags;
+};
+
+struct aibox_dma_buf_sync {
+    uint64_t flags;
+};
+
+#define AIBOX_DMA_HEAP_IOCTL_ALLOC _IOWR('H', 0x0, struct aibox_dma_heap_allocation_data)
+#define AIBOX_DMA_BUF_IOCTL_SYNC _IOW('b', 0, struct aibox_dma_buf_sync)
+#define AIBOX_DMA_BUF_SYNC_READ (1 << 0)
+#define AIBOX_DMA_BUF_SYNC_WRITE (2 << 0)
+#define AIBOX_DMA_BUF_SYNC_START (0 << 2)
+#define AIBOX_DMA_BUF_SYNC_END (1 << 2)
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+// 按顺序尝试的DMA heap，RK3588内核一般提供system和cma
+static const char *g_dma_heap_paths[] = {
+        "/dev/dma_heap/system",
+        "/dev/dma_heap/system-dma32",
+        "/dev/dma_heap/cma",
+};
+
+static int g_dma_heap_fd = -1;
+static std::atomic<dma_buffer_hook_t> g_alloc_hook(nullptr);
+static std::atomic<dma_buffer_hook_t> g_free_hook(nullptr);
+
+const char *frame_backend_name(frame_backend_e backend) {
+    switch (backend) {
+        case FRAME_BACKEND_DMA_HEAP:
+            return "dma_heap";
+        case FRAME_BACKEND_MEMFD:
+            return "memfd";
+        case FRAME_BACKEND_MPP:
+            return "mpp";
+        default:
+            return "heap";
+    }
+}
+
+static int open_dma_heap() {
+    if (g_dma_heap_fd >= 0) {
+        return g_dma_heap_fd;
+    }
+    for (size_t i = 0; i < sizeof(g_dma_heap_paths) / sizeof(g_dma_heap_paths[0]); i++) {
+        int fd = open(g_dma_heap_paths[i], O_RDWR | O_CLOEXEC);
+        if (fd >= 0) {
+            LOGD("dma_buffer: using %s", g_dma_heap_paths[i]);
+            g_dma_heap_fd = fd;
+            return fd;
+        }
+    }
+    return -1;
+}
+
+frame_backend_e dma_buffer_detect_backend() {
+    if (open_dma_heap() >= 0) {
+        return FRAME_BACKEND_DMA_HEAP;
+    }
+    LOGW("dma_buffer: no dma_heap device, falling back to memfd");
+    return FRAME_BACKEND_MEMFD;
+}
+
+static int dma_heap_alloc(size_t size) {
+    int heapFd = open_dma_heap();
+    if (heapFd < 0) {
+        return -1;
+    }
+    struct aibox_dma_heap_allocation_data data;
+    memset(&data, 0, sizeof(data));
+    data.len = size;
+    data.fd_flags = O_RDWR | O_CLOEXEC;
+    if (ioctl(heapFd, AIBOX_DMA_HEAP_IOCTL_ALLOC, &data) < 0) {
+        LOGE("dma_buffer: DMA_HEAP_IOCTL_ALLOC %zu bytes failed: %s", size, strerror(errno));
+        return -1;
+    }
+    return (int) data.fd;
+}
+
+static int memfd_alloc(size_t size) {
+    int fd = (int) syscall(__NR_memfd_create, "aibox_frame", MFD_CLOEXEC);
+    if (fd < 0) {
+        LOGE("dma_buffer: memfd_create failed: %s", strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, (off_t) size) < 0) {
+        LOGE("dma_buffer: ftruncate %zu bytes failed: %s", size, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int dma_buffer_alloc(frame_backend_e backend, size_t size, int *fd, void **vaddr) {
+    *fd = -1;
+    *vaddr = nullptr;
+    if (backend == FRAME_BACKEND_HEAP) {
+        *vaddr = new(std::nothrow) char[size];
+        if (!*vaddr) {
+            return -1;
+        }
+        dma_buffer_notify_alloc(-1, *vaddr, size);
+        return 0;
+    }
+
+    int bufFd = backend == FRAME_BACKEND_DMA_HEAP ? dma_heap_alloc(size) : memfd_alloc(size);
+    if (bufFd < 0) {
+        return -1;
+    }
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, bufFd, 0);
+    if (addr == MAP_FAILED) {
+        LOGE("dma_buffer: mmap %zu bytes failed: %s", size, strerror(errno));
+        close(bufFd);
+        return -1;
+    }
+    *fd = bufFd;
+    *vaddr = addr;
+    dma_buffer_notify_alloc(bufFd, addr, size);
+    return 0;
+}
+
+void dma_buffer_free(frame_backend_e backend, int fd, void *vaddr, size_t size) {
+    // 先让导入过这块缓冲的句柄失效，再归还内存，避免fd或地址被重新分配后命中旧句柄
+    dma_buffer_notify_free(fd, vaddr, size);
+    if (backend == FRAME_BACKEND_HEAP) {
+        delete[] (char *) vaddr;
+        return;
+    }
+    if (vaddr) {
+        munmap(vaddr, size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void dma_buffer_set_hooks(dma_buffer_hook_t on_alloc, dma_buffer_hook_t on_free) {
+    g_alloc_hook.store(on_alloc);
+    g_free_hook.store(on_free);
+}
+
+void dma_buffer_notify_alloc(int fd, void *vaddr, size_t size) {
+    dma_buffer_hook_t hook = g_alloc_hook.load();
+    if (hook) {
+        hook(fd, vaddr, size);
+    }
+}
+
+void dma_buffer_notify_free(int fd, void *vaddr, size_t size) {
+    dma_buffer_hook_t hook = g_free_hook.load();
+    if (hook) {
+        hook(fd, vaddr, size);
+    }
+}
+
+static int dma_buffer_sync(int fd, uint64_t flags) {
+    struct aibox_dma_buf_sync sync;
+    sync.flags = flags;
+    int ret = ioctl(fd, AIBOX_DMA_BUF_IOCTL_SYNC, &sync);
+    if (ret < 0) {
+        LOGW("dma_buffer: DMA_BUF_IOCTL_SYNC failed on fd %d: %s", fd, strerror(errno));
+    }
+    return ret;
+}
+
+int dma_buffer_sync_start(frame_backend_e backend, int fd, bool write) {
+    if (!frame_backend_is_dmabuf(backend) || fd < 0) {
+        return 0;
+    }
+    return dma_buffer_sync(fd, AIBOX_DMA_BUF_SYNC_START | AIBOX_DMA_BUF_SYNC_READ |
+                               (write ? AIBOX_DMA_BUF_SYNC_WRITE : 0));
+}
+
+int dma_buffer_sync_end(frame_backend_e backend, int fd, bool write) {
+    if (!frame_backend_is_dmabuf(backend) || fd < 0) {
+        return 0;
+    }
+    return dma_buffer_sync(fd, AIBOX_DMA_BUF_SYNC_END | AIBOX_DMA_BUF_SYNC_READ |
+                               (write ? AIBOX_DMA_BUF_SYNC_WRITE : 0));
+}
@@ -0,0 +1,150 @@
+#include "frame_buffer_pool.h"
+#include "log4c.h"
+
+#include <new>
+
+FrameBufferPool &FrameBufferPool::getInstance() {
+    // 不析构：进程退出时可能还有帧在其它线程中持有缓冲
+    static FrameBufferPool *instance = new FrameBufferPool();
+    return *instance;
+}
+
+FrameBufferPool::FrameBufferPool() : backend_(-1), hits_(0), misses_(0), recycled_(0), dropped_(0),
+                                     cachedBytes_(0), outstanding_(0) {
+    for (int i = 0; i < FRAME_POOL_MAX_BUCKETS; i++) {
+        buckets_[i].size.store(0);
+        buckets_[i].freeList = nullptr;
+    }
+}
+
+// 已有档位无锁查找，新档位在锁内创建，创建后只读
+FrameBufferPool::Bucket *FrameBufferPool::findBucket(size_t size) {
+    for (int i = 0; i < FRAME_POOL_MAX_BUCKETS; i++) {
+        if (buckets_[i].size.load(std::memory_order_acquire) == size) {
+            return &buckets_[i];
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(createMutex_);
+    for (int i = 0; i < FRAME_POOL_MAX_BUCKETS; i++) {
+        size_t bucketSize = buckets_[i].size.load(std::memory_order_acquire);
+        if (bucketSize == size) {
+            return &buckets_[i];
+        }
+        if (bucketSize == 0) {
+            buckets_[i].freeList = new MpmcBoundedQueue<FrameBuffer *>(FRAME_POOL_BUCKET_DEPTH);
+            buckets_[i].size.store(size, std::memory_order_release);
+            LOGD("FrameBufferPool: created bucket %d for %zu bytes", i, size);
+            return &buckets_[i];
+        }
+    }
+    return nullptr;
+}
+
+void FrameBufferPool::setBackend(frame_backend_e backend) {
+    backend_.store(backend);
+    LOGD("FrameBufferPool: backend set to %s", frame_backend_name(backend));
+}
+
+frame_backend_e FrameBufferPool::getBackend() {
+    int backend = backend_.load();
+    if (backend < 0) {
+        std::lock_guard<std::mutex> lock(createMutex_);
+        backend = backend_.load();
+        if (backend < 0) {
+            backend = dma_buffer_detect_backend();
+            backend_.store(backend);
+            LOGD("FrameBufferPool: detected backend %s", frame_backend_name((frame_backend_e) backend));
+        }
+    }
+    return (frame_backend_e) backend;
+}
+
+std::shared_ptr<FrameBuffer> FrameBufferPool::acquire(size_t size) {
+    Bucket *bucket = findBucket(size);
+    frame_backend_e backend = getBackend();
+
+    FrameBuffer *buffer = nullptr;
+    if (bucket && bucket->freeList->dequeue(buffer)) {
+        hits_++;
+        cachedBytes_ -= (int64_t) size;
+    } else {
+        misses_++;
+        // 不清零：解码帧会被完整覆盖
+        int fd = -1;
+        void *vaddr = nullptr;
+        if (dma_buffer_alloc(backend, size, &fd, &vaddr) != 0 && backend != FRAME_BACKEND_HEAP) {
+            LOGW("FrameBufferPool: %s allocation failed, using heap", frame_backend_name(backend));
+            backend = FRAME_BACKEND_HEAP;
+            dma_buffer_alloc(backend, size, &fd, &vaddr);
+        }
+        if (!vaddr) {
+            LOGE("FrameBufferPool: failed to allocate %zu bytes", size);
+            return nullptr;
+        }
+        buffer = new FrameBuffer();
+        buffer->data = (char *) vaddr;
+        buffer->size = size;
+        buffer->fd = fd;
+        buffer->backend = backend;
+    }
+    outstanding_++;
+
+    buffer->width = 0;
+    buffer->height = 0;
+    buffer->widthStride = 0;
+    buffer->heightStride = 0;
+    buffer->format = 0;
+    Recycler recycler;
+    recycler.pool = this;
+    recycler.bucket = bucket;
+    return std::shared_ptr<FrameBuffer>(buffer, recycler);
+}
+
+void FrameBufferPool::Recycler::operator()(FrameBuffer *buffer) const {
+    pool->release(bucket, buffer);
+}
+
+void FrameBufferPool::release(Bucket *bucket, FrameBuffer *buffer) {
+    outstanding_--;
+    bool cached = false;
+    if (bucket && cachedBytes_.load() + (int64_t) buffer->size <= FRAME_POOL_MAX_CACHED_BYTES) {
+        cached = bucket->freeList->enqueue(buffer);
+    }
+    if (cached) {
+        recycled_++;
+        cachedBytes_ += (int64_t) buffer->size;
+    } else {
+        dropped_++;
+        dma_buffer_free(buffer->backend, buffer->fd, buffer->data, buffer->size);
+        delete buffer;
+    }
+}
+
+frame_pool_stats_t FrameBufferPool::getStats() {
+    frame_pool_stats_t stats;
+    stats.hits = hits_.load();
+    stats.misses = misses_.load();
+    stats.recycled = recycled_.load();
+    stats.dropped = dropped_.load();
+    stats.cachedBytes = cachedBytes_.load();
+    stats.outstanding = outstanding_.load();
+    stats.buckets = 0;
+    for (int i = 0; i < FRAME_POOL_MAX_BUCKETS; i++) {
+        if (buckets_[i].size.load() != 0) {
+            stats.buckets++;
+        }
+    }
+    return stats;
+}
+
+void FrameBufferPool::logStats() {
+    frame_pool_stats_t stats = getStats();
+    uint64_t total = stats.hits + stats.misses;
+    LOGD("FrameBufferPool: hits=%llu misses=%llu (hit rate %.1f%%) recycled=%llu dropped=%llu "
+         "cached=%lld KB outstanding=%lld buckets=%d",
+         (unsigned long long) stats.hits, (unsigned long long) stats.misses,
+         total > 0 ? stats.hits * 100.0 / total : 0.0,
+         (unsigned long long) stats.recycled, (unsigned long long) stats.dropped,
+         (long long) (stats.cachedBytes / 1024), (long long) stats.outstanding, stats.buckets);
+}
@@ -0,0 +1,186 @@
+#include "frame_rate_controller.h"
+#include "log4c.h"
+
+// 时间戳跳变超过该值视为流重启或时间戳异常
+#define STREAM_CLOCK_MAX_GAP_MS 5000
+// 时间戳不可用时默认按25fps推进
+#define STREAM_CLOCK_DEFAULT_GAP_MS 40
+
+TokenBucket::TokenBucket() : rate_(0), burst_(1), tokens_(1), lastTimestampMs_(0), hasTimestamp_(false) {}
+
+void TokenBucket::configure(double ratePerSec, double burst) {
+    rate_ = ratePerSec;
+    burst_ = burst < 1 ? 1 : burst;
+    if (tokens_ > burst_) {
+        tokens_ = burst_;
+    }
+}
+
+bool TokenBucket::tryConsume(uint64_t timestampMs) {
+    if (!available(timestampMs)) {
+        return false;
+    }
+    consume();
+    return true;
+}
+
+bool TokenBucket::available(uint64_t timestampMs) {
+    if (rate_ <= 0) {
+        return true;
+    }
+
+    if (!hasTimestamp_) {
+        hasTimestamp_ = true;
+        lastTimestampMs_ = timestampMs;
+        tokens_ = burst_;
+    } else if (timestampMs > lastTimestampMs_) {
+        tokens_ += (timestampMs - lastTimestampMs_) * rate_ / 1000.0;
+        if (tokens_ > burst_) {
+            tokens_ = burst_;
+        }
+        lastTimestampMs_ = timestampMs;
+    }
+
+    return tokens_ >= 1.0;
+}
+
+void TokenBucket::consume() {
+    if (rate_ > 0 && tokens_ >= 1.0) {
+        tokens_ -= 1.0;
+    }
+}
+
+void TokenBucket::reset() {
+    hasTimestamp_ = false;
+    lastTimestampMs_ = 0;
+    tokens_ = burst_;
+}
+
+uint64_t FrameRateController::StreamClock::advance(uint64_t pts) {
+    if (!started) {
+        started = true;
+        lastRawPts = pts;
+        timelineMs = 0;
+        return timelineMs;
+    }
+
+    uint64_t gap = STREAM_CLOCK_DEFAULT_GAP_MS;
+    if (pts != 0 && pts >= lastRawPts && pts - lastRawPts <= STREAM_CLOCK_MAX_GAP_MS) {
+        gap = pts - lastRawPts;
+    }
+    lastRawPts = pts;
+    timelineMs += gap;
+    return timelineMs;
+}
+
+FrameRateController::FrameRateController() : maxPendingInference_(3), inferencePaused_(false),
+                                             framesDecoded_(0), inferenceAdmitted_(0),
+                                             queueFullDropped_(0), displayAdmitted_(0), displayDropped_(0) {
+    // 默认值与原来的“每2帧推理1帧”（25fps源）和30FPS显示保持一致
+    inferenceBucket_.configure(12.5, 1);
+    displayBucket_.configure(30, 1);
+}
+
+void FrameRateController::setInferenceFps(double fps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inferenceBucket_.configure(fps, 1);
+}
+
+void FrameRateController::setDisplayFps(double fps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    displayBucket_.configure(fps, 1);
+}
+
+void FrameRateController::setMaxPendingInference(int maxPending) {
+    maxPendingInference_.store(maxPending > 0 ? maxPending : 1);
+}
+
+void FrameRateController::setInferencePaused(bool paused) {
+    inferencePaused_.store(paused);
+}
+
+double FrameRateController::getInferenceFps() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inferenceBucket_.getRate();
+}
+
+double FrameRateController::getDisplayFps() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return displayBucket_.getRate();
+}
+
+bool FrameRateController::offerInference(uint64_t pts, int pendingTasks) {
+    framesDecoded_++;
+
+    bool available;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t timeline = inferenceClock_.advance(pts);
+        available = !inferencePaused_.load() && inferenceBucket_.available(timeline);
+    }
+
+    // 有令牌但队列满时不送推理，令牌留给队列空出后的帧
+    if (available && pendingTasks >= maxPendingInference_.load()) {
+        queueFullDropped_++;
+        available = false;
+    }
+    return available;
+}
+
+void FrameRateController::commitInference() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inferenceBucket_.consume();
+    }
+    inferenceAdmitted_++;
+}
+
+bool FrameRateController::admitDisplay(uint64_t pts) {
+    bool admitted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t timeline = displayClock_.advance(pts);
+        admitted = displayBucket_.tryConsume(timeline);
+    }
+
+    if (admitted) {
+        displayAdmitted_++;
+    } else {
+        displayDropped_++;
+    }
+    return admitted;
+}
+
+void FrameRateController::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inferenceBucket_.reset();
+    displayBucket_.reset();
+    inferenceClock_ = StreamClock();
+    displayClock_ = StreamClock();
+}
+
+frame_rate_stats_t FrameRateController::getStats() const {
+    frame_rate_stats_t stats;
+    // 先读提交数，解码数只会更大，相减不会溢出
+    stats.inferenceAdmitted = inferenceAdmitted_.load();
+    stats.framesDecoded = framesDecoded_.load();
+    stats.inferenceDropped = stats.framesDecoded - stats.inferenceAdmitted;
+    stats.queueFullDropped = queueFullDropped_.load();
+    stats.displayAdmitted = displayAdmitted_.load();
+    stats.displayDropped = displayDropped_.load();
+    return stats;
+}
+
+void FrameRateController::logStats(int cameraIndex) {
+    frame_rate_stats_t stats = getStats();
+    LOGD("Camera %d frame rate: decoded=%llu inference admitted=%llu dropped=%llu (queue full=%llu) "
+         "display admitted=%llu dropped=%llu, limits: inference=%.1f fps%s display=%.1f fps max pending=%d",
+         cameraIndex,
+         (unsigned long long) stats.framesDecoded,
+         (unsigned long long) stats.inferenceAdmitted,
+         (unsigned long long) stats.inferenceDropped,
+         (unsigned long long) stats.queueFullDropped,
+         (unsigned long long) stats.displayAdmitted,
+         (unsigned long long) stats.displayDropped,
+         getInferenceFps(), isInferencePaused() ? " (paused)" : "", getDisplayFps(), getMaxPendingInference());
+}
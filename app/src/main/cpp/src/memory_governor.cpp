@@ -0,0 +1,223 @@
+#include "memory_governor.h"
+#include "log4c.h"
+
+static const char *pressure_name(mem_pressure_e pressure) {
+    switch (pressure) {
+        case MEM_PRESSURE_SHED:
+            return "shed";
+        case MEM_PRESSURE_CONSTRAINED:
+            return "constrained";
+        case MEM_PRESSURE_OVER:
+            return "over";
+        default:
+            return "normal";
+    }
+}
+
+static bool valid_camera(int cameraIndex) {
+    return cameraIndex >= 0 && cameraIndex < MEM_GOVERNOR_MAX_CAMERAS;
+}
+
+MemoryGovernor &MemoryGovernor::getInstance() {
+    // 不析构：进程退出时其它线程中的帧可能还在撤销记账
+    static MemoryGovernor *instance = new MemoryGovernor();
+    return *instance;
+}
+
+MemoryGovernor::MemoryGovernor() : total_(0), peak_(0),
+                                   ceiling_((int64_t) MEM_GOVERNOR_DEFAULT_CEILING_MB * 1024 * 1024),
+                                   lastPressure_(MEM_PRESSURE_NORMAL) {
+    for (int i = 0; i < MEM_GOVERNOR_MAX_CAMERAS; i++) {
+        for (int j = 0; j < MEM_STAGE_COUNT; j++) {
+            bytes_[i][j].store(0);
+        }
+        shed_[i].store(0);
+        priority_[i].store(i == 0);
+    }
+}
+
+const char *MemoryGovernor::stageName(mem_stage_e stage) {
+    switch (stage) {
+        case MEM_STAGE_DECODE:
+            return "decode";
+        case MEM_STAGE_INFERENCE:
+            return "inference";
+        case MEM_STAGE_REORDER:
+            return "reorder";
+        case MEM_STAGE_DISPLAY:
+            return "display";
+        default:
+            return "unknown";
+    }
+}
+
+void MemoryGovernor::setCeilingBytes(int64_t bytes) {
+    if (bytes <= 0) {
+        bytes = (int64_t) MEM_GOVERNOR_DEFAULT_CEILING_MB * 1024 * 1024;
+    }
+    ceiling_.store(bytes);
+    LOGD("MemoryGovernor: ceiling set to %lld MB", (long long) (bytes / (1024 * 1024)));
+}
+
+int64_t MemoryGovernor::getCeilingBytes() {
+    return ceiling_.load();
+}
+
+void MemoryGovernor::setCameraPriority(int cameraIndex, bool priority) {
+    if (!valid_camera(cameraIndex)) {
+        return;
+    }
+    priority_[cameraIndex].store(priority);
+    LOGD("MemoryGovernor: camera %d priority %s", cameraIndex, priority ? "on" : "off");
+}
+
+bool MemoryGovernor::isPriorityCamera(int cameraIndex) {
+    return valid_camera(cameraIndex) && priority_[cameraIndex].load();
+}
+
+mem_pressure_e MemoryGovernor::pressureFor(int64_t bytes) {
+    double ceiling = (double) ceiling_.load();
+    if (bytes > ceiling) {
+        return MEM_PRESSURE_OVER;
+    }
+    if (bytes > ceiling * MEM_GOVERNOR_CONSTRAIN_RATIO) {
+        return MEM_PRESSURE_CONSTRAINED;
+    }
+    if (bytes > ceiling * MEM_GOVERNOR_SHED_RATIO) {
+        return MEM_PRESSURE_SHED;
+    }
+    return MEM_PRESSURE_NORMAL;
+}
+
+mem_admit_e MemoryGovernor::admitFrame(int cameraIndex, int64_t bytes, int pending) {
+    mem_pressure_e pressure = pressureFor(total_.load() + bytes);
+
+    int last = lastPressure_.exchange(pressure);
+    if (last != pressure) {
+        LOGW("MemoryGovernor: pressure %s -> %s (%lld / %lld MB)", pressure_name((mem_pressure_e) last),
+             pressure_name(pressure), (long long) (total_.load() / (1024 * 1024)),
+             (long long) (ceiling_.load() / (1024 * 1024)));
+    }
+
+    mem_admit_e result = MEM_ADMIT;
+    if (pressure == MEM_PRESSURE_OVER) {
+        result = MEM_SHED_CEILING;
+    } else if (pressure >= MEM_PRESSURE_SHED && !isPriorityCamera(cameraIndex)) {
+        result = MEM_SHED_LOW_PRIORITY;
+    } else if (pressure == MEM_PRESSURE_CONSTRAINED && pending >= MEM_GOVERNOR_REDUCED_DEPTH) {
+        result = MEM_SHED_QUEUE_DEPTH;
+    }
+    if (result != MEM_ADMIT && valid_camera(cameraIndex)) {
+        shed_[cameraIndex]++;
+    }
+    return result;
+}
+
+void MemoryGovernor::charge(int cameraIndex, mem_stage_e stage, int64_t bytes) {
+    if (!valid_camera(cameraIndex) || stage < 0 || stage >= MEM_STAGE_COUNT || bytes <= 0) {
+        return;
+    }
+    bytes_[cameraIndex][stage] += bytes;
+    int64_t total = (total_ += bytes);
+    int64_t peak = peak_.load();
+    while (total > peak && !peak_.compare_exchange_weak(peak, total)) {
+    }
+}
+
+void MemoryGovernor::uncharge(int cameraIndex, mem_stage_e stage, int64_t bytes) {
+    if (!valid_camera(cameraIndex) || stage < 0 || stage >= MEM_STAGE_COUNT || bytes <= 0) {
+        return;
+    }
+    bytes_[cameraIndex][stage] -= bytes;
+    total_ -= bytes;
+}
+
+int64_t MemoryGovernor::getBytes(int cameraIndex, mem_stage_e stage) {
+    if (!valid_camera(cameraIndex) || stage < 0 || stage >= MEM_STAGE_COUNT) {
+        return 0;
+    }
+    return bytes_[cameraIndex][stage].load();
+}
+
+int64_t MemoryGovernor::getCameraBytes(int cameraIndex) {
+    int64_t bytes = 0;
+    for (int stage = 0; stage < MEM_STAGE_COUNT; stage++) {
+        bytes += getBytes(cameraIndex, (mem_stage_e) stage);
+    }
+    return bytes;
+}
+
+int64_t MemoryGovernor::getStageBytes(mem_stage_e stage) {
+    int64_t bytes = 0;
+    for (int i = 0; i < MEM_GOVERNOR_MAX_CAMERAS; i++) {
+        bytes += getBytes(i, stage);
+    }
+    return bytes;
+}
+
+int64_t MemoryGovernor::getTotalBytes() {
+    return total_.load();
+}
+
+int64_t MemoryGovernor::getPeakBytes() {
+    return peak_.load();
+}
+
+uint64_t MemoryGovernor::getShedCount(int cameraIndex) {
+    return valid_camera(cameraIndex) ? shed_[cameraIndex].load() : 0;
+}
+
+mem_pressure_e MemoryGovernor::getPressure() {
+    return pressureFor(total_.load());
+}
+
+void MemoryGovernor::logStatus() {
+    LOGD("MemoryGovernor: total=%lld KB peak=%lld KB ceiling=%lld MB pressure=%s "
+         "(decode=%lld KB inference=%lld KB reorder=%lld KB display=%lld KB)",
+         (long long) (getTotalBytes() / 1024), (long long) (getPeakBytes() / 1024),
+         (long long) (getCeilingBytes() / (1024 * 1024)), pressure_name(getPressure()),
+         (long long) (getStageBytes(MEM_STAGE_DECODE) / 1024),
+         (long long) (getStageBytes(MEM_STAGE_INFERENCE) / 1024),
+         (long long) (getStageBytes(MEM_STAGE_REORDER) / 1024),
+         (long long) (getStageBytes(MEM_STAGE_DISPLAY) / 1024));
+    for (int i = 0; i < MEM_GOVERNOR_MAX_CAMERAS; i++) {
+        int64_t bytes = getCameraBytes(i);
+        uint64_t shed = getShedCount(i);
+        if (bytes == 0 && shed == 0) {
+            continue;
+        }
+        LOGD("MemoryGovernor: camera %d%s %lld KB (decode=%lld inference=%lld reorder=%lld display=%lld KB) "
+             "shed=%llu", i, isPriorityCamera(i) ? " (priority)" : "", (long long) (bytes / 1024),
+             (long long) (getBytes(i, MEM_STAGE_DECODE) / 1024),
+             (long long) (getBytes(i, MEM_STAGE_INFERENCE) / 1024),
+             (long long) (getBytes(i, MEM_STAGE_REORDER) / 1024),
+             (long long) (getBytes(i, MEM_STAGE_DISPLAY) / 1024), (unsigned long long) shed);
+    }
+}
+
+void MemoryCharge::assign(int cameraIndex, mem_stage_e stage, int64_t bytes) {
+    release();
+    camera_ = cameraIndex;
+    stage_ = stage;
+    bytes_ = bytes;
+    MemoryGovernor::getInstance().charge(camera_, stage_, bytes_);
+}
+
+void MemoryCharge::moveTo(mem_stage_e stage) {
+    if (bytes_ <= 0 || stage == stage_) {
+        return;
+    }
+    MemoryGovernor &governor = MemoryGovernor::getInstance();
+    governor.uncharge(camera_, stage_, bytes_);
+    governor.charge(camera_, stage, bytes_);
+    stage_ = stage;
+}
+
+void MemoryCharge::release() {
+    if (bytes_ <= 0) {
+        return;
+    }
+    MemoryGovernor::getInstance().uncharge(camera_, stage_, bytes_);
+    bytes_ = 0;
+    camera_ = -1;
+}
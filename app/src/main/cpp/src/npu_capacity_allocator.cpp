@@ -0,0 +1,263 @@
+#include "npu_capacity_allocator.h"
+#include "frame_rate_controller.h"
+#include "log4c.h"
+
+#include <vector>
+#include <algorithm>
+
+// 耗时滑动平均的平滑系数
+#define NPU_CAPACITY_EWMA_ALPHA 0.05
+// 吞吐统计窗口
+#define NPU_CAPACITY_WINDOW_MS 5000
+// 容量变化超过该比例才重新分配
+#define NPU_CAPACITY_REBALANCE_RATIO 0.1
+
+static const char *admission_name(npu_admission_e admission) {
+    switch (admission) {
+        case NPU_ADMISSION_ADMITTED:
+            return "admitted";
+        case NPU_ADMISSION_DEGRADED:
+            return "degraded";
+        case NPU_ADMISSION_REJECTED:
+            return "rejected";
+        default:
+            return "none";
+    }
+}
+
+NpuCapacityAllocator &NpuCapacityAllocator::getInstance() {
+    static NpuCapacityAllocator instance;
+    return instance;
+}
+
+NpuCapacityAllocator::NpuCapacityAllocator() : nextOrder_(0), inflight_(0),
+                                               costUs_(NPU_CAPACITY_DEFAULT_COST_US), hasCost_(false),
+                                               samples_(0), windowSamples_(0), observedFps_(0) {
+    windowStart_ = std::chrono::steady_clock::now();
+}
+
+// 默认策略：主摄像头权重更高，最低检测帧率5fps，最高12.5fps（25fps源隔帧检测）
+npu_camera_policy_t NpuCapacityAllocator::defaultPolicy(int cameraIndex) {
+    npu_camera_policy_t policy;
+    policy.weight = cameraIndex == 0 ? 2.0f : 1.0f;
+    policy.minFps = 5.0f;
+    policy.maxFps = 12.5f;
+    policy.allowDegrade = true;
+    return policy;
+}
+
+npu_admission_e NpuCapacityAllocator::registerCamera(int cameraIndex, FrameRateController *controller) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(cameraIndex);
+    if (it != cameras_.end()) {
+        it->second.controller = controller;
+    } else {
+        CameraSlot slot;
+        slot.controller = controller;
+        slot.policy = defaultPolicy(cameraIndex);
+        slot.admission = NPU_ADMISSION_NONE;
+        slot.allocatedFps = 0;
+        slot.order = nextOrder_++;
+        cameras_[cameraIndex] = slot;
+    }
+    rebalanceLocked();
+    return cameras_[cameraIndex].admission;
+}
+
+void NpuCapacityAllocator::unregisterCamera(int cameraIndex, FrameRateController *controller) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(cameraIndex);
+    // 只有注册时的限速器才能注销，避免新实例被旧实例的析构注销掉
+    if (it == cameras_.end() || it->second.controller != controller) {
+        return;
+    }
+    cameras_.erase(it);
+    rebalanceLocked();
+}
+
+npu_admission_e NpuCapacityAllocator::setCameraPolicy(int cameraIndex, const npu_camera_policy_t &policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(cameraIndex);
+    if (it == cameras_.end()) {
+        // 摄像头还没启动时也允许先配置策略
+        CameraSlot slot;
+        slot.controller = nullptr;
+        slot.admission = NPU_ADMISSION_NONE;
+        slot.allocatedFps = 0;
+        slot.order = nextOrder_++;
+        it = cameras_.insert(std::make_pair(cameraIndex, slot)).first;
+    }
+    it->second.policy = policy;
+    if (it->second.policy.weight <= 0) {
+        it->second.policy.weight = 0.1f;
+    }
+    if (it->second.policy.minFps < 0) {
+        it->second.policy.minFps = 0;
+    }
+    if (it->second.policy.maxFps < it->second.policy.minFps) {
+        it->second.policy.maxFps = it->second.policy.minFps;
+    }
+    rebalanceLocked();
+    return it->second.admission;
+}
+
+bool NpuCapacityAllocator::getCameraPolicy(int cameraIndex, npu_camera_policy_t &policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(cameraIndex);
+    if (it == cameras_.end()) {
+        policy = defaultPolicy(cameraIndex);
+        return false;
+    }
+    policy = it->second.policy;
+    return true;
+}
+
+void NpuCapacityAllocator::beginInference() {
+    inflight_++;
+}
+
+void NpuCapacityAllocator::endInference(int64_t costUs) {
+    // 同一核心上多个上下文排队执行，墙钟耗时按每核平均并发数折算
+    int inflight = inflight_--;
+    double concurrency = (double) inflight / NPU_CAPACITY_CORES;
+    double sample = (double) costUs / (concurrency > 1.0 ? concurrency : 1.0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!hasCost_) {
+        costUs_ = sample;
+        hasCost_ = true;
+    } else {
+        costUs_ += NPU_CAPACITY_EWMA_ALPHA * (sample - costUs_);
+    }
+    samples_++;
+    windowSamples_++;
+
+    auto now = std::chrono::steady_clock::now();
+    long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - windowStart_).count();
+    if (elapsedMs >= NPU_CAPACITY_WINDOW_MS) {
+        observedFps_ = windowSamples_ * 1000.0 / elapsedMs;
+        windowSamples_ = 0;
+        windowStart_ = now;
+    }
+
+    if (samples_ % NPU_CAPACITY_REBALANCE_SAMPLES == 0) {
+        rebalanceLocked();
+    }
+}
+
+// 容量 = 核心数 / 单次推理耗时 × 目标利用率；实际吞吐更高时以实际为准
+float NpuCapacityAllocator::capacityLocked() {
+    double capacity = NPU_CAPACITY_CORES * 1000000.0 / (costUs_ > 1 ? costUs_ : 1) * NPU_CAPACITY_TARGET_UTIL;
+    if (observedFps_ > capacity) {
+        capacity = observedFps_;
+    }
+    return (float) capacity;
+}
+
+void NpuCapacityAllocator::rebalanceLocked() {
+    float budget = capacityLocked();
+
+    std::vector<std::pair<uint64_t, int>> order;
+    for (auto &it: cameras_) {
+        order.push_back(std::make_pair(it.second.order, it.first));
+    }
+    std::sort(order.begin(), order.end());
+
+    // 第一轮：按注册顺序保证最低帧率，预算不够的摄像头降级或拒绝
+    for (size_t i = 0; i < order.size(); i++) {
+        CameraSlot &slot = cameras_[order[i].second];
+        float need = std::min(slot.policy.minFps, slot.policy.maxFps);
+        if (budget >= need) {
+            slot.admission = NPU_ADMISSION_ADMITTED;
+            slot.allocatedFps = need;
+        } else if (slot.policy.allowDegrade) {
+            slot.admission = NPU_ADMISSION_DEGRADED;
+            slot.allocatedFps = std::min(std::max(budget, (float) NPU_CAPACITY_DEGRADED_FPS), slot.policy.maxFps);
+        } else {
+            slot.admission = NPU_ADMISSION_REJECTED;
+            slot.allocatedFps = 0;
+        }
+        budget = std::max(0.0f, budget - slot.allocatedFps);
+    }
+
+    // 第二轮：剩余算力按权重分给已准入的摄像头，不超过各自的最高帧率
+    while (budget > 0.01f) {
+        float totalWeight = 0;
+        for (auto &it: cameras_) {
+            if (it.second.admission == NPU_ADMISSION_ADMITTED && it.second.allocatedFps < it.second.policy.maxFps) {
+                totalWeight += it.second.policy.weight;
+            }
+        }
+        if (totalWeight <= 0) {
+            break;
+        }
+        float distributed = 0;
+        for (auto &it: cameras_) {
+            CameraSlot &slot = it.second;
+            if (slot.admission != NPU_ADMISSION_ADMITTED || slot.allocatedFps >= slot.policy.maxFps) {
+                continue;
+            }
+            float add = std::min(budget * slot.policy.weight / totalWeight, slot.policy.maxFps - slot.allocatedFps);
+            slot.allocatedFps += add;
+            distributed += add;
+        }
+        budget -= distributed;
+        if (distributed < 0.01f) {
+            break;
+        }
+    }
+
+    for (auto &it: cameras_) {
+        CameraSlot &slot = it.second;
+        if (!slot.controller) {
+            continue;
+        }
+        slot.controller->setInferencePaused(slot.admission == NPU_ADMISSION_REJECTED);
+        if (slot.allocatedFps > 0) {
+            slot.controller->setInferenceFps(slot.allocatedFps);
+        }
+    }
+}
+
+void NpuCapacityAllocator::rebalance() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rebalanceLocked();
+}
+
+float NpuCapacityAllocator::getCapacityFps() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacityLocked();
+}
+
+float NpuCapacityAllocator::getInferenceCostMs() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (float) (costUs_ / 1000.0);
+}
+
+float NpuCapacityAllocator::getObservedFps() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (float) observedFps_;
+}
+
+float NpuCapacityAllocator::getAllocatedFps(int cameraIndex) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(cameraIndex);
+    return it == cameras_.end() ? -1.0f : it->second.allocatedFps;
+}
+
+npu_admission_e NpuCapacityAllocator::getAdmission(int cameraIndex) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cameras_.find(cameraIndex);
+    return it == cameras_.end() ? NPU_ADMISSION_NONE : it->second.admission;
+}
+
+void NpuCapacityAllocator::logStatus() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LOGD("NpuCapacity: cost=%.2f ms (%s), capacity=%.1f fps, observed=%.1f fps, cameras=%zu",
+         costUs_ / 1000.0, hasCost_ ? "measured" : "default", capacityLocked(), observedFps_, cameras_.size());
+    for (auto &it: cameras_) {
+        LOGD("NpuCapacity: camera %d %s allocated=%.1f fps (weight=%.1f min=%.1f max=%.1f)",
+             it.first, admission_name(it.second.admission), it.second.allocatedFps,
+             it.second.policy.weight, it.second.policy.minFps, it.second.policy.maxFps);
+    }
+}
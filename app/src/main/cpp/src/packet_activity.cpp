@@ -0,0 +1,146 @@
+#include "packet_activity.h"
+
+#include <algorithm>
+#include <sys/time.h>
+#include "log4c.h"
+
+#define ACTIVITY_BASELINE_FALL (1.0f / 16)     // P帧小于基线时的跟随速度
+#define ACTIVITY_BASELINE_RISE (1.0f / 256)    // 大于基线时的上升速度，25fps下约10秒
+#define ACTIVITY_SCORE_DECAY 0.8f              // 分数峰值保持后按帧衰减，单个小P帧不会打断一段活动
+
+static int64_t activity_now_ms() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+PacketActivityEstimator::PacketActivityEstimator()
+        : mode_(ACTIVITY_GATE_SHADOW), threshold_(ACTIVITY_DEFAULT_THRESHOLD), skipDecode_(false),
+          resetPending_(false), gopPos_(0), smoothed_(0), keyBytes_(0), sinceReset_(0), lastInferMs_(0), score_(0),
+          tailBaseline_(0), keyFrameBytes_(0), lastActiveMs_(0), packets_(0), keyFrames_(0), decodeSkipped_(0),
+          admitted_(0), gated_(0), keepAlive_(0) {
+    for (int i = 0; i < ACTIVITY_GOP_SLOTS; i++) {
+        baseline_[i] = 0;
+    }
+    for (int i = 0; i < 2; i++) {
+        agreement_[i][0] = 0;
+        agreement_[i][1] = 0;
+    }
+}
+
+void PacketActivityEstimator::configure(activity_gate_e mode, float threshold, bool skipDecode) {
+    mode_.store(mode);
+    threshold_.store(threshold);
+    skipDecode_.store(skipDecode);
+}
+
+void PacketActivityEstimator::reset() {
+    resetPending_.store(true);
+}
+
+bool PacketActivityEstimator::onPacket(size_t size, bool keyFrame, bool droppable, bool lowPriority) {
+    if (mode_.load() == ACTIVITY_GATE_OFF) {
+        return true;
+    }
+    int64_t nowMs = activity_now_ms();
+    if (resetPending_.exchange(false)) {
+        gopPos_ = 0;
+        smoothed_ = 0;
+        sinceReset_ = 0;
+        for (int i = 0; i < ACTIVITY_GOP_SLOTS; i++) {
+            baseline_[i] = 0;
+        }
+        score_.store(0);
+    }
+
+    if (keyFrame) {
+        // I帧大小反映画面复杂度而不是变化，只记录，不参与活动判断
+        gopPos_ = 0;
+        keyBytes_ = keyBytes_ > 0 ? keyBytes_ + (size - keyBytes_) / 8 : (float) size;
+        keyFrameBytes_.store(keyBytes_);
+        keyFrames_++;
+        return true;
+    }
+
+    gopPos_++;
+    float &baseline = baseline_[std::min(gopPos_, ACTIVITY_GOP_SLOTS) - 1];
+    if (baseline <= 0) {
+        baseline = (float) size;
+    }
+    float score = std::max(0.f, ((float) size - baseline) / std::max(baseline, (float) ACTIVITY_MIN_BASELINE_BYTES));
+    baseline += ((float) size - baseline) * (size < baseline ? ACTIVITY_BASELINE_FALL : ACTIVITY_BASELINE_RISE);
+    smoothed_ = std::max(score, smoothed_ * ACTIVITY_SCORE_DECAY);
+    score_.store(smoothed_);
+    tailBaseline_.store(baseline_[ACTIVITY_GOP_SLOTS - 1]);
+    packets_++;
+
+    float threshold = threshold_.load();
+    if (sinceReset_ < ACTIVITY_WARMUP_FRAMES || threshold <= 0 || smoothed_ >= threshold) {
+        lastActiveMs_.store(nowMs);
+    }
+    sinceReset_++;
+
+    // 非参考帧不被其他帧引用，不解码只少一帧显示，解码器和后续帧不受影响
+    if (droppable && lowPriority && skipDecode_.load() && !isActive()) {
+        decodeSkipped_++;
+        return false;
+    }
+    return true;
+}
+
+bool PacketActivityEstimator::isActive() const {
+    return activity_now_ms() - lastActiveMs_.load() <= ACTIVITY_HOLD_MS;
+}
+
+bool PacketActivityEstimator::admitInference() {
+    int64_t nowMs = activity_now_ms();
+    bool infer = isActive();
+    if (!infer && nowMs - lastInferMs_ >= ACTIVITY_KEEPALIVE_MS) {
+        infer = true;
+        keepAlive_++;
+    }
+    if (infer) {
+        lastInferMs_ = nowMs;
+        admitted_++;
+    } else {
+        gated_++;
+    }
+    return infer;
+}
+
+void PacketActivityEstimator::recordAgreement(bool pixelMoving) {
+    agreement_[isActive() ? 1 : 0][pixelMoving ? 1 : 0]++;
+}
+
+activity_stats_t PacketActivityEstimator::getStats() const {
+    activity_stats_t stats;
+    stats.packets = packets_.load();
+    stats.keyFrames = keyFrames_.load();
+    stats.decodeSkipped = decodeSkipped_.load();
+    stats.admitted = admitted_.load();
+    stats.gated = gated_.load();
+    stats.keepAlive = keepAlive_.load();
+    stats.bothActive = agreement_[1][1].load();
+    stats.bothIdle = agreement_[0][0].load();
+    stats.packetOnly = agreement_[1][0].load();
+    stats.pixelOnly = agreement_[0][1].load();
+    stats.score = score_.load();
+    stats.baselineBytes = tailBaseline_.load();
+    stats.keyFrameBytes = keyFrameBytes_.load();
+    return stats;
+}
+
+void PacketActivityEstimator::logStats(int cameraIndex) {
+    activity_stats_t stats = getStats();
+    uint64_t compared = stats.bothActive + stats.bothIdle + stats.packetOnly + stats.pixelOnly;
+    LOGD("Camera %d packet activity (mode %d): score=%.2f baseline=%.0f B key=%.0f B P-frames=%llu key frames=%llu "
+         "not decoded=%llu admitted=%llu gated=%llu keep-alive=%llu, vs pixel gate: agree=%.1f%% "
+         "packet-only=%llu pixel-only=%llu of %llu",
+         cameraIndex, getMode(), stats.score, stats.baselineBytes, stats.keyFrameBytes,
+         (unsigned long long) stats.packets, (unsigned long long) stats.keyFrames,
+         (unsigned long long) stats.decodeSkipped, (unsigned long long) stats.admitted,
+         (unsigned long long) stats.gated, (unsigned long long) stats.keepAlive,
+         compared > 0 ? (stats.bothActive + stats.bothIdle) * 100.0 / compared : 0.0,
+         (unsigned long long) stats.packetOnly, (unsigned long long) stats.pixelOnly,
+         (unsigned long long) compared);
+}
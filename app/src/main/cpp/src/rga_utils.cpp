@@ -1,94 +1,323 @@
 #include "rga_utils.h"
+#include "dma_buffer.h"
 
-int rga_change_color_async(int src_width, int src_height, int src_format, char *src_buf,
-                           int dst_width, int dst_height, int dst_format, char *dst_buf) {
-    int ret = 0;
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <sys/time.h>
 
-    // LOGD("src_width: %d, src_height: %d,  dst_width: %d, dst_height: %d, ",
-    // src_width, src_height, dst_width, dst_height);
+namespace {
 
-    int src_buf_size, dst_buf_size;
-    im_rect src_rect;
-    im_rect dst_rect;
+int64_t rga_now_us() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
 
-    rga_buffer_t src_img, dst_img;
-    rga_buffer_handle_t src_handle, dst_handle;
+// RGA导入句柄缓存：帧缓冲池和MPP缓冲组里的缓冲会反复送进RGA，每帧importbuffer/releasebuffer_handle都要进内核
+// 建立和拆除映射。缓存只对登记过的缓冲生效（dma_buffer分配通知登记，释放通知失效），生命周期未知的裸指针仍然每次导入
+class RgaHandleCache {
+public:
+    // 进程退出时帧缓冲池析构仍会发出释放通知，实例不析构
+    static RgaHandleCache &getInstance() {
+        static RgaHandleCache *instance = new RgaHandleCache();
+        return *instance;
+    }
 
-    memset(&dst_rect, 0, sizeof(dst_rect));
-    memset(&src_rect, 0, sizeof(src_rect));
-    memset(&src_img, 0, sizeof(src_img));
-    memset(&dst_img, 0, sizeof(dst_img));
+    // 取图像的句柄，cached返回是否来自缓存；失败返回0
+    rga_buffer_handle_t acquire(const rga_image_t &image, size_t size, bool *cached) {
+        *cached = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (isTracked(image, size)) {
+                Key key = keyOf(image, size);
+                std::map<Key, Entry>::iterator it = entries_.find(key);
+                if (it != entries_.end()) {
+                    it->second.users++;
+                    hits_++;
+                    *cached = true;
+                    return it->second.handle;
+                }
+                // 登记过的缓冲第一次导入，在锁内完成，避免两个线程各导入一次
+                rga_buffer_handle_t handle = import(image, size);
+                if (handle == 0) {
+                    return 0;
+                }
+                Entry entry = {handle, 1};
+                entries_[key] = entry;
+                *cached = true;
+                return handle;
+            }
+        }
+        return import(image, size);
+    }
 
-    src_buf_size = src_width * src_height * get_bpp_from_format(src_format);
-    dst_buf_size = dst_width * dst_height * get_bpp_from_format(dst_format);
+    void release(const rga_image_t &image, size_t size, rga_buffer_handle_t handle, bool cached) {
+        if (!cached) {
+            releaseHandle(handle);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<Key, Entry>::iterator it = entries_.find(keyOf(image, size));
+        if (it != entries_.end() && it->second.handle == handle) {
+            it->second.users--;
+            return;
+        }
+        // 使用期间缓冲已经释放，最后一个使用者负责释放句柄
+        std::map<rga_buffer_handle_t, int>::iterator retired = retired_.find(handle);
+        if (retired != retired_.end() && --retired->second == 0) {
+            retired_.erase(retired);
+            releaseHandle(handle);
+        }
+    }
 
-    // src_buf = (char *) malloc(src_buf_size);
-    // dst_buf = (char *) malloc(dst_buf_size);
+    void track(int fd, void *vaddr, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd >= 0) {
+            fds_[fd] = size;
+        }
+        if (vaddr) {
+            addrs_[(uintptr_t) vaddr] = size;
+        }
+    }
 
-    /* fill image data */
-    // memset(src_buf, 0xaa, src_buf_size);
-    // memset(dst_buf, 0x80, dst_buf_size);
+    // 缓冲归还分配器：按fd或起始地址导入的句柄全部失效
+    void untrack(int fd, void *vaddr, size_t size) {
+        (void) size;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd >= 0) {
+            fds_.erase(fd);
+        }
+        if (vaddr) {
+            addrs_.erase((uintptr_t) vaddr);
+        }
+        std::map<Key, Entry>::iterator it = entries_.begin();
+        while (it != entries_.end()) {
+            const Key &key = it->first;
+            bool match = key.fd >= 0 ? key.fd == fd : (vaddr && key.addr == (uintptr_t) vaddr);
+            if (!match) {
+                ++it;
+                continue;
+            }
+            if (it->second.users > 0) {
+                retired_[it->second.handle] = it->second.users;
+            } else {
+                releaseHandle(it->second.handle);
+            }
+            entries_.erase(it++);
+        }
+    }
 
-    src_handle = importbuffer_virtualaddr(src_buf, src_buf_size);
-    dst_handle = importbuffer_virtualaddr(dst_buf, dst_buf_size);
-    if (src_handle == 0 || dst_handle == 0) {
-        LOGD("importbuffer failed!\n");
-        goto release_buffer;
+    rga_handle_stats_t stats() {
+        rga_handle_stats_t stats;
+        stats.imports = imports_.load();
+        stats.releases = releases_.load();
+        stats.hits = hits_.load();
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.cached = (int) entries_.size();
+        stats.tracked = (int) (fds_.size() + addrs_.size());
+        return stats;
     }
 
-    src_img.handle = src_handle;
-    src_img.width = src_width;
-    src_img.height = src_height;
-    src_img.format = src_format;
-    src_img.wstride = src_width;
-    src_img.hstride = src_height;
+    void logStats() {
+        rga_handle_stats_t now = stats();
+        rga_handle_stats_t last;
+        double seconds;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            last = last_;
+            last_ = now;
+            int64_t nowUs = rga_now_us();
+            seconds = lastLogUs_ > 0 ? (nowUs - lastLogUs_) / 1000000.0 : 0.0;
+            lastLogUs_ = nowUs;
+        }
+        if (seconds <= 0) {
+            return;
+        }
+        uint64_t imports = now.imports - last.imports;
+        uint64_t hits = now.hits - last.hits;
+        LOGD("RGA handles: import %.1f/s release %.1f/s reused %.1f/s (%.1f%% of acquires), cached=%d tracked=%d",
+             imports / seconds, (now.releases - last.releases) / seconds, hits / seconds,
+             imports + hits > 0 ? hits * 100.0 / (imports + hits) : 0.0, now.cached, now.tracked);
+    }
+
+private:
+    struct Key {
+        int fd;
+        uintptr_t addr;  // 按fd导入时为0
+        size_t size;
+
+        bool operator<(const Key &other) const {
+            if (fd != other.fd) {
+                return fd < other.fd;
+            }
+            if (addr != other.addr) {
+                return addr < other.addr;
+            }
+            return size < other.size;
+        }
+    };
+
+    struct Entry {
+        rga_buffer_handle_t handle;
+        int users;
+    };
+
+    RgaHandleCache() : imports_(0), releases_(0), hits_(0), lastLogUs_(0) {
+        memset(&last_, 0, sizeof(last_));
+    }
+
+    static Key keyOf(const rga_image_t &image, size_t size) {
+        Key key = {image.fd, image.fd >= 0 ? 0 : (uintptr_t) image.buf, size};
+        return key;
+    }
+
+    // 只缓存从分配起点开始、不超出分配大小的导入
+    bool isTracked(const rga_image_t &image, size_t size) const {
+        if (image.fd >= 0) {
+            std::map<int, size_t>::const_iterator it = fds_.find(image.fd);
+            return it != fds_.end() && size <= it->second;
+        }
+        std::map<uintptr_t, size_t>::const_iterator it = addrs_.find((uintptr_t) image.buf);
+        return it != addrs_.end() && size <= it->second;
+    }
+
+    rga_buffer_handle_t import(const rga_image_t &image, size_t size) {
+        rga_buffer_handle_t handle;
+        if (image.fd >= 0) {
+            handle = importbuffer_fd(image.fd, (int) size);
+        } else {
+            handle = importbuffer_virtualaddr(image.buf, (int) size);
+        }
+        if (handle != 0) {
+            imports_++;
+        }
+        return handle;
+    }
+
+    void releaseHandle(rga_buffer_handle_t handle) {
+        releasebuffer_handle(handle);
+        releases_++;
+    }
+
+    std::mutex mutex_;
+    std::map<int, size_t> fds_;
+    std::map<uintptr_t, size_t> addrs_;
+    std::map<Key, Entry> entries_;
+    std::map<rga_buffer_handle_t, int> retired_;  // 缓冲已释放但仍在使用的句柄和使用者数
+    std::atomic<uint64_t> imports_;
+    std::atomic<uint64_t> releases_;
+    std::atomic<uint64_t> hits_;
+    rga_handle_stats_t last_;
+    int64_t lastLogUs_;
+};
+
+void rga_on_buffer_alloc(int fd, void *vaddr, size_t size) {
+    RgaHandleCache::getInstance().track(fd, vaddr, size);
+}
 
-    dst_img.handle = dst_handle;
-    dst_img.width = dst_width;
-    dst_img.height = dst_height;
-    dst_img.format = dst_format;
-    dst_img.wstride = dst_width;
-    dst_img.hstride = dst_height;
+void rga_on_buffer_free(int fd, void *vaddr, size_t size) {
+    RgaHandleCache::getInstance().untrack(fd, vaddr, size);
+}
 
-    src_img = wrapbuffer_handle(src_handle, src_width, src_height, src_format);
-    dst_img = wrapbuffer_handle(dst_handle, dst_width, dst_height, dst_format);
+// 静态初始化时挂上分配通知，帧缓冲池的第一次分配之前缓存就能登记
+struct RgaHandleCacheInstaller {
+    RgaHandleCacheInstaller() {
+        dma_buffer_set_hooks(rga_on_buffer_alloc, rga_on_buffer_free);
+    }
+} g_rga_handle_cache_installer;
+
+size_t rga_image_buffer_bytes(const rga_image_t &image) {
+    return (size_t) (image.wstride * image.hstride * get_bpp_from_format(image.format));
+}
+
+// 一次RGA操作期间持有图像的导入句柄，析构时归还缓存或释放
+class RgaImport {
+public:
+    explicit RgaImport(const rga_image_t &image)
+            : image_(image), size_(rga_image_buffer_bytes(image)), cached_(false) {
+        handle_ = RgaHandleCache::getInstance().acquire(image_, size_, &cached_);
+    }
+
+    ~RgaImport() {
+        if (handle_ != 0) {
+            RgaHandleCache::getInstance().release(image_, size_, handle_, cached_);
+        }
+    }
+
+    bool valid() const {
+        return handle_ != 0;
+    }
+
+    rga_buffer_t buffer() const {
+        return wrapbuffer_handle(handle_, image_.width, image_.height, image_.format, image_.wstride,
+                                 image_.hstride);
+    }
+
+private:
+    RgaImport(const RgaImport &);
+    RgaImport &operator=(const RgaImport &);
+
+    rga_image_t image_;
+    size_t size_;
+    bool cached_;
+    rga_buffer_handle_t handle_;
+};
+
+} // namespace
+
+rga_handle_stats_t rga_handle_cache_stats() {
+    return RgaHandleCache::getInstance().stats();
+}
+
+void rga_handle_cache_log_stats() {
+    RgaHandleCache::getInstance().logStats();
+}
+
+int rga_change_color_async(int src_width, int src_height, int src_format, char *src_buf,
+                           int dst_width, int dst_height, int dst_format, char *dst_buf) {
+    int ret = 0;
+
+    // LOGD("src_width: %d, src_height: %d,  dst_width: %d, dst_height: %d, ",
+    // src_width, src_height, dst_width, dst_height);
+
+    im_rect dst_rect;
+    memset(&dst_rect, 0, sizeof(dst_rect));
+
+    RgaImport src(rga_image(-1, src_buf, src_width, src_height, src_format));
+    RgaImport dst(rga_image(-1, dst_buf, dst_width, dst_height, dst_format));
+    if (!src.valid() || !dst.valid()) {
+        LOGD("importbuffer failed!\n");
+        return ret;
+    }
+    rga_buffer_t src_img = src.buffer();
+    rga_buffer_t dst_img = dst.buffer();
 
     // 获取任务
     im_job_handle_t job_handle;
     job_handle = imbeginJob();
     if (job_handle <= 0) {
         LOGD("job begin failed![%d], %s\n", job_handle, imStrError());
-        goto release_buffer;
+        return ret;
     }
     ret = imcheck(src_img, dst_img, {}, dst_rect);
     if (IM_STATUS_NOERROR != ret) {
         LOGD("%d %d, check error! %s \n", ret, __LINE__, imStrError((IM_STATUS) ret));
         imcancelJob(job_handle);
-        goto release_buffer;
+        return ret;
     }
     ret = improcessTask(job_handle, src_img, dst_img, {}, {}, dst_rect, {}, NULL, IM_SYNC);
     if (ret != IM_STATUS_SUCCESS) {
         // LOGD("%s job[%d] add left task failed, %s\n", LOG_TAG, job_handle, imStrError((IM_STATUS)ret));
         imcancelJob(job_handle);
-        goto release_buffer;
+        return ret;
     }
 
     ret = imendJob(job_handle);
-    if (ret != IM_STATUS_SUCCESS) {
-        // LOGD("%s job[%d] running failed, %s\n", LOG_TAG, job_handle, imStrError((IM_STATUS)ret));
-        // LOGD("When job failed, virt ram add is %p data : %p\n", rgbImg.vir_addr, data);
-        goto release_buffer;
-    }
     // write_image_to_file(dst_buf, LOCAL_FILE_PATH, dst_width, dst_height, dst_format, 0);
-
-    release_buffer:
-    if (src_handle)
-        releasebuffer_handle(src_handle);
-    if (dst_handle)
-        releasebuffer_handle(dst_handle);
-
     return ret;
-
 }
 
 int rga_change_color(int src_width, int src_height, int src_format, char *src_buf,
@@ -98,58 +327,212 @@ int rga_change_color(int src_width, int src_height, int src_format, char *src_bu
     // LOGD("src_width: %d, src_height: %d,  dst_width: %d, dst_height: %d, ",
         // src_width, src_height, dst_width, dst_height);
 
-    int src_buf_size, dst_buf_size;
+    RgaImport src(rga_image(-1, src_buf, src_width, src_height, src_format));
+    RgaImport dst(rga_image(-1, dst_buf, dst_width, dst_height, dst_format));
+    if (!src.valid() || !dst.valid()) {
+        LOGD("importbuffer failed!\n");
+        return ret;
+    }
 
-    rga_buffer_t src_img, dst_img;
-    rga_buffer_handle_t src_handle, dst_handle;
+    ret = imcvtcolor(src.buffer(), dst.buffer(), src_format, dst_format);
+    if (ret != IM_STATUS_SUCCESS) {
+        LOGD("running failed, %s\n", imStrError((IM_STATUS) ret));
+    }
 
-    memset(&src_img, 0, sizeof(src_img));
-    memset(&dst_img, 0, sizeof(dst_img));
+    // write_image_to_file(dst_buf, LOCAL_FILE_PATH, dst_width, dst_height, dst_format, 0);
+    return ret;
+}
 
-    src_buf_size = src_width * src_height * get_bpp_from_format(src_format);
-    dst_buf_size = dst_width * dst_height * get_bpp_from_format(dst_format);
+rga_image_t rga_image(int fd, char *buf, int width, int height, int format, int wstride, int hstride) {
+    rga_image_t image;
+    image.fd = fd;
+    image.buf = buf;
+    image.width = width;
+    image.height = height;
+    image.wstride = wstride > 0 ? wstride : width;
+    image.hstride = hstride > 0 ? hstride : height;
+    image.format = format;
+    return image;
+}
 
-    // src_buf = (char *) malloc(src_buf_size);
-    // dst_buf = (char *) malloc(dst_buf_size);
+long rga_image_bytes(const rga_image_t &image) {
+    return (long) (image.width * image.height * get_bpp_from_format(image.format));
+}
 
-    /* fill image data */
-    // memset(src_buf, 0xaa, src_buf_size);
-    // memset(dst_buf, 0x80, dst_buf_size);
+long rga_convert(const rga_image_t &src, const rga_image_t &dst) {
+    RgaImport src_import(src);
+    RgaImport dst_import(dst);
+    if (!src_import.valid() || !dst_import.valid()) {
+        LOGD("importbuffer failed!\n");
+        return -1;
+    }
+    rga_buffer_t src_img = src_import.buffer();
+    rga_buffer_t dst_img = dst_import.buffer();
+
+    IM_STATUS status;
+    if (src.width != dst.width || src.height != dst.height) {
+        // 缩放时RGA同时完成颜色空间转换
+        status = imresize(src_img, dst_img);
+    } else if (src.format != dst.format) {
+        status = imcvtcolor(src_img, dst_img, src.format, dst.format);
+    } else {
+        status = imcopy(src_img, dst_img);
+    }
+    if (status != IM_STATUS_SUCCESS) {
+        LOGD("rga_convert failed, %s\n", imStrError(status));
+        return -1;
+    }
+    return rga_image_bytes(src) + rga_image_bytes(dst);
+}
 
-    src_handle = importbuffer_virtualaddr(src_buf, src_buf_size);
-    dst_handle = importbuffer_virtualaddr(dst_buf, dst_buf_size);
-    if (src_handle == 0 || dst_handle == 0) {
+long rga_convert_region(const rga_image_t &src, const im_rect &src_rect, const rga_image_t &dst,
+                        const im_rect &dst_rect) {
+    RgaImport src_import(src);
+    RgaImport dst_import(dst);
+    if (!src_import.valid() || !dst_import.valid()) {
         LOGD("importbuffer failed!\n");
-        goto release_buffer;
+        return -1;
+    }
+    rga_buffer_t src_img = src_import.buffer();
+    rga_buffer_t dst_img = dst_import.buffer();
+    rga_buffer_t pat_img;
+    im_rect srect = src_rect, drect = dst_rect, pat_rect;
+    memset(&pat_img, 0, sizeof(pat_img));
+    memset(&pat_rect, 0, sizeof(pat_rect));
+
+    IM_STATUS status;
+    status = imcheck(src_img, dst_img, srect, drect);
+    if (status != IM_STATUS_NOERROR) {
+        LOGD("rga_convert_region check error, %s\n", imStrError(status));
+        return -1;
     }
+    // 源和目标区域尺寸不同时缩放，格式不同时同时完成颜色空间转换
+    status = improcess(src_img, dst_img, pat_img, srect, drect, pat_rect, -1, NULL, NULL, IM_SYNC);
+    if (status != IM_STATUS_SUCCESS) {
+        LOGD("rga_convert_region failed, %s\n", imStrError(status));
+        return -1;
+    }
+    return (long) (src_rect.width * src_rect.height * get_bpp_from_format(src.format)) +
+           (long) (dst_rect.width * dst_rect.height * get_bpp_from_format(dst.format));
+}
 
-    src_img.handle = src_handle;
-    src_img.width = src_width;
-    src_img.height = src_height;
-    src_img.format = src_format;
-    src_img.wstride = src_width;
-    src_img.hstride = src_height;
+long rga_convert_rect(const rga_image_t &src, const rga_image_t &dst, int x, int y, int width, int height) {
+    im_rect src_rect = {0, 0, src.width, src.height};
+    im_rect dst_rect = {x, y, width, height};
+    return rga_convert_region(src, src_rect, dst, dst_rect);
+}
 
-    dst_img.handle = dst_handle;
-    dst_img.width = dst_width;
-    dst_img.height = dst_height;
-    dst_img.format = dst_format;
-    dst_img.wstride = dst_width;
-    dst_img.hstride = dst_height;
+// rect以外的上下左右填充区，返回区域个数
+static int rga_outside_rects(const rga_image_t &image, const im_rect &rect, im_rect pads[4]) {
+    int count = 0;
+    int bottom = rect.y + rect.height;
+    int right = rect.x + rect.width;
+    if (rect.y > 0) {
+        pads[count++] = {0, 0, image.width, rect.y};
+    }
+    if (bottom < image.height) {
+        pads[count++] = {0, bottom, image.width, image.height - bottom};
+    }
+    if (rect.x > 0) {
+        pads[count++] = {0, rect.y, rect.x, rect.height};
+    }
+    if (right < image.width) {
+        pads[count++] = {right, rect.y, image.width - right, rect.height};
+    }
+    return count;
+}
 
-    ret = imcvtcolor(src_img, dst_img, src_format, dst_format);
-    if (ret != IM_STATUS_SUCCESS) {
-        LOGD("running failed, %s\n", imStrError((IM_STATUS) ret));
+long rga_convert_multi(const rga_image_t &src, const rga_output_t *outputs, int count) {
+    if (count <= 0 || count > RGA_MULTI_MAX_OUTPUTS) {
+        return -1;
+    }
+    RgaImport src_import(src);
+    std::unique_ptr<RgaImport> dst_imports[RGA_MULTI_MAX_OUTPUTS];
+    for (int i = 0; i < count; i++) {
+        dst_imports[i].reset(new RgaImport(outputs[i].image));
+        if (!dst_imports[i]->valid()) {
+            LOGD("importbuffer failed!\n");
+            return -1;
+        }
+    }
+    if (!src_import.valid()) {
+        LOGD("importbuffer failed!\n");
+        return -1;
     }
+    rga_buffer_t src_img = src_import.buffer();
+    rga_buffer_t pat_img;
+    im_rect pat_rect;
+    memset(&pat_img, 0, sizeof(pat_img));
+    memset(&pat_rect, 0, sizeof(pat_rect));
 
-    // write_image_to_file(dst_buf, LOCAL_FILE_PATH, dst_width, dst_height, dst_format, 0);
+    im_job_handle_t job_handle = imbeginJob();
+    if (job_handle <= 0) {
+        LOGD("rga_convert_multi job begin failed, %s\n", imStrError());
+        return -1;
+    }
+    long moved = 0;
+    float src_bpp = get_bpp_from_format(src.format);
+    for (int i = 0; i < count; i++) {
+        const rga_output_t &output = outputs[i];
+        rga_buffer_t dst_img = dst_imports[i]->buffer();
+        float dst_bpp = get_bpp_from_format(output.image.format);
+        IM_STATUS status;
+        if (output.fill_outside) {
+            im_rect pads[4];
+            int pad_count = rga_outside_rects(output.image, output.rect, pads);
+            if (pad_count > 0) {
+                status = imfillTaskArray(job_handle, dst_img, pads, pad_count, 0);
+                if (status != IM_STATUS_SUCCESS) {
+                    LOGD("rga_convert_multi fill %d failed, %s\n", i, imStrError(status));
+                    imcancelJob(job_handle);
+                    return -1;
+                }
+                long padded = (long) output.image.width * output.image.height - (long) output.rect.width * output.rect.height;
+                moved += (long) (padded * dst_bpp);
+            }
+        }
+        im_rect src_rect = output.src_rect;
+        im_rect dst_rect = output.rect;
+        status = imcheck(src_img, dst_img, src_rect, dst_rect);
+        if (status != IM_STATUS_NOERROR) {
+            LOGD("rga_convert_multi check %d error, %s\n", i, imStrError(status));
+            imcancelJob(job_handle);
+            return -1;
+        }
+        status = improcessTask(job_handle, src_img, dst_img, pat_img, src_rect, dst_rect, pat_rect, NULL, IM_SYNC);
+        if (status != IM_STATUS_SUCCESS) {
+            LOGD("rga_convert_multi task %d failed, %s\n", i, imStrError(status));
+            imcancelJob(job_handle);
+            return -1;
+        }
+        moved += (long) (src_rect.width * src_rect.height * src_bpp) + (long) (dst_rect.width * dst_rect.height * dst_bpp);
+    }
+    IM_STATUS status = imendJob(job_handle);
+    if (status != IM_STATUS_SUCCESS) {
+        LOGD("rga_convert_multi failed, %s\n", imStrError(status));
+        return -1;
+    }
+    return moved;
+}
 
-    release_buffer:
-    if (src_handle)
-        releasebuffer_handle(src_handle);
-    if (dst_handle)
-        releasebuffer_handle(dst_handle);
+int rga_change_color_fd(int src_width, int src_height, int src_format, char *src_buf,
+                        int dst_width, int dst_height, int dst_format, int dst_fd, char *dst_buf) {
+    if (dst_fd < 0) {
+        return rga_change_color(src_width, src_height, src_format, src_buf,
+                                dst_width, dst_height, dst_format, dst_buf);
+    }
+
+    RgaImport src(rga_image(-1, src_buf, src_width, src_height, src_format));
+    RgaImport dst(rga_image(dst_fd, dst_buf, dst_width, dst_height, dst_format));
+    if (!src.valid() || !dst.valid()) {
+        LOGD("importbuffer failed!\n");
+        return -1;
+    }
 
+    int ret = imcvtcolor(src.buffer(), dst.buffer(), src_format, dst_format);
+    if (ret != IM_STATUS_SUCCESS) {
+        LOGD("running failed, %s\n", imStrError((IM_STATUS) ret));
+    }
     return ret;
 }
 
@@ -158,14 +541,18 @@ int rga_resize(int src_width, int src_height, int src_format, char *src_buf,
 
     im_rect src_rect;
     im_rect dst_rect;
-    memset(&dst_rect, 0, sizeof(dst_rect));
     memset(&src_rect, 0, sizeof(src_rect));
     memset(&dst_rect, 0, sizeof(dst_rect));
 
-    // rga_buffer_t src = wrapbuffer_virtualaddr((void *) img_rgb.data, img.cols, img.rows, RK_FORMAT_RGB_888);
-    // rga_buffer_t dst = wrapbuffer_virtualaddr((void *) tensor.data, width, height, RK_FORMAT_RGB_888);
-    rga_buffer_t src = wrapbuffer_virtualaddr((void *) src_buf, src_width, src_height, src_format);
-    rga_buffer_t dst = wrapbuffer_virtualaddr((void *) dst_buf, dst_width, dst_height, dst_format);
+    // 按句柄提交，wrapbuffer_virtualaddr每次调用都会在librga内部重新导入
+    RgaImport src_import(rga_image(-1, src_buf, src_width, src_height, src_format));
+    RgaImport dst_import(rga_image(-1, dst_buf, dst_width, dst_height, dst_format));
+    if (!src_import.valid() || !dst_import.valid()) {
+        LOGD("importbuffer failed!\n");
+        return -1;
+    }
+    rga_buffer_t src = src_import.buffer();
+    rga_buffer_t dst = dst_import.buffer();
 
     int ret = imcheck(src, dst, src_rect, dst_rect);
     if (IM_STATUS_NOERROR != ret) {
@@ -226,8 +613,14 @@ int rga_add_boarder(int src_width, int src_height, int src_format, char *src_buf
     // rga_buffer_t src = wrapbuffer_virtualaddr((void *)img.data, img.cols, img.rows, RK_FORMAT_RGB_888);
     // rga_buffer_t dst = wrapbuffer_virtualaddr((void *)img_letterbox.data, img_letterbox.cols, img_letterbox.rows, RK_FORMAT_RGB_888);
 
-    rga_buffer_t src = wrapbuffer_virtualaddr((void *) src_buf, src_width, src_height, src_format);
-    rga_buffer_t dst = wrapbuffer_virtualaddr((void *) dst_buf, dst_width, dst_height, dst_format);
+    RgaImport src_import(rga_image(-1, src_buf, src_width, src_height, src_format));
+    RgaImport dst_import(rga_image(-1, dst_buf, dst_width, dst_height, dst_format));
+    if (!src_import.valid() || !dst_import.valid()) {
+        LOGD("importbuffer failed!\n");
+        return -1;
+    }
+    rga_buffer_t src = src_import.buffer();
+    rga_buffer_t dst = dst_import.buffer();
 
     int ret = imcheck(src, dst, src_rect, dst_rect);
     if (IM_STATUS_NOERROR != ret) {
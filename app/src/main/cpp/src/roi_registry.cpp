@@ -0,0 +1,98 @@
+#include "roi_registry.h"
+#include "log4c.h"
+
+#include <algorithm>
+
+static bool valid_camera(int cameraIndex) {
+    return cameraIndex >= 0 && cameraIndex < ROI_MAX_CAMERAS;
+}
+
+RoiRegistry &RoiRegistry::getInstance() {
+    static RoiRegistry instance;
+    return instance;
+}
+
+RoiRegistry::RoiRegistry() {
+    for (int i = 0; i < ROI_MAX_CAMERAS; i++) {
+        tileModes_[i] = TILE_MODE_OFF;
+    }
+}
+
+int RoiRegistry::setRegions(int cameraIndex, const roi_rect_t *rects, int count) {
+    if (!valid_camera(cameraIndex)) {
+        return 0;
+    }
+    std::vector<roi_rect_t> regions;
+    for (int i = 0; i < count; i++) {
+        float x0 = std::max(0.f, rects[i].x);
+        float y0 = std::max(0.f, rects[i].y);
+        float x1 = std::min(1.f, rects[i].x + rects[i].width);
+        float y1 = std::min(1.f, rects[i].y + rects[i].height);
+        if (x1 <= x0 || y1 <= y0) {
+            LOGW("Camera %d ROI %d (%.3f,%.3f %.3fx%.3f) is empty, ignored", cameraIndex, i, rects[i].x, rects[i].y,
+                 rects[i].width, rects[i].height);
+            continue;
+        }
+        if ((int) regions.size() >= ROI_MAX_PER_CAMERA) {
+            LOGW("Camera %d has more than %d ROIs, the rest are ignored", cameraIndex, ROI_MAX_PER_CAMERA);
+            break;
+        }
+        roi_rect_t rect = {x0, y0, x1 - x0, y1 - y0};
+        regions.push_back(rect);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_[cameraIndex] = regions;
+    LOGD("Camera %d detection ROIs set: %zu", cameraIndex, regions.size());
+    return (int) regions.size();
+}
+
+void RoiRegistry::clearRegions(int cameraIndex) {
+    setRegions(cameraIndex, nullptr, 0);
+}
+
+void RoiRegistry::setTileMode(int cameraIndex, tile_mode_e mode) {
+    if (!valid_camera(cameraIndex)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    tileModes_[cameraIndex] = mode;
+    LOGD("Camera %d tile mode set to %d", cameraIndex, mode);
+}
+
+tile_mode_e RoiRegistry::getTileMode(int cameraIndex) {
+    if (!valid_camera(cameraIndex)) {
+        return TILE_MODE_OFF;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tileModes_[cameraIndex];
+}
+
+void RoiRegistry::getRegions(int cameraIndex, int frameWidth, int frameHeight, int maxRegions,
+                             std::vector<cv::Rect> &rects) {
+    rects.clear();
+    cv::Rect frame(0, 0, frameWidth, frameHeight);
+    if (valid_camera(cameraIndex)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const roi_rect_t &region: regions_[cameraIndex]) {
+            int x0 = (int) (region.x * frameWidth) & ~1;
+            int y0 = (int) (region.y * frameHeight) & ~1;
+            int x1 = std::min((int) ((region.x + region.width) * frameWidth + 1) & ~1, frameWidth & ~1);
+            int y1 = std::min((int) ((region.y + region.height) * frameHeight + 1) & ~1, frameHeight & ~1);
+            if (x1 - x0 >= ROI_MIN_SIZE && y1 - y0 >= ROI_MIN_SIZE) {
+                rects.push_back(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+            }
+        }
+    }
+    if (rects.empty()) {
+        rects.push_back(frame);
+        return;
+    }
+    if ((int) rects.size() > std::max(maxRegions, 1)) {
+        // 模型一次处理不了这么多区域，合并成外接矩形，只跑一次推理
+        cv::Rect bounds = rects[0];
+        for (size_t i = 1; i < rects.size(); i++) {
+            bounds |= rects[i];
+        }
+        rects.assign(1, bounds);
+    }
+}
@@ -0,0 +1,112 @@
+
+#ifndef RK3588_DEMO_BOUNDED_QUEUE_H
+#define RK3588_DEMO_BOUNDED_QUEUE_H
+
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// 有界阻塞队列，用于流水线各阶段之间传递任务，stop()后所有等待立即返回
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity = 8) : capacity_(capacity), stopped_(false) {}
+
+    void setCapacity(size_t capacity) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacity;
+        }
+        not_full_.notify_all();
+    }
+
+    // 队列满时阻塞，停止后返回false
+    bool push(const T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&] { return queue_.size() < capacity_ || stopped_; });
+        if (stopped_) {
+            return false;
+        }
+        queue_.push(value);
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // 队列满时直接返回false
+    bool tryPush(const T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopped_ || queue_.size() >= capacity_) {
+            return false;
+        }
+        queue_.push(value);
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // 队列空时阻塞，停止后返回false
+    bool pop(T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&] { return !queue_.empty() || stopped_; });
+        if (stopped_) {
+            return false;
+        }
+        value = queue_.front();
+        queue_.pop();
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    // 最多等待timeoutMs，超时或停止返回false
+    bool popFor(T &value, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!not_empty_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                 [&] { return !queue_.empty() || stopped_; }) || stopped_) {
+            return false;
+        }
+        value = queue_.front();
+        queue_.pop();
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    bool tryPop(T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopped_ || queue_.empty()) {
+            return false;
+        }
+        value = queue_.front();
+        queue_.pop();
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    std::queue<T> queue_;
+    size_t capacity_;
+    bool stopped_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+#endif // RK3588_DEMO_BOUNDED_QUEUE_H
@@ -0,0 +1,110 @@
+#include "result_reorder_buffer.h"
+#include "log4c.h"
+
+ResultReorderBuffer::ResultReorderBuffer() : nextId_(0), maxPushedId_(-1),
+                                             window_(REORDER_DEFAULT_WINDOW), timeoutMs_(REORDER_DEFAULT_TIMEOUT_MS),
+                                             waitingGap_(false),
+                                             delivered_(0), reordered_(0), skipped_(0), lateDropped_(0) {}
+
+void ResultReorderBuffer::configure(int window, int timeoutMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_ = window > 0 ? window : 1;
+    timeoutMs_ = timeoutMs > 0 ? timeoutMs : 1;
+}
+
+void ResultReorderBuffer::push(int frameId, const std::vector<Detection> &objects,
+                               const std::shared_ptr<frame_data_t> &frameData) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frameId < nextId_) {
+        // 该帧号已经被跳过，按序交付后不能再回头
+        lateDropped_++;
+        LOGD("ResultReorderBuffer: frame %d arrived after being skipped (next %d)", frameId, nextId_);
+        return;
+    }
+    if (frameId < maxPushedId_) {
+        reordered_++;
+    } else {
+        maxPushedId_ = frameId;
+    }
+
+    Entry entry;
+    entry.objects = objects;
+    entry.frameData = frameData;
+    entries_[frameId] = entry;
+
+    // 按序到达时pop不会跳过任何帧号，缓存大小要在这里限制，否则显示线程跟不上时无限积压
+    while ((int) entries_.size() > window_) {
+        auto oldest = entries_.begin();
+        LOGD("ResultReorderBuffer: window full, drop frames %d-%d", nextId_, oldest->first);
+        skipped_ += oldest->first - nextId_ + 1;
+        nextId_ = oldest->first + 1;
+        entries_.erase(oldest);
+        waitingGap_ = false;
+    }
+}
+
+nn_error_e ResultReorderBuffer::pop(std::vector<Detection> &objects, std::shared_ptr<frame_data_t> &frameData) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.empty()) {
+        return NN_RESULT_NOT_READY;
+    }
+
+    auto it = entries_.begin();
+    if (it->first != nextId_) {
+        // 期望的帧号缺失，后面的结果已经到了：窗口满或等待超时则跳过缺口
+        auto now = std::chrono::steady_clock::now();
+        if (!waitingGap_) {
+            waitingGap_ = true;
+            gapSince_ = now;
+        }
+        bool windowFull = (int) entries_.size() >= window_;
+        bool timeout = std::chrono::duration_cast<std::chrono::milliseconds>(now - gapSince_).count() >= timeoutMs_;
+        if (!windowFull && !timeout) {
+            return NN_RESULT_NOT_READY;
+        }
+
+        LOGW("ResultReorderBuffer: skip frames %d-%d (%s)", nextId_, it->first - 1,
+             windowFull ? "window full" : "timeout");
+        skipped_ += it->first - nextId_;
+        nextId_ = it->first;
+    }
+
+    objects.swap(it->second.objects);
+    frameData = it->second.frameData;
+    entries_.erase(it);
+    nextId_++;
+    waitingGap_ = false;
+    delivered_++;
+    return NN_SUCCESS;
+}
+
+void ResultReorderBuffer::reset(int nextId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    nextId_ = nextId;
+    maxPushedId_ = nextId - 1;
+    waitingGap_ = false;
+}
+
+reorder_stats_t ResultReorderBuffer::getStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reorder_stats_t stats;
+    stats.delivered = delivered_;
+    stats.reordered = reordered_;
+    stats.skipped = skipped_;
+    stats.lateDropped = lateDropped_;
+    stats.buffered = (int) entries_.size();
+    stats.nextId = nextId_;
+    return stats;
+}
+
+void ResultReorderBuffer::logStats(int cameraIndex) {
+    reorder_stats_t stats = getStats();
+    LOGD("Camera %d result reorder: delivered=%llu reordered=%llu skipped=%llu late dropped=%llu buffered=%d next=%d",
+         cameraIndex,
+         (unsigned long long) stats.delivered,
+         (unsigned long long) stats.reordered,
+         (unsigned long long) stats.skipped,
+         (unsigned long long) stats.lateDropped,
+         stats.buffered, stats.nextId);
+}
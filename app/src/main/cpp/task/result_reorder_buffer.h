@@ -0,0 +1,68 @@
+
+#ifndef RK3588_DEMO_RESULT_REORDER_BUFFER_H
+#define RK3588_DEMO_RESULT_REORDER_BUFFER_H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include "user_comm.h"
+#include "yolo_datatype.h"
+#include "error.h"
+
+#define REORDER_DEFAULT_WINDOW 16           // 最多缓存的结果数，30fps约半秒，与缺帧超时相当
+#define REORDER_DEFAULT_TIMEOUT_MS 500      // 缺帧等待超时
+
+typedef struct {
+    uint64_t delivered;     // 按序交付的结果数
+    uint64_t reordered;     // 到达顺序与帧号顺序不一致的结果数
+    uint64_t skipped;       // 因超时或窗口满而跳过的帧号数
+    uint64_t lateDropped;   // 跳过之后才到达、被丢弃的结果数
+    int buffered;           // 当前缓存的结果数
+    int nextId;             // 下一个期望交付的帧号
+} reorder_stats_t;
+
+// 每路摄像头一个：推理线程乱序放入结果，显示线程严格按帧号顺序取出
+// 期望的帧号缺失时，窗口满或等待超时后跳过缺口，不再无限等待；显示线程跟不上时超出窗口的最旧结果被丢弃
+class ResultReorderBuffer {
+public:
+    ResultReorderBuffer();
+
+    void configure(int window, int timeoutMs);
+
+    void push(int frameId, const std::vector<Detection> &objects, const std::shared_ptr<frame_data_t> &frameData);
+
+    // 取出下一个结果，尚无可交付的结果时返回NN_RESULT_NOT_READY
+    nn_error_e pop(std::vector<Detection> &objects, std::shared_ptr<frame_data_t> &frameData);
+
+    // 清空缓存并从nextId重新开始（流重启时使用）
+    void reset(int nextId = 0);
+
+    reorder_stats_t getStats();
+
+    void logStats(int cameraIndex);
+
+private:
+    struct Entry {
+        std::vector<Detection> objects;
+        std::shared_ptr<frame_data_t> frameData;
+    };
+
+    std::mutex mutex_;
+    std::map<int, Entry> entries_;
+    int nextId_;
+    int maxPushedId_;
+    int window_;
+    int timeoutMs_;
+    bool waitingGap_;
+    std::chrono::steady_clock::time_point gapSince_;
+
+    uint64_t delivered_;
+    uint64_t reordered_;
+    uint64_t skipped_;
+    uint64_t lateDropped_;
+};
+
+#endif // RK3588_DEMO_RESULT_REORDER_BUFFER_H
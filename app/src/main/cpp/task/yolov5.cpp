@@ -5,8 +5,15 @@
 
 #include "logging.h"
 #include "preprocess.h"
+#include "image_processor.h"
+#include "scratch_arena.h"
+#include "bandwidth_meter.h"
 #include "yolov5_postprocess.h"
 #include "rknn_engine.h"  // 添加RKEngine头文件
+#include "npu_capacity_allocator.h"
+#include "roi_registry.h"
+#include "detection_merge.h"
+#include "tile_layout.h"
 
 #include <ctime>
 
@@ -141,100 +148,328 @@ nn_error_e Yolov5::LoadModelWithData(char *modelData, int modelSize) {
 
 
 // 图像预处理
-nn_error_e Yolov5::Preprocess(const cv::Mat &img, const std::string process_type, cv::Mat &image_letterbox) {
+nn_error_e Yolov5::Preprocess(const cv::Mat &img, cv::Size &letterbox_size) {
 
     // 预处理包含：letterbox、归一化、BGR2RGB、NCWH
     // 其中RKNN会做：归一化、NCWH转换（详见课程文档），所以这里只需要做letterbox、BGR2RGB
-
-    // 比例
-    float wh_ratio = (float) input_tensor_.attr.dims[2] / (float) input_tensor_.attr.dims[1];
-
-    // lettorbox
-
-    if (process_type == "opencv") {
-        // BGR2RGB，resize，再放入input_tensor_中
-        letterbox_info_ = letterbox(img, image_letterbox, wh_ratio);
-        cvimg2tensor(image_letterbox, input_tensor_.attr.dims[2], input_tensor_.attr.dims[1], input_tensor_);
-    } else if (process_type == "rga") {
-        // rga resize
-        letterbox_info_ = letterbox_rga(img, image_letterbox, wh_ratio);
-        // save img
-        // cv::imwrite("rga.jpg", image_letterbox);
-        cvimg2tensor_rga(image_letterbox, input_tensor_.attr.dims[2], input_tensor_.attr.dims[1], input_tensor_);
+    if (img.type() != CV_8UC3) {
+        NN_LOG_ERROR("img has to be 3 channels");
+        return NN_IO_NUM_NOT_MATCH;
     }
-
+    cv::Mat bgr = img.isContinuous() ? img : img.clone();
+    int modelWidth = input_tensor_.attr.dims[2];
+    int modelHeight = input_tensor_.attr.dims[1];
+    const LetterboxGeometry &geometry = letterbox_geometry(bgr.cols, bgr.rows, modelWidth, modelHeight);
+    letterbox_info_ = geometry.info;
+    letterbox_size = geometry.letterbox_size;
+
+    // 缩放、BGR2RGB和填充一次完成，直接写入输入张量；后端由ImageProcessor选择
+    rga_image_t src = rga_image(-1, (char *) bgr.data, bgr.cols, bgr.rows, RK_FORMAT_BGR_888);
+    rga_image_t dst = rga_image(-1, (char *) input_tensor_.data, modelWidth, modelHeight, RK_FORMAT_RGB_888);
+    long moved = ImageProcessor::getInstance().letterbox(src, dst, geometry.dst_rect);
+    if (moved < 0) {
+        NN_LOG_ERROR("Preprocess: letterbox %dx%d failed", bgr.cols, bgr.rows);
+        return NN_IMAGE_PROCESS_FAIL;
+    }
+    BandwidthMeter::record(BW_SITE_LETTERBOX, rga_image_bytes(src), moved - rga_image_bytes(src));
     return NN_SUCCESS;
 }
 
 // 推理
 nn_error_e Yolov5::Inference() {
+    return InferenceTensors(input_tensor_, output_tensors_);
+}
+
+// 在外部提供的缓冲上推理，同一个实例同一时间只能被一个线程调用
+nn_error_e Yolov5::InferenceTensors(tensor_data_s &input, std::vector <tensor_data_s> &outputs) {
+    return InferenceTensorsFd(-1, input, outputs);
+}
+
+nn_error_e Yolov5::InferenceTensorsFd(int fd, tensor_data_s &input, std::vector <tensor_data_s> &outputs) {
     std::vector <tensor_data_s> inputs;
-    // 将input_tensor_放入inputs中
-    inputs.push_back(input_tensor_);
-    // 运行模型
-    engine_->Run(inputs, output_tensors_, false);
+    inputs.push_back(input);
+
+    // 记录NPU耗时，供全局算力分配估算容量
+    NpuCapacityAllocator &allocator = NpuCapacityAllocator::getInstance();
+    struct timeval start, end;
+    allocator.beginInference();
+    gettimeofday(&start, NULL);
+    nn_error_e ret = fd >= 0 ? engine_->RunWithInputFd(fd, input.data, inputs, outputs, false)
+                             : engine_->Run(inputs, outputs, false);
+    gettimeofday(&end, NULL);
+    allocator.endInference((end.tv_sec - start.tv_sec) * 1000000LL + (end.tv_usec - start.tv_usec));
+    return ret;
+}
+
+// 按本实例的输入输出属性分配一组缓冲，供流水线预分配后循环使用
+nn_error_e Yolov5::AllocateTensors(tensor_data_s &input, std::vector <tensor_data_s> &outputs) const {
+    if (input_tensor_.data == nullptr) {
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    input.attr = input_tensor_.attr;
+    input.data = malloc(input.attr.size);
+
+    outputs.clear();
+    for (size_t i = 0; i < output_tensors_.size(); i++) {
+        tensor_data_s tensor;
+        tensor.attr = output_tensors_[i].attr;
+        tensor.data = malloc(tensor.attr.size);
+        outputs.push_back(tensor);
+    }
     return NN_SUCCESS;
 }
 
+void Yolov5::ReleaseTensors(tensor_data_s &input, std::vector <tensor_data_s> &outputs) {
+    if (input.data != nullptr) {
+        free(input.data);
+        input.data = nullptr;
+    }
+    for (auto &tensor: outputs) {
+        free(tensor.data);
+        tensor.data = nullptr;
+    }
+    outputs.clear();
+}
+
+// 预热，首次rknn_run会做内存分配和初始化，放在线程接任务之前完成
+nn_error_e Yolov5::Warmup() {
+    if (input_tensor_.data == nullptr) {
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    memset(input_tensor_.data, 0, input_tensor_.attr.size);
+    return Inference();
+}
+
 // 运行模型
 nn_error_e Yolov5::Run(const cv::Mat &img, std::vector <Detection> &objects) {
-    // letterbox后的图像
-    cv::Mat image_letterbox;
-    // 预处理，支持opencv或rga
-    Preprocess(img, "opencv", image_letterbox);
-    // Preprocess(img, "rga", image_letterbox);
+    // letterbox后的图像尺寸
+    cv::Size letterbox_size;
+    // 预处理
+    nn_error_e ret = Preprocess(img, letterbox_size);
+    if (ret != NN_SUCCESS) {
+        return ret;
+    }
     // 推理
     Inference();
     // 后处理
-    Postprocess(image_letterbox, objects);
+    PostprocessTensors(output_tensors_, letterbox_info_, letterbox_size, objects);
     return NN_SUCCESS;
 
 }
 
 nn_error_e Yolov5::RunWithFrameData(const std::shared_ptr <frame_data_t> frameData, std::vector <Detection> &objects) {
-    // letterbox后的图像
-    cv::Mat image_letterbox;
-    rga_buffer_t origin;
+    std::vector <FramePass> passes;
+    crop_plan_e plan = PlanFrame(frameData, passes);
+    return RunWithPlan(frameData, plan, passes, objects);
+}
+
+nn_error_e Yolov5::RunWithPlan(const std::shared_ptr <frame_data_t> frameData, crop_plan_e plan,
+                               const std::vector <FramePass> &passes, std::vector <Detection> &objects) {
     struct timeval start, end;
     gettimeofday(&start, NULL);
 
-    int inputWidth = frameData->widthStride;
-    int inputHeight = frameData->heightStride;
+    // 预处理，NV12一步letterbox到模型输入；RGA处理不了的输入由自检排除，失败时自动改用CPU
+    // 分块检测时各块依次推理，流水线模式下各块分给不同的NPU上下文并行
+    int64_t npuUs = 0;
+    for (const auto &pass: passes) {
+        nn_error_e ret = PreprocessRegions(frameData, input_tensor_, pass, regions_);
+        if (ret != NN_SUCCESS) {
+            // 失败的帧也按空结果交回CropScheduler，统计和整幅检测的间隔计数不会漏掉这一帧
+            objects.clear();
+            CropScheduler::getInstance().update(frameData->cameraIndex, plan, frameData->pts, objects, npuUs);
+            return ret;
+        }
+        // 推理
+        struct timeval npuStart, npuEnd;
+        gettimeofday(&npuStart, NULL);
+        Inference();
+        gettimeofday(&npuEnd, NULL);
+        npuUs += (npuEnd.tv_sec - npuStart.tv_sec) * 1000000LL + (npuEnd.tv_usec - npuStart.tv_usec);
+        // 后处理
+        PostprocessRegions(output_tensors_, regions_, objects);
+    }
+    if (passes.size() > 1) {
+        merge_detections(objects, NMS_THRESH);
+    }
+    CropScheduler::getInstance().update(frameData->cameraIndex, plan, frameData->pts, objects, npuUs);
 
-    // LOGD("RunWithFrameData inputWidth :%d inputHeight:%d", inputWidth, inputHeight);
-    // im_rect src_rect;
-    // memset(&src_rect, 0, sizeof(src_rect));
-    // rga_letter_box(&origin, frameData->data, inputWidth, inputHeight, frameData->frameFormat, &letterbox_info_.hor, &letterbox_info_.pad);
+    gettimeofday(&end, NULL);
+    // LOGD("RunWithFrameData time cost: %ld ms", (end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000);
 
-    origin = wrapbuffer_virtualaddr((void *) frameData->data, inputWidth, inputHeight, frameData->frameFormat);
-    cv::Mat origin_mat = cv::Mat::zeros(inputHeight, inputWidth, CV_8UC3);
-    // 先转成cv matrix
-    rga_buffer_t rgb_img = wrapbuffer_virtualaddr((void *) origin_mat.data, inputWidth, inputHeight, RK_FORMAT_RGB_888);
-    imcopy(origin, rgb_img);
+    return NN_SUCCESS;
 
-    // destroy frameData;
-    // LOGD("RunWithFrameData Start preprocess");
-    // 预处理，支持opencv或rga
-    Preprocess(origin_mat, "opencv", image_letterbox);
+}
 
-    // LOGD("RunWithFrameData Start inference");
-    // 不可以用rga, 不然直接硬件嗝屁了.
-    // Preprocess(origin_mat, "rga", image_letterbox);
-    // 推理
-    Inference();
-    // LOGD("RunWithFrameData Start post-process");
-    // 后处理
-    Postprocess(image_letterbox, objects);
+// 帧数据预处理到指定的输入缓冲，只读取模型输入属性，可以在多个线程上并发调用
+// inputBuffer为input.data所在的帧缓冲，DMA-buf时RGA按fd写入
+nn_error_e Yolov5::PreprocessFrame(const std::shared_ptr <frame_data_t> frameData, tensor_data_s &input,
+                                   std::vector <InputRegion> &regions, FrameBuffer *inputBuffer) const {
+    int batch = input.attr.n_dims == 4 ? (int) input.attr.dims[0] : 1;
+    FramePass pass;
+    pass.mosaic = false;
+    RoiRegistry::getInstance().getRegions(frameData->cameraIndex, frameData->screenW, frameData->screenH, batch,
+                                          pass.rects);
+    return PreprocessRegions(frameData, input, pass, regions, inputBuffer);
+}
 
-    // LOGD("RunWithFrameData letterbox_decode");
-    // letterbox_decode(objects, letterbox_info_.hor, letterbox_info_.pad);
+crop_plan_e Yolov5::PlanFrame(const std::shared_ptr <frame_data_t> frameData, std::vector <FramePass> &passes) const {
+    int batch = input_tensor_.attr.n_dims == 4 ? std::max((int) input_tensor_.attr.dims[0], 1) : 1;
+    int perPass = std::min(batch, IMG_FANOUT_MAX_REGIONS);
+    int width = frameData->screenW;
+    int height = frameData->screenH;
+    RoiRegistry &registry = RoiRegistry::getInstance();
+    tile_mode_e mode = registry.getTileMode(frameData->cameraIndex);
+    passes.clear();
+
+    // 跟踪裁剪优先于分块检测：区域检测的帧只推理一次拼图，没有跟踪目标的帧不推理
+    FramePass pass;
+    pass.mosaic = false;
+    crop_plan_e plan = CropScheduler::getInstance().plan(frameData->cameraIndex, frameData->pts, width, height,
+                                                         input_tensor_.attr.dims[2], input_tensor_.attr.dims[1],
+                                                         pass.rects);
+    if (plan == CROP_PLAN_CROPS) {
+        pass.mosaic = true;
+        passes.push_back(pass);
+        return plan;
+    }
+    if (plan == CROP_PLAN_IDLE) {
+        return plan;
+    }
+    if (mode != TILE_MODE_OFF && plan == CROP_PLAN_OFF) {
+        const TileLayout &layout = tile_layout(width, height, input_tensor_.attr.dims[2], input_tensor_.attr.dims[1]);
+        std::vector <cv::Rect> rois;
+        registry.getRegions(frameData->cameraIndex, width, height, ROI_MAX_PER_CAMERA, rois);
+        std::vector <cv::Rect> tiles;
+        for (const cv::Rect &tile: layout.tiles) {
+            for (const cv::Rect &roi: rois) {
+                if ((tile & roi).area() > 0) {
+                    tiles.push_back(tile);
+                    break;
+                }
+            }
+        }
+        // 只有一块时和整幅检测相同
+        if (tiles.size() > 1) {
+            for (size_t i = 0; i < tiles.size(); i += perPass) {
+                pass.rects.assign(tiles.begin() + i, tiles.begin() + std::min(i + perPass, tiles.size()));
+                passes.push_back(pass);
+            }
+        }
+    }
+    if (passes.empty() || mode == TILE_MODE_TILES_COARSE) {
+        registry.getRegions(frameData->cameraIndex, width, height, batch, pass.rects);
+        passes.push_back(pass);
+    }
+    return plan;
+}
 
-    // LOGD("RunWithFrameData End post-process");
-    gettimeofday(&end, NULL);
-    // LOGD("RunWithFrameData time cost: %ld ms", (end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000);
+nn_error_e Yolov5::PreprocessRegions(const std::shared_ptr <frame_data_t> frameData, tensor_data_s &input,
+                                     const FramePass &pass, std::vector <InputRegion> &regions,
+                                     FrameBuffer *inputBuffer) const {
+    const std::vector <cv::Rect> &rects = pass.rects;
+    // 只取有效区域，stride对齐部分不参与检测
+    int inputWidth = frameData->screenW;
+    int inputHeight = frameData->screenH;
+    int batch = input.attr.n_dims == 4 ? (int) input.attr.dims[0] : 1;
+    int modelWidth = input.attr.dims[2];
+    int modelHeight = input.attr.dims[1];
+    if (batch < 1 || input.attr.size != (uint32_t) (batch * modelWidth * modelHeight * 3)) {
+        NN_LOG_ERROR("PreprocessFrame: input size %d does not match %dx%dx%dx3", input.attr.size, batch, modelWidth,
+                     modelHeight);
+        return NN_IO_NUM_NOT_MATCH;
+    }
+    int maxRegions = pass.mosaic ? IMG_FANOUT_MAX_REGIONS : std::min(batch, IMG_FANOUT_MAX_REGIONS);
+    std::vector <cv::Rect> cells;
+    if (rects.empty() || (int) rects.size() > maxRegions ||
+        (pass.mosaic && !mosaic_cells((int) rects.size(), modelWidth, modelHeight, cells))) {
+        NN_LOG_ERROR("PreprocessFrame: %zu regions for batch %d", rects.size(), batch);
+        return NN_IO_NUM_NOT_MATCH;
+    }
 
-    return NN_SUCCESS;
+    // LOGD("PreprocessFrame inputWidth :%d inputHeight:%d", inputWidth, inputHeight);
+    BandwidthCameraScope bandwidthScope(frameData->cameraIndex);
+
+    // 帧在队列中是NV12，一步完成颜色转换、缩放和letterbox，RGB直接写入模型输入
+    // DMA-buf按fd交给RGA，不需要按虚拟地址导入；CPU读写时由后端负责cache同步
+    // 模型输入按batch看作纵向排列的batch幅图，第i个区域写到第i幅；拼图时写到第一幅的第i个格子
+    int srcFd = frameData->buffer && frameData->buffer->isDmaBuf() ? frameData->buffer->fd : -1;
+    rga_image_t src = rga_image(srcFd, frameData->data, inputWidth, inputHeight, frameData->frameFormat,
+                                frameData->widthStride, frameData->heightStride);
+    rga_image_t dst = rga_image(inputBuffer && inputBuffer->isDmaBuf() ? inputBuffer->fd : -1, (char *) input.data,
+                                modelWidth, modelHeight * batch, RK_FORMAT_RGB_888);
+
+    // 第一个区域按letterbox处理，目标图其余部分（包括其他batch）先填0，其余区域只写各自的有效区域
+    // 需要送显的帧同时生成RGBA显示图，都选用RGA时和模型输入在一次RGA提交中完成，源图只提交一次
+    image_output_t outputs[IMG_FANOUT_MAX_REGIONS + 1];
+    regions.clear();
+    long readBytes = 0;
+    for (size_t i = 0; i < rects.size(); i++) {
+        cv::Rect cell = pass.mosaic ? cells[i] : cv::Rect();
+        const LetterboxGeometry &geometry = pass.mosaic ?
+                                            letterbox_geometry(rects[i].width, rects[i].height, cell.width,
+                                                               cell.height) :
+                                            letterbox_geometry(rects[i].width, rects[i].height, modelWidth,
+                                                               modelHeight);
+        InputRegion region;
+        region.src_rect = rects[i];
+        region.letterbox_info = geometry.info;
+        region.letterbox_size = geometry.letterbox_size;
+        region.cell = cell;
+        region.input_rect = geometry.dst_rect + cell.tl();
+        regions.push_back(region);
+        outputs[i].image = dst;
+        outputs[i].rect = pass.mosaic ? region.input_rect : geometry.dst_rect + cv::Point(0, modelHeight * (int) i);
+        outputs[i].letterbox = i == 0;
+        outputs[i].src_rect = rects[i];
+        readBytes += (long) (rects[i].area() * image_format_bpp(src.format));
+    }
+    int regionCount = (int) regions.size();
+    int outputCount = regionCount;
+    std::shared_ptr<FrameBuffer> display;
+    if (frameData->displayW > 0 && frameData->displayH > 0 && !frameData->displayBuffer) {
+        display = FrameBufferPool::getInstance().acquire((size_t) frameData->displayW * frameData->displayH * 4);
+        if (display) {
+            image_output_t &output = outputs[outputCount++];
+            output.image = rga_image(display->isDmaBuf() ? display->fd : -1, display->data, frameData->displayW,
+                                     frameData->displayH, RK_FORMAT_RGBA_8888);
+            output.rect = cv::Rect(0, 0, frameData->displayW, frameData->displayH);
+            output.letterbox = false;
+            output.src_rect = cv::Rect(0, 0, inputWidth, inputHeight);
+        }
+    }
 
+    // CPU后端的行缓冲取自各线程的缓冲，分辨率不变时跨帧复用
+    ScratchArena &arena = ScratchArena::forCurrentThread();
+    arena.beginFrame();
+    image_backend_e backend = IMG_BACKEND_AUTO;
+    long moved = ImageProcessor::getInstance().fanout(src, outputs, outputCount, &backend);
+    if (moved < 0 && outputCount > regionCount) {
+        // 显示图生成失败不影响检测，送显时再单独转换
+        outputCount = regionCount;
+        moved = ImageProcessor::getInstance().fanout(src, outputs, outputCount, &backend);
+    }
+    frameData->scratchAllocs = arena.endFrame();
+    if (frameData->scratchAllocs > 0) {
+        NN_LOG_DEBUG("PreprocessFrame: %dx%d reallocated %d scratch buffers", inputWidth, inputHeight,
+                     frameData->scratchAllocs);
+    }
+    if (moved < 0) {
+        NN_LOG_ERROR("PreprocessFrame: letterbox %dx%d format 0x%x to %d regions failed", inputWidth, inputHeight,
+                     frameData->frameFormat, regionCount);
+        return NN_IMAGE_PROCESS_FAIL;
+    }
+    frameData->bytesMoved += moved;
+    if (outputCount > regionCount) {
+        long frameBytes = rga_image_bytes(src);
+        long displayBytes = rga_image_bytes(outputs[regionCount].image);
+        BandwidthMeter::record(BW_SITE_DISPLAY_CONVERT, frameBytes, displayBytes);
+        moved -= frameBytes + displayBytes;
+        frameData->displayBuffer = display;
+        frameData->displayCharge.assign(frameData->cameraIndex, MEM_STAGE_INFERENCE, (int64_t) display->size);
+    }
+    BandwidthMeter::record(backend == IMG_BACKEND_RGA ? BW_SITE_PREPROCESS_RGA : BW_SITE_TENSOR, readBytes,
+                           moved - readBytes);
+    return NN_SUCCESS;
 }
 
 
@@ -248,27 +483,88 @@ void letterbox_decode(std::vector <Detection> &objects, bool hor, int pad) {
     }
 }
 
-// 后处理
-nn_error_e Yolov5::Postprocess(const cv::Mat &img, std::vector <Detection> &objects) {
+// 对指定的输出缓冲做后处理，letterbox_size为letterbox后图像的尺寸，可以在多个线程上并发调用
+nn_error_e Yolov5::PostprocessTensors(std::vector <tensor_data_s> &outputs, const LetterBoxInfo &letterbox_info,
+                                      const cv::Size &letterbox_size, std::vector <Detection> &objects) const {
     int height = input_tensor_.attr.dims[1];
     int width = input_tensor_.attr.dims[2];
-    float scale_w = height * 1.f / img.cols; // 保证为浮点类型
-    float scale_h = width * 1.f / img.rows;
+    float scale_w = height * 1.f / letterbox_size.width; // 保证为浮点类型
+    float scale_h = width * 1.f / letterbox_size.height;
 
     yolov5::detect_result_group_t detections;
+    std::vector <int32_t> out_zps = out_zps_;
+    std::vector<float> out_scales = out_scales_;
 
-    yolov5::post_process((int8_t *) output_tensors_[0].data,
-                         (int8_t *) output_tensors_[1].data,
-                         (int8_t *) output_tensors_[2].data,
+    yolov5::post_process((int8_t *) outputs[0].data,
+                         (int8_t *) outputs[1].data,
+                         (int8_t *) outputs[2].data,
                          height, width,
                          BOX_THRESH, NMS_THRESH,
                          scale_w, scale_h,
-                         out_zps_, out_scales_,
+                         out_zps, out_scales,
                          &detections);
 
     DetectionGrp2DetectionArray(detections, objects);
-    letterbox_decode(objects, letterbox_info_.hor, letterbox_info_.pad);
+    letterbox_decode(objects, letterbox_info.hor, letterbox_info.pad);
+
+    return NN_SUCCESS;
+}
+
+// 每个区域的输出在各输出张量中按batch连续存放
+nn_error_e Yolov5::PostprocessRegions(std::vector <tensor_data_s> &outputs, const std::vector <InputRegion> &regions,
+                                      std::vector <Detection> &objects) const {
+    int batch = input_tensor_.attr.n_dims == 4 ? (int) input_tensor_.attr.dims[0] : 1;
+    if (!regions.empty() && regions[0].cell.area() > 0) {
+        return PostprocessMosaic(outputs, regions, objects);
+    }
+    if (regions.empty() || (int) regions.size() > batch) {
+        NN_LOG_ERROR("PostprocessRegions: %zu regions for batch %d", regions.size(), batch);
+        return NN_IO_NUM_NOT_MATCH;
+    }
+    std::vector <tensor_data_s> slices = outputs;
+    for (size_t i = 0; i < regions.size(); i++) {
+        for (size_t j = 0; j < outputs.size(); j++) {
+            slices[j].data = (int8_t *) outputs[j].data + outputs[j].attr.size / batch * i;
+        }
+        std::vector <Detection> detections;
+        PostprocessTensors(slices, regions[i].letterbox_info, regions[i].letterbox_size, detections);
+        const cv::Point offset = regions[i].src_rect.tl();
+        for (auto &obj: detections) {
+            obj.box += offset;
+            objects.push_back(obj);
+        }
+    }
+    if (regions.size() > 1) {
+        merge_detections(objects, NMS_THRESH);
+    }
+    return NN_SUCCESS;
+}
 
+// 拼图在第一个batch中，整幅输入按不做letterbox处理，框的坐标就是模型输入中的坐标
+// 框裁到所在格子中区域的有效部分后按该区域的缩放比例还原；中心落在填充部分的框丢弃
+nn_error_e Yolov5::PostprocessMosaic(std::vector <tensor_data_s> &outputs, const std::vector <InputRegion> &regions,
+                                     std::vector <Detection> &objects) const {
+    int height = input_tensor_.attr.dims[1];
+    int width = input_tensor_.attr.dims[2];
+    LetterBoxInfo identity = {false, 0};
+    std::vector <Detection> detections;
+    PostprocessTensors(outputs, identity, cv::Size(width, height), detections);
+    for (auto &obj: detections) {
+        cv::Point center(obj.box.x + obj.box.width / 2, obj.box.y + obj.box.height / 2);
+        for (const InputRegion &region: regions) {
+            if (!region.input_rect.contains(center)) {
+                continue;
+            }
+            cv::Rect box = obj.box & region.input_rect;
+            float sx = (float) region.src_rect.width / region.input_rect.width;
+            float sy = (float) region.src_rect.height / region.input_rect.height;
+            obj.box = cv::Rect(region.src_rect.x + cvRound((box.x - region.input_rect.x) * sx),
+                               region.src_rect.y + cvRound((box.y - region.input_rect.y) * sy),
+                               cvRound(box.width * sx), cvRound(box.height * sy));
+            objects.push_back(obj);
+            break;
+        }
+    }
     return NN_SUCCESS;
 }
 
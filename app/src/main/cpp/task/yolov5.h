@@ -7,6 +7,22 @@
 #include "engine.h"
 #include "preprocess.h"
 #include "user_comm.h"
+#include "crop_scheduler.h"
+
+// 一次推理中的一个检测区域：原图src_rect区域letterbox到模型输入的一个batch，后处理按它还原坐标
+struct InputRegion {
+    cv::Rect src_rect;
+    LetterBoxInfo letterbox_info;
+    cv::Size letterbox_size;
+    cv::Rect cell;          // 拼图时该区域在模型输入中的格子，按batch排列时为空
+    cv::Rect input_rect;    // 区域缩放后在模型输入（所在batch）中的位置
+};
+
+// 一次推理：各区域分别letterbox到一个batch，或者（跟踪裁剪的小区域）拼进一幅模型输入的各个格子
+struct FramePass {
+    std::vector <cv::Rect> rects;
+    bool mosaic;
+};
 
 class Yolov5 {
 public:
@@ -17,17 +33,47 @@ public:
     nn_error_e LoadModel(const char *model_path);                        // 加载模型
     nn_error_e Run(const cv::Mat &img, std::vector <Detection> &objects); // 运行模型
     nn_error_e RunWithFrameData(const std::shared_ptr <frame_data_t> frameData, std::vector <Detection> &objects);
+    // 按提交时PlanFrame给出的检测方式运行，结果连同检测方式交回CropScheduler
+    nn_error_e RunWithPlan(const std::shared_ptr <frame_data_t> frameData, crop_plan_e plan,
+                           const std::vector <FramePass> &passes, std::vector <Detection> &objects);
+    nn_error_e Warmup();                                                 // 预热：用空输入跑一次推理
+
+    // 分阶段接口，供流水线在不同线程上分别执行预处理、NPU推理和后处理
+    nn_error_e AllocateTensors(tensor_data_s &input, std::vector <tensor_data_s> &outputs) const; // 按模型属性分配一组输入输出缓冲
+    static void ReleaseTensors(tensor_data_s &input, std::vector <tensor_data_s> &outputs);
+    // 摄像头设置了检测区域时只处理这些区域，模型batch大于1时每个区域占一个batch
+    nn_error_e PreprocessFrame(const std::shared_ptr <frame_data_t> frameData, tensor_data_s &input,
+                               std::vector <InputRegion> &regions, FrameBuffer *inputBuffer = nullptr) const;
+    // 一帧需要的各次推理，每次最多batch个区域；分块检测时有多次，结果要合并后才是整帧的结果
+    // 打开跟踪裁剪时由CropScheduler决定本帧的检测方式，没有跟踪目标的帧passes为空；返回检测方式
+    // 整幅检测的间隔按调用顺序计数，同一摄像头要按帧序在一个线程上调用（提交任务时）
+    crop_plan_e PlanFrame(const std::shared_ptr <frame_data_t> frameData, std::vector <FramePass> &passes) const;
+    // 原图各区域分别letterbox到模型输入的各个batch，拼图时letterbox到第一个batch的各个格子
+    nn_error_e PreprocessRegions(const std::shared_ptr <frame_data_t> frameData, tensor_data_s &input,
+                                 const FramePass &pass, std::vector <InputRegion> &regions,
+                                 FrameBuffer *inputBuffer = nullptr) const;
+    nn_error_e InferenceTensors(tensor_data_s &input, std::vector <tensor_data_s> &outputs);
+    // input.data位于DMA-buf(fd)中时由NPU直接读取
+    nn_error_e InferenceTensorsFd(int fd, tensor_data_s &input, std::vector <tensor_data_s> &outputs);
+    nn_error_e PostprocessTensors(std::vector <tensor_data_s> &outputs, const LetterBoxInfo &letterbox_info,
+                                  const cv::Size &letterbox_size, std::vector <Detection> &objects) const;
+    // 按PreprocessFrame给出的区域逐个后处理，坐标还原到整幅画面后追加到objects，多个区域的结果合并去重
+    // 拼图时整幅模型输入一起后处理，每个框按中心所在的格子还原到对应区域
+    nn_error_e PostprocessRegions(std::vector <tensor_data_s> &outputs, const std::vector <InputRegion> &regions,
+                                  std::vector <Detection> &objects) const;
 
     // NPU核心管理
     void SetNPUCore(int core_id);                                        // 设置NPU核心
     int GetNPUCore() const;                                              // 获取当前NPU核心
 
 private:
-    nn_error_e Preprocess(const cv::Mat &img, const std::string process_type, cv::Mat &image_letterbox);   // 图像预处理
+    nn_error_e PostprocessMosaic(std::vector <tensor_data_s> &outputs, const std::vector <InputRegion> &regions,
+                                 std::vector <Detection> &objects) const;
+    nn_error_e Preprocess(const cv::Mat &img, cv::Size &letterbox_size);         // 图像预处理
     nn_error_e Inference();                                                      // 推理
-    nn_error_e Postprocess(const cv::Mat &img, std::vector <Detection> &objects); // 后处理
 
     LetterBoxInfo letterbox_info_;
+    std::vector <InputRegion> regions_;
     tensor_data_s input_tensor_;
     std::vector <tensor_data_s> output_tensors_;
     std::vector <int32_t> out_zps_;
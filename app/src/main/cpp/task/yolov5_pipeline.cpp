@@ -0,0 +1,361 @@
+#include "yolov5_pipeline.h"
+#include "sys/time.h"
+#include "cpu_topology.h"
+#include "cpu_budget.h"
+#include "scratch_arena.h"
+#include "image_processor.h"
+#include "bandwidth_meter.h"
+#include "detection_merge.h"
+#include "yolov5_postprocess.h"
+#include "log4c.h"
+
+#include <unistd.h>
+
+// 输入队列深度，帧率控制器已经限制了待推理帧数，这里只做兜底
+#define PIPELINE_INPUT_DEPTH 8
+// NPU线程等待作业的超时时间，超时后检查是否被缩容淘汰
+#define PIPELINE_NPU_POLL_MS 50
+// 最多预分配的作业数：每个NPU上下文一个在跑一个排队，再加上预处理中的
+#define PIPELINE_MAX_JOBS (PIPELINE_MAX_NPU_WORKERS * 2 + PIPELINE_PRE_THREADS)
+
+static const char *g_stage_names[3] = {"preprocess", "npu", "postprocess"};
+
+Yolov5Pipeline::Yolov5Pipeline() : input_queue_(PIPELINE_INPUT_DEPTH), free_jobs_(PIPELINE_MAX_JOBS),
+                                   npu_queue_(PIPELINE_MAX_JOBS), post_queue_(PIPELINE_MAX_JOBS),
+                                   active_npu_workers_(0), pending_(0), stop_(false),
+                                   model_data_(nullptr), model_size_(0), tiled_time_us_(0), tiled_count_(0) {
+    for (int i = 0; i < 3; i++) {
+        stage_time_us_[i].store(0);
+        stage_count_[i].store(0);
+    }
+}
+
+Yolov5Pipeline::~Yolov5Pipeline() {
+    stop();
+    for (auto &job: jobs_) {
+        job->frameData.reset();
+        job->frame.reset();
+        if (job->inputBuffer) {
+            // 输入在帧缓冲池中，由inputBuffer归还
+            job->input.data = nullptr;
+            job->inputBuffer.reset();
+        }
+        Yolov5::ReleaseTensors(job->input, job->outputs);
+    }
+    jobs_.clear();
+}
+
+void Yolov5Pipeline::stop() {
+    stop_ = true;
+    input_queue_.stop();
+    free_jobs_.stop();
+    npu_queue_.stop();
+    post_queue_.stop();
+    for (auto &thread: cpu_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    for (auto &thread: npu_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+std::shared_ptr<Yolov5> Yolov5Pipeline::createInstance(int npu_core) {
+    std::shared_ptr<Yolov5> yolov5 = std::make_shared<Yolov5>();
+    yolov5->SetNPUCore(npu_core);
+    nn_error_e ret = yolov5->LoadModelWithData(model_data_, model_size_);
+    if (ret != NN_SUCCESS) {
+        NN_LOG_ERROR("Yolov5Pipeline: load model failed on NPU Core %d, ret=%d", npu_core, ret);
+        return nullptr;
+    }
+    yolov5->Warmup();
+    return yolov5;
+}
+
+// 预分配作业及其张量缓冲，放入空闲队列
+bool Yolov5Pipeline::addJobs(int count) {
+    for (int i = 0; i < count && (int) jobs_.size() < PIPELINE_MAX_JOBS; i++) {
+        std::unique_ptr<pipeline_job_t> job(new pipeline_job_t());
+        if (model_->AllocateTensors(job->input, job->outputs) != NN_SUCCESS) {
+            return false;
+        }
+        // 输入张量放到DMA-buf中，NPU用rknn_create_mem_from_fd直接读取，省去rknn_inputs_set的拷贝
+        if (FrameBufferPool::getInstance().getBackend() == FRAME_BACKEND_DMA_HEAP) {
+            std::shared_ptr<FrameBuffer> buffer = FrameBufferPool::getInstance().acquire(job->input.attr.size);
+            if (buffer && buffer->isDmaBuf()) {
+                free(job->input.data);
+                job->input.data = buffer->data;
+                job->inputBuffer = buffer;
+            }
+        }
+        job->npu_core = -1;
+        job->npu_ret = NN_SUCCESS;
+        job->npu_us = 0;
+        free_jobs_.push(job.get());
+        jobs_.push_back(std::move(job));
+    }
+    return true;
+}
+
+nn_error_e Yolov5Pipeline::setUpWithModelData(int npu_workers, char *modelData, int modelSize, ResultCallback callback) {
+    if (modelData == nullptr || modelSize <= 0) {
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    model_data_ = modelData;
+    model_size_ = modelSize;
+    callback_ = callback;
+
+    nn_error_e ret = resizeNpuWorkers(npu_workers);
+    if (!model_) {
+        return NN_LOAD_MODEL_FAIL;
+    }
+
+    for (int i = 0; i < PIPELINE_PRE_THREADS; i++) {
+        cpu_threads_.emplace_back(&Yolov5Pipeline::preprocessWorker, this);
+    }
+    for (int i = 0; i < PIPELINE_POST_THREADS; i++) {
+        cpu_threads_.emplace_back(&Yolov5Pipeline::postprocessWorker, this);
+    }
+
+    LOGD("Yolov5Pipeline initialized: %d preprocess, %d NPU, %d postprocess threads, %zu jobs",
+         PIPELINE_PRE_THREADS, active_npu_workers_.load(), PIPELINE_POST_THREADS, jobs_.size());
+    return ret;
+}
+
+nn_error_e Yolov5Pipeline::resizeNpuWorkers(int npu_workers) {
+    if (npu_workers < 1) {
+        npu_workers = 1;
+    } else if (npu_workers > PIPELINE_MAX_NPU_WORKERS) {
+        npu_workers = PIPELINE_MAX_NPU_WORKERS;
+    }
+
+    std::lock_guard<std::mutex> lock(resize_mtx_);
+    int current = active_npu_workers_.load();
+    if (npu_workers == current) {
+        return NN_SUCCESS;
+    }
+
+    if (npu_workers < current) {
+        // 缩容：被淘汰的NPU线程跑完手上的作业后退出，预分配的作业保留继续复用
+        active_npu_workers_.store(npu_workers);
+        for (int i = npu_workers; i < current; ++i) {
+            if (npu_threads_[i].joinable()) {
+                npu_threads_[i].join();
+            }
+        }
+        npu_threads_.resize(npu_workers);
+        npu_instances_.resize(npu_workers);
+        LOGD("Yolov5Pipeline NPU workers shrunk from %d to %d", current, npu_workers);
+        return NN_SUCCESS;
+    }
+
+    // 扩容：上下文按核心轮询分配，预热完成后再启动线程
+    std::vector<std::shared_ptr<Yolov5>> new_instances;
+    for (int i = current; i < npu_workers; ++i) {
+        std::shared_ptr<Yolov5> yolov5 = createInstance(i % PIPELINE_NPU_CORES);
+        if (!yolov5) {
+            break;
+        }
+        new_instances.push_back(yolov5);
+    }
+    if (!model_ && !new_instances.empty()) {
+        model_ = new_instances[0];
+    }
+
+    int target = current + (int) new_instances.size();
+    if (model_) {
+        addJobs(target * 2 + PIPELINE_PRE_THREADS - (int) jobs_.size());
+    }
+    for (int i = current; i < target; ++i) {
+        npu_instances_.push_back(new_instances[i - current]);
+    }
+    active_npu_workers_.store(target);
+    for (int i = current; i < target; ++i) {
+        npu_threads_.emplace_back(&Yolov5Pipeline::npuWorker, this, i, npu_instances_[i]);
+    }
+
+    LOGD("Yolov5Pipeline NPU workers grown from %d to %d, %zu jobs", current, target, jobs_.size());
+    return target == npu_workers ? NN_SUCCESS : NN_LOAD_MODEL_FAIL;
+}
+
+nn_error_e Yolov5Pipeline::submit(const std::shared_ptr<frame_data_t> frameData) {
+    if (stop_ || !model_) {
+        return NN_STOPED;
+    }
+    std::shared_ptr<pipeline_frame_t> frame = std::make_shared<pipeline_frame_t>();
+    frame->frameData = frameData;
+    frame->plan = model_->PlanFrame(frameData, frame->passes);
+    frame->total = (int) frame->passes.size();
+    frame->remaining = frame->total;
+    frame->npuUs = 0;
+    pending_++;
+    // 跟踪裁剪时没有跟踪目标的帧不推理，直接交出空结果
+    if (frame->passes.empty()) {
+        finishFrame(frame);
+        return NN_SUCCESS;
+    }
+    if (!input_queue_.push(frame)) {
+        pending_--;
+        return NN_STOPED;
+    }
+    return NN_SUCCESS;
+}
+
+int64_t Yolov5Pipeline::recordStage(int stage, const struct timeval &start) {
+    struct timeval end;
+    gettimeofday(&end, NULL);
+    int64_t elapsed = (end.tv_sec - start.tv_sec) * 1000000LL + (end.tv_usec - start.tv_usec);
+    stage_time_us_[stage] += elapsed;
+    stage_count_[stage]++;
+    return elapsed;
+}
+
+void Yolov5Pipeline::preprocessWorker() {
+    CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_INFERENCE, "yolov5_pre");
+    CpuBudgetScope budget(THREAD_ROLE_INFERENCE);
+    while (!stop_) {
+        std::shared_ptr<pipeline_frame_t> frame;
+        if (!input_queue_.pop(frame)) {
+            return;
+        }
+
+        // 分块检测时一帧拆成多个作业，依次预处理后各自进入NPU队列，由空闲的NPU上下文并行推理
+        std::shared_ptr<frame_data_t> frameData = frame->frameData;
+        gettimeofday(&frame->start, NULL);
+        for (const auto &pass: frame->passes) {
+            pipeline_job_t *job = nullptr;
+            if (!free_jobs_.pop(job)) {
+                return;
+            }
+
+            struct timeval start;
+            gettimeofday(&start, NULL);
+            job->frameData = frameData;
+            job->frame = frame;
+            nn_error_e ret = model_->PreprocessRegions(frameData, job->input, pass, job->regions,
+                                                       job->inputBuffer.get());
+            recordStage(0, start);
+
+            // 预处理失败的作业跳过NPU，直接由后处理线程交出空结果
+            if (ret != NN_SUCCESS) {
+                job->npu_core = -1;
+                job->npu_ret = ret;
+                job->npu_us = 0;
+                if (!post_queue_.push(job)) {
+                    return;
+                }
+                continue;
+            }
+            if (!npu_queue_.push(job)) {
+                return;
+            }
+        }
+    }
+}
+
+void Yolov5Pipeline::npuWorker(int id, std::shared_ptr<Yolov5> instance) {
+    CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_INFERENCE, "yolov5_npu");
+    int npu_core = instance->GetNPUCore();
+    while (!stop_) {
+        if (id >= active_npu_workers_.load()) {
+            LOGD("Yolov5Pipeline NPU worker %d (NPU Core %d) retired", id, npu_core);
+            return;
+        }
+        pipeline_job_t *job = nullptr;
+        if (!npu_queue_.popFor(job, PIPELINE_NPU_POLL_MS)) {
+            continue;
+        }
+
+        struct timeval start;
+        gettimeofday(&start, NULL);
+        job->npu_core = npu_core;
+        BandwidthCameraScope bandwidthScope(job->frameData->cameraIndex);
+        if (job->inputBuffer) {
+            job->npu_ret = instance->InferenceTensorsFd(job->inputBuffer->fd, job->input, job->outputs);
+        } else {
+            job->npu_ret = instance->InferenceTensors(job->input, job->outputs);
+        }
+        job->npu_us = recordStage(1, start);
+
+        if (!post_queue_.push(job)) {
+            return;
+        }
+    }
+}
+
+void Yolov5Pipeline::finishFrame(const std::shared_ptr<pipeline_frame_t> &frame) {
+    if (frame->total > 1) {
+        merge_detections(frame->detections, NMS_THRESH);
+        struct timeval end;
+        gettimeofday(&end, NULL);
+        tiled_time_us_ += (end.tv_sec - frame->start.tv_sec) * 1000000LL + (end.tv_usec - frame->start.tv_usec);
+        tiled_count_++;
+    }
+    CropScheduler::getInstance().update(frame->frameData->cameraIndex, frame->plan, frame->frameData->pts,
+                                        frame->detections, frame->npuUs);
+    if (callback_) {
+        callback_(frame->frameData, frame->detections);
+    }
+    pending_--;
+}
+
+void Yolov5Pipeline::postprocessWorker() {
+    CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_INFERENCE, "yolov5_post");
+    CpuBudgetScope budget(THREAD_ROLE_INFERENCE);
+    while (!stop_) {
+        pipeline_job_t *job = nullptr;
+        if (!post_queue_.pop(job)) {
+            return;
+        }
+
+        struct timeval start;
+        gettimeofday(&start, NULL);
+        std::vector<Detection> detections;
+        if (job->npu_ret == NN_SUCCESS) {
+            model_->PostprocessRegions(job->outputs, job->regions, detections);
+        } else {
+            // 推理失败也要交出空结果，否则取结果的一方会一直等这一帧
+            LOGE("Yolov5Pipeline: frame %d inference failed on NPU Core %d, ret=%d",
+                 job->frameData->frameId, job->npu_core, job->npu_ret);
+        }
+        recordStage(2, start);
+
+        std::shared_ptr<pipeline_frame_t> frame = job->frame;
+        int64_t npuUs = job->npu_us;
+        job->frameData.reset();
+        job->frame.reset();
+        free_jobs_.push(job);
+
+        // 一帧的所有作业都完成后才交出结果，分块之间重复检出的目标合并去重
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(frame->mutex);
+            frame->detections.insert(frame->detections.end(), detections.begin(), detections.end());
+            frame->npuUs += npuUs;
+            last = --frame->remaining == 0;
+        }
+        if (!last) {
+            continue;
+        }
+        finishFrame(frame);
+
+        long long count = stage_count_[2].load();
+        if (count % PIPELINE_STATS_INTERVAL == 0) {
+            for (int i = 0; i < 3; i++) {
+                long long n = stage_count_[i].load();
+                LOGD("Yolov5Pipeline %s: frames=%lld avg=%.2f ms", g_stage_names[i], n,
+                     n > 0 ? stage_time_us_[i].load() / 1000.0 / n : 0.0);
+            }
+            long long tiled = tiled_count_.load();
+            if (tiled > 0) {
+                LOGD("Yolov5Pipeline tiled frames=%lld avg latency=%.2f ms on %d NPU contexts", tiled,
+                     tiled_time_us_.load() / 1000.0 / tiled, active_npu_workers_.load());
+            }
+            ScratchArena::logStats();
+            ImageProcessor::getInstance().logStats();
+        }
+    }
+}
@@ -0,0 +1,122 @@
+
+#ifndef RK3588_DEMO_YOLOV5_PIPELINE_H
+#define RK3588_DEMO_YOLOV5_PIPELINE_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <sys/time.h>
+#include "user_comm.h"
+#include "yolov5.h"
+#include "bounded_queue.h"
+
+#define PIPELINE_NPU_CORES 3
+#define PIPELINE_MAX_NPU_WORKERS 6      // 每个NPU核心最多2个上下文
+#define PIPELINE_PRE_THREADS 2
+#define PIPELINE_POST_THREADS 1
+#define PIPELINE_STATS_INTERVAL 200     // 每处理多少帧输出一次各阶段耗时
+
+// 一帧拆成多个作业（分块检测）时共享的状态，最后一个作业后处理完成后合并结果交出
+struct pipeline_frame_t {
+    std::shared_ptr<frame_data_t> frameData;
+    std::vector<FramePass> passes;      // 提交时规划好的各次推理
+    int total;                          // 作业数
+    int remaining;                      // 还没有后处理完成的作业数
+    crop_plan_e plan;                   // 跟踪裁剪给出的检测方式，完成后连同结果交回CropScheduler
+    int64_t npuUs;                      // 各作业NPU耗时之和
+    struct timeval start;
+    std::mutex mutex;
+    std::vector<Detection> detections;
+};
+
+// 在各阶段之间流转的作业，输入输出张量预先分配并循环使用
+typedef struct {
+    std::shared_ptr<frame_data_t> frameData;
+    std::shared_ptr<pipeline_frame_t> frame;
+    tensor_data_s input;
+    std::shared_ptr<FrameBuffer> inputBuffer;  // 有DMA heap时input.data指向它，NPU按fd直接读取
+    std::vector<tensor_data_s> outputs;
+    std::vector<InputRegion> regions;           // 预处理给出的检测区域，后处理按它还原坐标
+    int npu_core;
+    nn_error_e npu_ret;
+    int64_t npu_us;
+} pipeline_job_t;
+
+// 三级流水线：CPU预处理 -> NPU推理 -> CPU后处理，各级之间用有界队列传递预分配的张量缓冲
+// NPU线程只负责rknn_run，每个核心1~2个上下文即可跑满，不再需要每个线程一套完整流程
+class Yolov5Pipeline {
+public:
+    typedef std::function<void(const std::shared_ptr<frame_data_t> &, std::vector<Detection> &)> ResultCallback;
+
+    Yolov5Pipeline();
+
+    ~Yolov5Pipeline();
+
+    nn_error_e setUpWithModelData(int npu_workers, char *modelData, int modelSize, ResultCallback callback);
+
+    // 运行时调整NPU上下文数量，范围[1, PIPELINE_MAX_NPU_WORKERS]
+    nn_error_e resizeNpuWorkers(int npu_workers);
+
+    int getNpuWorkerCount() {
+        return active_npu_workers_.load();
+    }
+
+    // 队列满时阻塞，与原线程池submitTask行为一致
+    // 在提交线程上按帧序规划检测方式，每路摄像头只能有一个提交线程，预处理线程并发时不会打乱跟踪裁剪的顺序
+    nn_error_e submit(const std::shared_ptr<frame_data_t> frameData);
+
+    // 已提交但还没有产生结果的帧数
+    int pending() {
+        return pending_.load();
+    }
+
+    void stop();
+
+private:
+    void preprocessWorker();
+
+    void npuWorker(int id, std::shared_ptr<Yolov5> instance);
+
+    void postprocessWorker();
+
+    std::shared_ptr<Yolov5> createInstance(int npu_core);
+
+    bool addJobs(int count);
+
+    // 返回这一阶段的耗时
+    int64_t recordStage(int stage, const struct timeval &start);
+
+    // 一帧的所有作业完成（或没有作业）后交出结果
+    void finishFrame(const std::shared_ptr<pipeline_frame_t> &frame);
+
+    BoundedQueue<std::shared_ptr<pipeline_frame_t>> input_queue_;
+    BoundedQueue<pipeline_job_t *> free_jobs_;
+    BoundedQueue<pipeline_job_t *> npu_queue_;
+    BoundedQueue<pipeline_job_t *> post_queue_;
+
+    std::vector<std::unique_ptr<pipeline_job_t>> jobs_;
+    std::shared_ptr<Yolov5> model_;     // 预处理和后处理只读取模型属性，共用第一个实例
+    std::vector<std::shared_ptr<Yolov5>> npu_instances_;
+    std::vector<std::thread> npu_threads_;
+    std::vector<std::thread> cpu_threads_;
+    std::mutex resize_mtx_;
+
+    std::atomic<int> active_npu_workers_;
+    std::atomic<int> pending_;
+    std::atomic<bool> stop_;
+    char *model_data_;
+    int model_size_;
+    ResultCallback callback_;
+
+    // 各阶段累计耗时，0预处理 1等待NPU+推理 2后处理
+    std::atomic<long long> stage_time_us_[3];
+    std::atomic<long long> stage_count_[3];
+    // 分块检测的帧从开始预处理到交出结果的耗时，各块分给不同NPU上下文并行，应随上下文数增加而下降
+    std::atomic<long long> tiled_time_us_;
+    std::atomic<long long> tiled_count_;
+};
+
+#endif // RK3588_DEMO_YOLOV5_PIPELINE_H
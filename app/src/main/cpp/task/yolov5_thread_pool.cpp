@@ -2,6 +2,9 @@
 #include "yolov5_thread_pool.h"
 #include "cv_draw.h"
 #include "sys/time.h"
+#include "cpu_topology.h"
+#include "cpu_budget.h"
+#include "bandwidth_meter.h"
 
 // NPULoadBalancer实现
 NPULoadBalancer::NPULoadBalancer() {
@@ -48,29 +51,37 @@ void NPULoadBalancer::GetCoreStatus(int core_loads[3]) {
     }
 }
 
-void Yolov5ThreadPool::worker(int id) {
+void Yolov5ThreadPool::worker(int id, std::shared_ptr<Yolov5> instance, int npu_core) {
+    CpuTopology::getInstance().applyToCurrentThread(THREAD_ROLE_INFERENCE, "yolov5_worker");
+    CpuBudgetScope budget(THREAD_ROLE_INFERENCE);
     while (!stop) {
         // std::pair<int, cv::Mat> task;
-        std::shared_ptr<frame_data_t> taskFrameData;
-        std::shared_ptr<Yolov5> instance = yolov5_instances[id];
+        yolov5_task_t task;
         {
             std::unique_lock<std::mutex> lock(mtx1);
-            cv_task.wait(lock, [&] { return !tasks.empty() || stop; });
+            cv_task.wait(lock, [&] { return !tasks.empty() || stop || id >= active_workers_.load(); });
 
             if (stop) {
                 return;
             }
 
-            taskFrameData = tasks.front();
+            // 缩容：该线程已被淘汰，当前任务已经处理完毕，直接退出
+            if (id >= active_workers_.load()) {
+                LOGD("thread %d (NPU Core %d) retired", id, npu_core);
+                return;
+            }
+
+            task = std::move(tasks.front());
             tasks.pop();
         }
+        std::shared_ptr<frame_data_t> taskFrameData = task.frameData;
 
         std::vector<Detection> detections;
         struct timeval start, end;
-        int npu_core = thread_npu_cores_[id];
 
         gettimeofday(&start, NULL);
-        instance->RunWithFrameData(taskFrameData, detections);
+        BandwidthCameraScope bandwidthScope(taskFrameData->cameraIndex);
+        instance->RunWithPlan(taskFrameData, task.plan, task.passes, detections);
         gettimeofday(&end, NULL);
 
         float time_use = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000;
@@ -80,65 +91,173 @@ void Yolov5ThreadPool::worker(int id) {
         if (load_balancer_) {
             load_balancer_->TaskCompleted(npu_core);
         }
-        {
-            std::lock_guard<std::mutex> lock(mtx2);
-            results.insert({taskFrameData->frameId, detections});
-            // DrawDetections(task.second, detections);
-            // img_results.insert({task.first, task.second});
-            img_results.insert({taskFrameData->frameId, taskFrameData});
-            // cv_result.notify_one();
-        }
+        taskFrameData->memCharge.moveTo(MEM_STAGE_REORDER);
+        taskFrameData->displayCharge.moveTo(MEM_STAGE_REORDER);
+        reorder_buffer_.push(taskFrameData->frameId, detections, taskFrameData);
     }
 }
 
+std::shared_ptr<Yolov5> Yolov5ThreadPool::createInstance(int npu_core) {
+    std::shared_ptr<Yolov5> yolov5 = std::make_shared<Yolov5>();
 
-nn_error_e Yolov5ThreadPool::setUpWithModelData(int num_threads, char *modelData, int modelSize) {
-    // 初始化负载均衡器
-    load_balancer_.reset(new NPULoadBalancer());
-    thread_npu_cores_.resize(num_threads);
+    // 设置NPU核心后加载模型
+    yolov5->SetNPUCore(npu_core);
+    nn_error_e ret;
+    if (model_data_ != nullptr && model_size_ > 0) {
+        ret = yolov5->LoadModelWithData(model_data_, model_size_);
+    } else {
+        ret = yolov5->LoadModel(model_path_.c_str());
+    }
+    if (ret != NN_SUCCESS) {
+        NN_LOG_ERROR("Yolov5ThreadPool: load model failed on NPU Core %d, ret=%d", npu_core, ret);
+        return nullptr;
+    }
+
+    // 预热：先跑一次推理，避免新线程的首帧延迟拖慢正在运行的流
+    yolov5->Warmup();
+    return yolov5;
+}
+
+// 流水线交出结果的回调（后处理线程；跟踪裁剪下不推理的帧在提交线程），结果与工作线程一样放入重排缓冲
+void Yolov5ThreadPool::onPipelineResult(const std::shared_ptr<frame_data_t> &frameData, std::vector<Detection> &detections) {
+    frameData->memCharge.moveTo(MEM_STAGE_REORDER);
+    frameData->displayCharge.moveTo(MEM_STAGE_REORDER);
+    reorder_buffer_.push(frameData->frameId, detections, frameData);
+}
 
-    // 遍历线程数量，创建模型实例，均匀分配到3个NPU核心
-    for (size_t i = 0; i < num_threads; ++i) {
-        std::shared_ptr<Yolov5> yolov5 = std::make_shared<Yolov5>();
+nn_error_e Yolov5ThreadPool::resize(int num_threads) {
+    if (num_threads < 0) {
+        return NN_IO_NUM_NOT_MATCH;
+    }
+    if (model_data_ == nullptr && model_path_.empty()) {
+        NN_LOG_ERROR("Yolov5ThreadPool: resize before model is set");
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
 
+    std::lock_guard<std::mutex> resize_lock(resize_mtx_);
+    if (pipeline_mode_) {
+        std::shared_ptr<Yolov5Pipeline> pipeline = currentPipeline();
+        if (num_threads == 0) {
+            // 只在锁内摘下指针；正在提交的解码线程仍持有引用，最后一个引用释放时才停止流水线
+            std::lock_guard<std::mutex> lock(pipeline_mtx_);
+            pipeline_.reset();
+            return NN_SUCCESS;
+        }
+        if (pipeline) {
+            return pipeline->resizeNpuWorkers(num_threads);
+        }
+        if (model_data_ == nullptr) {
+            NN_LOG_ERROR("Yolov5ThreadPool: pipeline mode requires model data");
+            return NN_RKNN_MODEL_NOT_LOAD;
+        }
+        // 初始化完成后再发布，提交线程不会看到建到一半的流水线
+        pipeline = std::make_shared<Yolov5Pipeline>();
+        nn_error_e ret = pipeline->setUpWithModelData(num_threads, model_data_, model_size_,
+                                                      std::bind(&Yolov5ThreadPool::onPipelineResult, this,
+                                                                std::placeholders::_1, std::placeholders::_2));
+        std::lock_guard<std::mutex> lock(pipeline_mtx_);
+        pipeline_ = pipeline;
+        return ret;
+    }
+
+    int current = active_workers_.load();
+    if (num_threads == current) {
+        return NN_SUCCESS;
+    }
+
+    if (num_threads < current) {
+        // 缩容：被淘汰的线程处理完当前任务后退出，再释放其模型上下文
+        active_workers_.store(num_threads);
+        cv_task.notify_all();
+        for (int i = num_threads; i < current; ++i) {
+            if (threads[i].joinable()) {
+                threads[i].join();
+            }
+        }
+        threads.resize(num_threads);
+        yolov5_instances.resize(num_threads);
+        if (num_threads == 0) {
+            std::lock_guard<std::mutex> lock(mtx1);
+            planner_.reset();
+        }
+        thread_npu_cores_.resize(num_threads);
+        LOGD("YOLOv5 ThreadPool shrunk from %d to %d threads", current, num_threads);
+        return NN_SUCCESS;
+    }
+
+    // 扩容：先创建并预热新的模型上下文，全部就绪后再启动线程接任务
+    std::vector<std::shared_ptr<Yolov5>> new_instances;
+    for (int i = current; i < num_threads; ++i) {
         // 为每个实例分配NPU核心（轮询分配）
         int assigned_core = i % 3;
-        thread_npu_cores_[i] = assigned_core;
+        std::shared_ptr<Yolov5> yolov5 = createInstance(assigned_core);
+        if (!yolov5) {
+            break;
+        }
+        new_instances.push_back(yolov5);
+        LOGD("Thread %d assigned to NPU Core %d", i, assigned_core);
+        usleep(1000);
+    }
+
+    int target = current + (int) new_instances.size();
+    for (int i = current; i < target; ++i) {
+        yolov5_instances.push_back(new_instances[i - current]);
+        thread_npu_cores_.push_back(i % 3);
+    }
+    if (target > 0) {
+        std::lock_guard<std::mutex> lock(mtx1);
+        planner_ = yolov5_instances[0];
+    }
+    active_workers_.store(target);
+    for (int i = current; i < target; ++i) {
+        threads.emplace_back(&Yolov5ThreadPool::worker, this, i, yolov5_instances[i], thread_npu_cores_[i]);
+    }
 
-        // 设置NPU核心后加载模型
-        yolov5->SetNPUCore(assigned_core);
-        yolov5->LoadModelWithData(modelData, modelSize);
-        yolov5_instances.push_back(yolov5);
+    LOGD("YOLOv5 ThreadPool grown from %d to %d threads", current, target);
+    return target == num_threads ? NN_SUCCESS : NN_LOAD_MODEL_FAIL;
+}
 
-        LOGD("Thread %zu assigned to NPU Core %d", i, assigned_core);
-        usleep(1000);
+nn_error_e Yolov5ThreadPool::setUpWithModelData(int num_threads, char *modelData, int modelSize) {
+    // 初始化负载均衡器
+    if (!load_balancer_) {
+        load_balancer_.reset(new NPULoadBalancer());
     }
 
-    // 遍历线程数量，创建线程
-    for (size_t i = 0; i < num_threads; ++i) {
-        threads.emplace_back(&Yolov5ThreadPool::worker, this, i);
+    // 模型变化时先淘汰所有旧实例，再按新模型扩容
+    if (get_thread_count() > 0 && (model_data_ != modelData || model_size_ != modelSize)) {
+        resize(0);
     }
+    model_data_ = modelData;
+    model_size_ = modelSize;
 
-    LOGD("YOLOv5 ThreadPool initialized with %d threads across 3 NPU cores", num_threads);
-    return NN_SUCCESS;
+    nn_error_e ret = resize(num_threads);
+    LOGD("YOLOv5 ThreadPool initialized with %d %s across 3 NPU cores", get_thread_count(),
+         pipeline_mode_ ? "pipeline NPU contexts" : "threads");
+    return ret;
 }
 
 
 nn_error_e Yolov5ThreadPool::setUp(std::string &model_path, int num_threads) {
-    for (size_t i = 0; i < num_threads; ++i) {
-        std::shared_ptr<Yolov5> yolov5 = std::make_shared<Yolov5>();
-        yolov5->LoadModel(model_path.c_str());
-        yolov5_instances.push_back(yolov5);
-    }
-    for (size_t i = 0; i < num_threads; ++i) {
-        threads.emplace_back(&Yolov5ThreadPool::worker, this, i);
+    if (get_thread_count() > 0 && model_path_ != model_path) {
+        resize(0);
     }
-    return NN_SUCCESS;
+    model_data_ = nullptr;
+    model_size_ = 0;
+    model_path_ = model_path;
+    return resize(num_threads);
 }
 
-Yolov5ThreadPool::Yolov5ThreadPool() { stop = false; }
+Yolov5ThreadPool::Yolov5ThreadPool() : active_workers_(0), model_data_(nullptr), model_size_(0),
+                                       pipeline_mode_(false) { stop = false; }
 
 Yolov5ThreadPool::~Yolov5ThreadPool() {
+    // 先停流水线，回调里还会访问重排缓冲
+    std::shared_ptr<Yolov5Pipeline> pipeline;
+    {
+        std::lock_guard<std::mutex> lock(pipeline_mtx_);
+        pipeline.swap(pipeline_);
+    }
+    pipeline.reset();
     stop = true;
     cv_task.notify_all();
     for (auto &thread: threads) {
@@ -149,71 +268,49 @@ Yolov5ThreadPool::~Yolov5ThreadPool() {
 }
 
 nn_error_e Yolov5ThreadPool::submitTask(const std::shared_ptr<frame_data_t> frameData) {
+    std::shared_ptr<Yolov5Pipeline> pipeline = currentPipeline();
+    if (pipeline) {
+        LOGD("Submit task %d to pipeline", frameData->frameId);
+        return pipeline->submit(frameData);
+    }
     while (tasks.size() > MAX_TASK) {
         // sleep 1ms
         LOGD("mpp_decoder_frame_callback waiting");
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    std::shared_ptr<Yolov5> planner;
+    {
+        std::lock_guard<std::mutex> lock(mtx1);
+        planner = planner_;
+    }
+    if (!planner) {
+        LOGW("Submit task %d dropped: no model instance", frameData->frameId);
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    // 在提交线程上按帧序规划，多个工作线程取任务的先后不影响跟踪裁剪的整幅检测间隔
+    yolov5_task_t task;
+    task.frameData = frameData;
+    task.plan = planner->PlanFrame(frameData, task.passes);
     {
         std::lock_guard<std::mutex> lock(mtx1);
         LOGD("Submit task %d", frameData->frameId);
-        tasks.push(frameData);
+        tasks.push(std::move(task));
         // tasks.push({id, img});
     }
     cv_task.notify_one();
     return NN_SUCCESS;
 }
 
-nn_error_e Yolov5ThreadPool::getTargetResult(std::vector<Detection> &objects, int id) {
-    while (results.find(id) == results.end()) {
-        // sleep 1ms
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
-    std::lock_guard<std::mutex> lock(mtx2);
-    objects = results[id];
-    // remove from map
-    results.erase(id);
-    img_results.erase(id);
-
-    return NN_SUCCESS;
-}
-
-nn_error_e Yolov5ThreadPool::getTargetResultNonBlock(std::vector<Detection> &objects, int id) {
-    if (results.find(id) == results.end()) {
-        return NN_RESULT_NOT_READY;
-    }
-    std::lock_guard<std::mutex> lock(mtx2);
-    objects = results[id];
-    // remove from map
-    results.erase(id);
-    // img_results.erase(id);
-
-    return NN_SUCCESS;
-}
-
-std::shared_ptr<frame_data_t> Yolov5ThreadPool::getTargetImgResult(int id) {
-    int loop_cnt = 0;
-    //    while (img_results.find(id) == img_results.end()) {
-    //        // sleep 1ms
-    //        std::this_thread::sleep_for(std::chrono::milliseconds(5));
-    //        loop_cnt++;
-    //        if (loop_cnt > 1000) {
-    //            NN_LOG_ERROR("getTargetImgResult timeout");
-    //            return nullptr;
-    //        }
-    //    }
-    std::lock_guard<std::mutex> lock(mtx2);
-    auto frameData = img_results[id];
-    // img = img_results[id];
-    // remove from map
-    // img_results.erase(id);
-    return frameData;
-    // results.erase(id);
-    // return ;
+nn_error_e Yolov5ThreadPool::getNextResult(std::vector<Detection> &objects, std::shared_ptr<frame_data_t> &frameData) {
+    return reorder_buffer_.pop(objects, frameData);
 }
 
 // 停止所有线程
 void Yolov5ThreadPool::stopAll() {
+    std::shared_ptr<Yolov5Pipeline> pipeline = currentPipeline();
+    if (pipeline) {
+        pipeline->stop();
+    }
     stop = true;
     cv_task.notify_all();
 }
@@ -14,6 +14,8 @@
 #include <array>
 #include "user_comm.h"
 #include "yolov5.h"
+#include "yolov5_pipeline.h"
+#include "result_reorder_buffer.h"
 
 // NPU负载均衡器
 class NPULoadBalancer {
@@ -31,19 +33,25 @@ public:
 
 #define MAX_TASK 22
 
+// 提交时已经确定检测方式的任务，跟踪裁剪按帧序规划，不受工作线程取任务先后的影响
+typedef struct {
+    std::shared_ptr<frame_data_t> frameData;
+    crop_plan_e plan;
+    std::vector<FramePass> passes;
+} yolov5_task_t;
+
 class Yolov5ThreadPool {
 
 private:
 
     // std::queue <std::pair<int, cv::Mat>> tasks;
     std::vector <std::shared_ptr<Yolov5>> yolov5_instances;
-    std::queue<std::shared_ptr<frame_data_t>> tasks;
-    std::map<int, std::vector<Detection>> results;
-    // std::map<int, cv::Mat> img_results;
-    std::map<int, std::shared_ptr<frame_data_t>> img_results;
+    std::queue<yolov5_task_t> tasks;
+    std::shared_ptr<Yolov5> planner_;   // 提交时规划检测方式用的实例（只读模型属性），由mtx1保护
+    // 推理结果按帧号重新排序后交付，缺失的帧号超时跳过
+    ResultReorderBuffer reorder_buffer_;
     std::vector <std::thread> threads;
     std::mutex mtx1;
-    std::mutex mtx2;
     std::condition_variable cv_task, cv_result;
     bool stop;
 
@@ -51,7 +59,29 @@ private:
     std::unique_ptr<NPULoadBalancer> load_balancer_;
     std::vector<int> thread_npu_cores_;  // 每个线程对应的NPU核心ID
 
-    void worker(int id);
+    // 运行时扩缩容：id >= active_workers_ 的线程处理完当前任务后退出
+    std::atomic<int> active_workers_;
+    std::mutex resize_mtx_;
+    char *model_data_;          // 模型数据由调用方持有，扩容时用来创建新实例
+    int model_size_;
+    std::string model_path_;
+
+    // 流水线模式：预处理/NPU/后处理分级执行，线程数对应NPU上下文数
+    // 解码线程提交任务时resize可能同时替换或释放流水线，指针在锁内取出一份引用再使用
+    bool pipeline_mode_;
+    std::shared_ptr<Yolov5Pipeline> pipeline_;
+    std::mutex pipeline_mtx_;
+
+    std::shared_ptr<Yolov5Pipeline> currentPipeline() {
+        std::lock_guard<std::mutex> lock(pipeline_mtx_);
+        return pipeline_;
+    }
+
+    void worker(int id, std::shared_ptr<Yolov5> instance, int npu_core);
+
+    void onPipelineResult(const std::shared_ptr<frame_data_t> &frameData, std::vector<Detection> &detections);
+
+    std::shared_ptr<Yolov5> createInstance(int npu_core);
 
 public:
     Yolov5ThreadPool();
@@ -62,16 +92,36 @@ public:
     nn_error_e setUpWithModelData(int num_threads, char *modelData, int modelSize);
     nn_error_e setUp(std::string &model_path, int num_threads = 12);
 
-    nn_error_e submitTask(const std::shared_ptr<frame_data_t> frameData);
+    // 在setUp之前调用，开启后使用三级流水线代替每线程完整流程
+    void setPipelineMode(bool enable) {
+        pipeline_mode_ = enable;
+    }
 
-    nn_error_e getTargetResult(std::vector <Detection> &objects, int id);
+    bool isPipelineMode() const {
+        return pipeline_mode_;
+    }
+
+    // 运行时调整工作线程及其模型上下文数量，不影响正在运行的流
+    // 流水线模式下调整的是NPU上下文数量，上限PIPELINE_MAX_NPU_WORKERS
+    nn_error_e resize(int num_threads);
 
-    nn_error_e getTargetResultNonBlock(std::vector <Detection> &objects, int id);
+    int get_thread_count() {
+        std::shared_ptr<Yolov5Pipeline> pipeline = currentPipeline();
+        return pipeline ? pipeline->getNpuWorkerCount() : active_workers_.load();
+    }
 
-    std::shared_ptr<frame_data_t>  getTargetImgResult(int id);
+    nn_error_e submitTask(const std::shared_ptr<frame_data_t> frameData);
+
+    // 按帧号顺序取下一个结果，非阻塞，没有可交付的结果时返回NN_RESULT_NOT_READY
+    nn_error_e getNextResult(std::vector <Detection> &objects, std::shared_ptr<frame_data_t> &frameData);
+
+    ResultReorderBuffer &getReorderBuffer() {
+        return reorder_buffer_;
+    }
     
     int get_task_size() {
-        return tasks.size();
+        std::shared_ptr<Yolov5Pipeline> pipeline = currentPipeline();
+        return pipeline ? pipeline->pending() : tasks.size();
     }
 };
 
@@ -19,7 +19,9 @@ typedef enum
     NN_RKNN_SET_CORE_FAIL = -11,    // rknn设置NPU核心失败
     NN_STOPED = -12,                // 程序已停止
     NN_TIMEOUT = -13,               // 超时
-    NN_RESULT_NOT_READY = -13
+    NN_RESULT_NOT_READY = -13,
+    NN_RGA_FAIL = -14,              // RGA处理失败
+    NN_IMAGE_PROCESS_FAIL = -15     // 图像处理失败，RGA和CPU后端都不可用
 } nn_error_e;
 
 #endif // RK3588_DEMO_ERROR_H
@@ -323,6 +323,39 @@ public class MainActivity extends AppCompatActivity {
     public native void switchCamera();
     public native void checkAndRecoverStuckCameras();
 
+    // NPU算力分配（设置界面使用），准入状态：0未注册 1准入 2降级 3拒绝
+    public native int setCameraDetectionPolicy(int cameraIndex, float weight, float minFps, float maxFps, boolean allowDegrade);
+    public native int getCameraAdmissionState(int cameraIndex);
+    public native float getCameraDetectionFps(int cameraIndex);
+    public native float getNpuCapacityFps();
+    public native float getNpuInferenceCostMs();
+
+    // 帧缓冲池统计：[命中, 未命中, 回收, 释放, 空闲字节数, 使用中缓冲数]
+    public native long[] getFrameBufferPoolStats();
+
+    // 在途帧内存管理：上限（MB），优先摄像头，用量 [解码, 推理, 重排, 显示, 丢帧数]（索引<0为全局，最后一项为峰值）
+    public native void setFrameMemoryCeilingMB(long ceilingMb);
+    public native void setCameraMemoryPriority(int cameraIndex, boolean priority);
+    public native long[] getFrameMemoryUsage(int cameraIndex);
+
+    // 静态检测区域：rects按 [x, y, 宽, 高] 排列，相对画面取0~1，每路最多4个；null或空数组恢复整幅检测，返回生效的区域数
+    public native int setCameraRois(int cameraIndex, float[] rects);
+    // 分块检测（高分辨率摄像头的小目标）：0关闭 1分块 2分块加整幅检测
+    public native void setCameraTileMode(int cameraIndex, int mode);
+    // 跟踪引导的区域检测：每interval帧整幅检测一次，其间只检测跟踪目标附近的区域（<=1关闭）
+    public native void setCameraCropDetection(int cameraIndex, int interval);
+    // [平均每帧NPU毫秒, 整幅检测每帧NPU毫秒, 召回率, 召回率样本数, 跟踪目标数]
+    public native float[] getCameraCropStats(int cameraIndex);
+    // 静止画面跳过推理：threshold为变化区域占比（<=0关闭），keepAliveMs为静止时强制推理的间隔
+    public native void setCameraMotionGate(int cameraIndex, float threshold, int keepAliveMs);
+    // 按编码帧大小估计画面活动：mode 0关闭 1只统计 2静止帧不送推理；skipDecode允许空闲的非优先摄像头跳过非参考帧
+    public native void setCameraActivityGate(int cameraIndex, int mode, float threshold, boolean skipDecode);
+    public native float getCameraActivityScore(int cameraIndex);
+    // 线程角色的CPU绑定：role 0网络解码 1取结果画框 2推理 3渲染，cpuList如"4-7"，空字符串恢复默认
+    public native boolean setThreadRoleCpus(int role, String cpuList);
+    // 线程角色的OpenCV并行策略：mode 0按空闲核数自动（不超过cap） 1单线程 2固定cap个线程
+    public native boolean setThreadRolePolicy(int role, int mode, int cap);
+
     // 手动切换摄像头的方法
     public void switchCameraManually() {
         android.util.Log.d("MainActivity", "Manually switching camera");